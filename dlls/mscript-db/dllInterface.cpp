@@ -130,335 +130,339 @@ void mscript_FreeString(wchar_t* str)
 	delete[] str;
 }
 
-wchar_t* mscript_ExecuteFunction(const wchar_t* functionName, const wchar_t* parametersJson)
+// Run a function with its parameters, the same for JSON and binary callers
+static mscript::object executeFunction(const std::wstring& funcName, const mscript::object::list& params)
 {
-	try
+	std::unique_lock ctx_lock(g_mutex);
+
+	if (funcName == L"msdb_sql_init")
 	{
-		std::wstring funcName = functionName;
-		auto params = mscript::module_utils::getParams(parametersJson);
+		if
+		(
+			params.size() != 2
+			||
+			params[0].type() != mscript::object::STRING
+			|| 
+			params[1].type() != mscript::object::STRING
+		)
+		{
+			raiseError("Takes two parameters: a name for the database, and the path to the DB file");
+		}
 
-		std::unique_lock ctx_lock(g_mutex);
+		std::wstring db_name = params[0].stringVal();
+		std::wstring db_file_path = params[1].stringVal();
 
-		if (funcName == L"msdb_sql_init")
+		if (g_db_conns.find(db_name) != g_db_conns.end())
+			raiseWError(L"Database already initialized: " + db_name);
+
+		auto new_db = std::make_shared<fourdb::db>(mscript::toNarrowStr(db_file_path));
+		g_db_conns.insert({ db_name, new_db });
+
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_sql_close")
+	{
+		if
+		(
+			params.size() != 1
+			||
+			params[0].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 2
-				||
-				params[0].type() != mscript::object::STRING
-				|| 
-				params[1].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes two parameters: a name for the database, and the path to the DB file");
-			}
-
-			std::wstring db_name = params[0].stringVal();
-			std::wstring db_file_path = params[1].stringVal();
-
-			if (g_db_conns.find(db_name) != g_db_conns.end())
-				raiseWError(L"Database already initialized: " + db_name);
-
-			auto new_db = std::make_shared<fourdb::db>(mscript::toNarrowStr(db_file_path));
-			g_db_conns.insert({ db_name, new_db });
-
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes the name of the database");
 		}
-		else if (funcName == L"msdb_sql_close")
+
+		auto db_it = g_db_conns.find(params[0].stringVal());
+		if (db_it != g_db_conns.end())
+			g_db_conns.erase(db_it);
+
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_sql_exec")
+	{
+		if
+		(
+			(params.size() != 2 && params.size() != 3)
+			||
+			params[0].type() != mscript::object::STRING
+			||
+			params[1].type() != mscript::object::STRING
+			||
+			(params.size() == 3 && params[2].type() != mscript::object::INDEX)
+		)
 		{
-			if
-			(
-				params.size() != 1
-				||
-				params[0].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes the name of the database");
-			}
-
-			auto db_it = g_db_conns.find(params[0].stringVal());
-			if (db_it != g_db_conns.end())
-				g_db_conns.erase(db_it);
-
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes the name of the database, the SQL query, and an optional index of query parameters");
 		}
-		else if (funcName == L"msdb_sql_exec")
+
+		auto sql_db = getSqldb(params[0].stringVal());
+		std::wstring sql_query = params[1].stringVal();
+		auto params_idx = 
+			params.size() >= 3 
+			? params[2].indexVal() 
+			: mscript::object::index();
+		fourdb::paramap query_params = convert(params_idx);
+		
+		auto reader = sql_db->execReader(sql_query, query_params);
+
+		auto results = processDbReader(*reader);
+
+		return results;
+	}
+	else if (funcName == L"msdb_sql_rows_affected")
+	{
+		if
+		(
+			params.size() != 1
+			||
+			params[0].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				(params.size() != 2 && params.size() != 3)
-				||
-				params[0].type() != mscript::object::STRING
-				||
-				params[1].type() != mscript::object::STRING
-				||
-				(params.size() == 3 && params[2].type() != mscript::object::INDEX)
-			)
-			{
-				raiseError("Takes the name of the database, the SQL query, and an optional index of query parameters");
-			}
-
-			auto sql_db = getSqldb(params[0].stringVal());
-			std::wstring sql_query = params[1].stringVal();
-			auto params_idx = 
-				params.size() >= 3 
-				? params[2].indexVal() 
-				: mscript::object::index();
-			fourdb::paramap query_params = convert(params_idx);
-			
-			auto reader = sql_db->execReader(sql_query, query_params);
-
-			auto results = processDbReader(*reader);
-
-			return mscript::module_utils::jsonStr(results);
+			raiseError("Takes the database name");
 		}
-		else if (funcName == L"msdb_sql_rows_affected")
+
+		auto sql_db = getSqldb(params[0].stringVal());
+		int64_t rows_affected = sql_db->execScalarInt64(L"SELECT changes()").value();
+		return double(rows_affected);
+	}
+	else if (funcName == L"msdb_sql_last_inserted_id")
+	{
+		if
+		(
+			params.size() != 1
+			||
+			params[0].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 1
-				||
-				params[0].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes the database name");
-			}
-
-			auto sql_db = getSqldb(params[0].stringVal());
-			int64_t rows_affected = sql_db->execScalarInt64(L"SELECT changes()").value();
-			return mscript::module_utils::jsonStr(double(rows_affected));
+			raiseError("Takes the database name");
 		}
-		else if (funcName == L"msdb_sql_last_inserted_id")
+
+		auto sql_db = getSqldb(params[0].stringVal());
+		int64_t last_inserted_id = sql_db->execScalarInt64(L"SELECT last_insert_rowid()").value();
+		return double(last_inserted_id);
+	}
+	else if (funcName == L"msdb_4db_init")
+	{
+		if
+		(
+			params.size() != 2 
+			|| 
+			params[0].type() != mscript::object::STRING 
+			|| 
+			params[1].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 1
-				||
-				params[0].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes the database name");
-			}
-
-			auto sql_db = getSqldb(params[0].stringVal());
-			int64_t last_inserted_id = sql_db->execScalarInt64(L"SELECT last_insert_rowid()").value();
-			return mscript::module_utils::jsonStr(double(last_inserted_id));
+			raiseError("Takes two parameters: a name for the context, and the path to the DB file");
 		}
-		else if (funcName == L"msdb_4db_init")
+
+		std::wstring db_name = params[0].stringVal();
+		std::wstring db_file_path = params[1].stringVal();
+
+		if (g_contexts.find(db_name) != g_contexts.end())
+			raiseWError(L"Context already initialized: " + db_name);
+
+		auto ctxt_ptr = std::make_shared<fourdb::ctxt>(mscript::toNarrowStr(db_file_path));
+		g_contexts.insert({ db_name, ctxt_ptr });
+
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_4db_close")
+	{
+		if
+		(
+			params.size() != 1
+			||
+			params[0].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 2 
-				|| 
-				params[0].type() != mscript::object::STRING 
-				|| 
-				params[1].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes two parameters: a name for the context, and the path to the DB file");
-			}
-
-			std::wstring db_name = params[0].stringVal();
-			std::wstring db_file_path = params[1].stringVal();
-
-			if (g_contexts.find(db_name) != g_contexts.end())
-				raiseWError(L"Context already initialized: " + db_name);
-
-			auto ctxt_ptr = std::make_shared<fourdb::ctxt>(mscript::toNarrowStr(db_file_path));
-			g_contexts.insert({ db_name, ctxt_ptr });
-
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes the name of the context");
 		}
-		else if (funcName == L"msdb_4db_close")
+
+		auto ctxt_it = g_contexts.find(params[0].stringVal());
+		if (ctxt_it != g_contexts.end())
+			g_contexts.erase(ctxt_it);
+
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_4db_define")
+	{
+		if
+		(
+			params.size() != 4
+			||
+			params[0].type() != mscript::object::STRING
+			||
+			params[1].type() != mscript::object::STRING
+			//|| object
+			//params[2].type() != mscript::object::STRING
+			||
+			params[3].type() != mscript::object::INDEX
+		)
 		{
-			if
-			(
-				params.size() != 1
-				||
-				params[0].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes the name of the context");
-			}
-
-			auto ctxt_it = g_contexts.find(params[0].stringVal());
-			if (ctxt_it != g_contexts.end())
-				g_contexts.erase(ctxt_it);
-
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes four parameters: the name of the context, the table name, the key value, and an index of name-value pairs");
 		}
-		else if (funcName == L"msdb_4db_define")
+
+		auto ctxt = get4db(params[0].stringVal());
+
+		const std::wstring& table_name = params[1].stringVal();
+		const fourdb::strnum key_value = convert(params[2]);
+		const fourdb::paramap metadata = convert(params[3].indexVal());
+
+		ctxt->define(table_name, key_value, metadata);
+
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_4db_undefine")
+	{
+		if
+		(
+			params.size() != 4
+			||
+			params[0].type() != mscript::object::STRING
+			||
+			params[1].type() != mscript::object::STRING
+			//|| object
+			//params[2].type() != mscript::object::STRING
+			||
+			params[3].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 4
-				||
-				params[0].type() != mscript::object::STRING
-				||
-				params[1].type() != mscript::object::STRING
-				//|| object
-				//params[2].type() != mscript::object::STRING
-				||
-				params[3].type() != mscript::object::INDEX
-			)
-			{
-				raiseError("Takes four parameters: the name of the context, the table name, the key value, and an index of name-value pairs");
-			}
-
-			auto ctxt = get4db(params[0].stringVal());
-
-			const std::wstring& table_name = params[1].stringVal();
-			const fourdb::strnum key_value = convert(params[2]);
-			const fourdb::paramap metadata = convert(params[3].indexVal());
-
-			ctxt->define(table_name, key_value, metadata);
-
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes four parameters: the name of the context, the table name, the key value, and the name of the metadata to remove");
 		}
-		else if (funcName == L"msdb_4db_undefine")
+
+		auto ctxt = get4db(params[0].stringVal());
+
+		const std::wstring& table_name = params[1].stringVal();
+		const fourdb::strnum key_value = convert(params[2]);
+		const std::wstring& metadata_name = params[3].stringVal();
+
+		ctxt->undefine(table_name, key_value, metadata_name);
+
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_4db_query")
+	{
+		if
+		(
+			params.size() != 3
+			||
+			params[0].type() != mscript::object::STRING
+			||
+			params[1].type() != mscript::object::STRING
+			||
+			params[2].type() != mscript::object::INDEX
+		)
 		{
-			if
-			(
-				params.size() != 4
-				||
-				params[0].type() != mscript::object::STRING
-				||
-				params[1].type() != mscript::object::STRING
-				//|| object
-				//params[2].type() != mscript::object::STRING
-				||
-				params[3].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes four parameters: the name of the context, the table name, the key value, and the name of the metadata to remove");
-			}
-
-			auto ctxt = get4db(params[0].stringVal());
-
-			const std::wstring& table_name = params[1].stringVal();
-			const fourdb::strnum key_value = convert(params[2]);
-			const std::wstring& metadata_name = params[3].stringVal();
-
-			ctxt->undefine(table_name, key_value, metadata_name);
-
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes three parameters: the name of the context, the SQL query, and an index of name-value parameters");
 		}
-		else if (funcName == L"msdb_4db_query")
+
+		auto ctxt = get4db(params[0].stringVal());
+
+		fourdb::select sql_select = fourdb::sql::parse(params[1].stringVal());
+		const fourdb::paramap query_params = convert(params[2].indexVal());
+		for (const auto& param_it : query_params)
+			sql_select.addParam(param_it.first, param_it.second);
+
+		auto reader = ctxt->execQuery(sql_select);
+		auto results = processDbReader(*reader);
+
+		return results;
+	}
+	else if (funcName == L"msdb_4db_delete")
+	{
+		if
+		(
+			params.size() != 3
+			||
+			params[0].type() != mscript::object::STRING
+			||
+			params[1].type() != mscript::object::STRING
+			//|| object
+			//params[2].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 3
-				||
-				params[0].type() != mscript::object::STRING
-				||
-				params[1].type() != mscript::object::STRING
-				||
-				params[2].type() != mscript::object::INDEX
-			)
-			{
-				raiseError("Takes three parameters: the name of the context, the SQL query, and an index of name-value parameters");
-			}
-
-			auto ctxt = get4db(params[0].stringVal());
-
-			fourdb::select sql_select = fourdb::sql::parse(params[1].stringVal());
-			const fourdb::paramap query_params = convert(params[2].indexVal());
-			for (const auto& param_it : query_params)
-				sql_select.addParam(param_it.first, param_it.second);
-
-			auto reader = ctxt->execQuery(sql_select);
-			auto results = processDbReader(*reader);
-
-			return mscript::module_utils::jsonStr(results);
+			raiseError("Takes three parameters: the name of the context, the table name, and the key value");
 		}
-		else if (funcName == L"msdb_4db_delete")
+
+		auto ctxt = get4db(params[0].stringVal());
+
+		const std::wstring& table_name = params[1].stringVal();
+		const fourdb::strnum key_value = convert(params[2]);
+
+		ctxt->deleteRow(table_name, key_value);
+
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_4db_drop")
+	{
+		if
+		(
+			params.size() != 2
+			||
+			params[0].type() != mscript::object::STRING
+			||
+			params[1].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 3
-				||
-				params[0].type() != mscript::object::STRING
-				||
-				params[1].type() != mscript::object::STRING
-				//|| object
-				//params[2].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes three parameters: the name of the context, the table name, and the key value");
-			}
-
-			auto ctxt = get4db(params[0].stringVal());
-
-			const std::wstring& table_name = params[1].stringVal();
-			const fourdb::strnum key_value = convert(params[2]);
-
-			ctxt->deleteRow(table_name, key_value);
-
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes two parameters: the name of the context, and the table name");
 		}
-		else if (funcName == L"msdb_4db_drop")
+
+		auto ctxt = get4db(params[0].stringVal());
+		const std::wstring& table_name = params[1].stringVal();
+		ctxt->drop(table_name);
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_4db_reset")
+	{
+		if
+		(
+			params.size() != 1
+			||
+			params[0].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 2
-				||
-				params[0].type() != mscript::object::STRING
-				||
-				params[1].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes two parameters: the name of the context, and the table name");
-			}
-
-			auto ctxt = get4db(params[0].stringVal());
-			const std::wstring& table_name = params[1].stringVal();
-			ctxt->drop(table_name);
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes the name of the context to reset");
 		}
-		else if (funcName == L"msdb_4db_reset")
+
+		auto ctxt = get4db(params[0].stringVal());
+		ctxt->reset();
+		return mscript::object();
+	}
+	else if (funcName == L"msdb_4db_get_schema")
+	{
+		if
+		(
+			params.size() != 1
+			||
+			params[0].type() != mscript::object::STRING
+		)
 		{
-			if
-			(
-				params.size() != 1
-				||
-				params[0].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes the name of the context to reset");
-			}
-
-			auto ctxt = get4db(params[0].stringVal());
-			ctxt->reset();
-			return mscript::module_utils::jsonStr(mscript::object());
+			raiseError("Takes the name of the context to get the schema of");
 		}
-		else if (funcName == L"msdb_4db_get_schema")
+
+		auto ctxt = get4db(params[0].stringVal());
+		const auto schema = ctxt->getSchema();
+		mscript::object::index table_schema;
+		for (const auto& tables_it : schema.vec())
 		{
-			if
-			(
-				params.size() != 1
-				||
-				params[0].type() != mscript::object::STRING
-			)
-			{
-				raiseError("Takes the name of the context to get the schema of");
-			}
-
-			auto ctxt = get4db(params[0].stringVal());
-			const auto schema = ctxt->getSchema();
-			mscript::object::index table_schema;
-			for (const auto& tables_it : schema.vec())
-			{
-				const std::wstring& table_name = tables_it.first;
-				mscript::object::list table_columns;
-				table_columns.reserve(tables_it.second->size());
-				for (const std::wstring& col : *tables_it.second)
-					table_columns.push_back(col);
-				table_schema.set(table_name, table_columns);
-			}
-			return mscript::module_utils::jsonStr(table_schema);
+			const std::wstring& table_name = tables_it.first;
+			mscript::object::list table_columns;
+			table_columns.reserve(tables_it.second->size());
+			for (const std::wstring& col : *tables_it.second)
+				table_columns.push_back(col);
+			table_schema.set(table_name, table_columns);
 		}
-		else
-			raiseWError(L"Unknown function");
+		return table_schema;
+	}
+	else
+		raiseWError(L"Unknown function");
+}
+
+wchar_t* mscript_ExecuteFunction(const wchar_t* functionName, const wchar_t* parametersJson)
+{
+	try
+	{
+		auto params = mscript::module_utils::getParams(parametersJson);
+		return mscript::module_utils::jsonStr(executeFunction(functionName, params));
 	}
 	catch (const mscript::user_exception& exp)
 	{
@@ -473,3 +477,29 @@ wchar_t* mscript_ExecuteFunction(const wchar_t* functionName, const wchar_t* par
 		return nullptr;
 	}
 }
+
+void mscript_FreeBinary(unsigned char* data)
+{
+	delete[] data;
+}
+
+unsigned char* mscript_ExecuteFunction2(const wchar_t* functionName, const unsigned char* parameters, size_t parametersLength, size_t* outputLength)
+{
+	try
+	{
+		auto params = mscript::module_utils::getParams(parameters, parametersLength);
+		return mscript::module_utils::binaryResult(executeFunction(functionName, params), outputLength);
+	}
+	catch (const mscript::user_exception& exp)
+	{
+		return mscript::module_utils::errorBinary(functionName, exp, outputLength);
+	}
+	catch (const std::exception& exp)
+	{
+		return mscript::module_utils::errorBinary(functionName, exp, outputLength);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
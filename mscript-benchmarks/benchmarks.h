@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+/// <summary>
+/// Run a script, returning how long it took in seconds and what it output
+/// </summary>
+/// <param name="useBytecode">Run the script in the bytecode engine instead of walking it</param>
+double runScript(const std::wstring& script, std::wstring& output, bool useBytecode = false);
+
+/// <summary>
+/// Each set of benchmarks prints its results and returns false if any fell out of line
+/// </summary>
+bool runCallBenchmarks();
+bool runCollectionBenchmarks();
+bool runMemoryBenchmarks();
+bool runModuleBenchmarks();
+bool runNumberBenchmarks();
+bool runEngineBenchmarks();
+bool runOperatorBenchmarks();
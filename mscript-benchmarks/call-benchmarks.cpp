@@ -0,0 +1,103 @@
+#include "benchmarks.h"
+#include "utils.h"
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace mscript;
+
+// Time scripts that make more and more function calls,
+// and see that the time per call stays flat as the calls add up
+// The function f is called repeat times for each arg
+static bool runCallScaling
+(
+	const char* name,
+	const std::wstring& functionScript,
+	const std::vector<int>& args,
+	int repeat,
+	std::function<double(int)> callCount,
+	std::function<double(int)> result
+)
+{
+	printf("%s\n", name);
+
+	double minCallTime = 0.0;
+	double maxCallTime = 0.0;
+	for (int arg : args)
+	{
+		std::wstring output;
+		std::wstring script =
+			functionScript + L"\n"
+			L"$ result = 0\n"
+			L"++ r : 1 -> " + num2wstr(repeat) + L"\n"
+			L"& result = f(" + num2wstr(arg) + L")\n"
+			L"}\n"
+			L"> result";
+		double seconds = runScript(script, output);
+		if (output != num2wstr(result(arg)))
+		{
+			printf("ERROR: f(%d) output %S\n", arg, output.c_str());
+			return false;
+		}
+
+		double calls = callCount(arg) * repeat;
+		double callTime = seconds * 1e9 / calls;
+		printf("  f(%d): %.0f calls in %.3f s = %.0f ns / call\n", arg, calls, seconds, callTime);
+
+		if (minCallTime == 0.0 || callTime < minCallTime)
+			minCallTime = callTime;
+		if (callTime > maxCallTime)
+			maxCallTime = callTime;
+	}
+
+	// Allow for timing noise, but not for call cost that grows with the calls
+	bool isLinear = maxCallTime < minCallTime * 3.0;
+	printf("  %s\n", isLinear ? "linear" : "ERROR: not linear");
+	return isLinear;
+}
+
+bool runCallBenchmarks()
+{
+	bool success = true;
+
+	std::wstring fibScript =
+		L"~ f(n)\n"
+		L"? n <= 2\n"
+		L"<- 1\n"
+		L"}\n"
+		L"<- f(n - 1) + f(n - 2)\n"
+		L"}";
+	std::function<double(int)> fib = [&fib](int n) { return n <= 2 ? 1.0 : fib(n - 1) + fib(n - 2); };
+	success = runCallScaling
+	(
+		"fib",
+		fibScript,
+		{ 15, 18, 20, 22, 25 },
+		1,
+		[&fib](int n) { return 2.0 * fib(n) - 1.0; },
+		fib
+	) && success;
+
+	// Deep recursion keeps lots of calls on the stack,
+	// which should not make each new call cost more
+	std::wstring sumScript =
+		L"~ f(n)\n"
+		L"? n <= 0\n"
+		L"<- 0\n"
+		L"}\n"
+		L"<- n + f(n - 1)\n"
+		L"}";
+	success = runCallScaling
+	(
+		"deep recursion",
+		sumScript,
+		{ 25, 50, 100, 200 },
+		200,
+		[](int n) { return n + 1.0; },
+		[](int n) { return n * (n + 1) / 2.0; }
+	) && success;
+
+	return success;
+}
@@ -0,0 +1,69 @@
+#include "benchmarks.h"
+#include "utils.h"
+
+#include <cstdio>
+#include <string>
+
+using namespace mscript;
+
+// Time a script that does count operations, reporting the time per operation
+static bool runOperations(const char* name, const std::wstring& script, double count, const std::wstring& expected)
+{
+	std::wstring output;
+	double seconds = runScript(script, output);
+	if (output != expected)
+	{
+		printf("ERROR: %s output %S\n", name, output.c_str());
+		return false;
+	}
+
+	printf("  %s: %.0f ops in %.3f s = %.0f ns / op\n", name, count, seconds, seconds * 1e9 / count);
+	return true;
+}
+
+bool runCollectionBenchmarks()
+{
+	printf("collections\n");
+
+	bool success = true;
+	const int count = 100000;
+
+	// Number keys, then string keys, in a word count
+	success = runOperations
+	(
+		"index set / has / get numbers",
+		L"$ idx = index()\n"
+		L"++ i : 1 -> " + num2wstr(count) + L"\n"
+		L"* idx.set(i, i)\n"
+		L"}\n"
+		L"$ total = 0\n"
+		L"++ i : 1 -> " + num2wstr(count) + L"\n"
+		L"? idx.has(i)\n"
+		L"& total = total + idx.get(i)\n"
+		L"}\n"
+		L"}\n"
+		L"> total",
+		count * 3.0,
+		num2wstr(count * (count + 1.0) / 2.0)
+	) && success;
+
+	success = runOperations
+	(
+		"index word count",
+		L"$ counts = index()\n"
+		L"++ i : 1 -> " + num2wstr(count) + L"\n"
+		L"$ word = \"word\" + (i % 1000)\n"
+		L"? counts.has(word)\n"
+		L"* counts.set(word, counts.get(word) + 1)\n"
+		L"}\n"
+		L"<>\n"
+		L"* counts.set(word, 1)\n"
+		L"}\n"
+		L"}\n"
+		L"> counts.length()",
+		count * 2.5,
+		L"1000"
+	) && success;
+
+	return success;
+}
@@ -0,0 +1,106 @@
+#include "benchmarks.h"
+#include "utils.h"
+
+#include <cstdio>
+#include <string>
+
+using namespace mscript;
+
+// Time a script walking the tree and running bytecode, reporting the speedup
+// Both engines have to produce the same output
+static bool runEngines(const char* name, const std::wstring& script, const std::wstring& expected)
+{
+	std::wstring treeOutput;
+	double treeSeconds = runScript(script, treeOutput, false);
+	if (treeOutput != expected)
+	{
+		printf("ERROR: %s tree walker output %S\n", name, treeOutput.c_str());
+		return false;
+	}
+
+	std::wstring bytecodeOutput;
+	double bytecodeSeconds = runScript(script, bytecodeOutput, true);
+	if (bytecodeOutput != expected)
+	{
+		printf("ERROR: %s bytecode output %S\n", name, bytecodeOutput.c_str());
+		return false;
+	}
+
+	printf("  %s: tree walker %.3f s - bytecode %.3f s = %.2fx\n",
+		   name, treeSeconds, bytecodeSeconds, treeSeconds / bytecodeSeconds);
+	return true;
+}
+
+bool runEngineBenchmarks()
+{
+	printf("engines\n");
+
+	bool success = true;
+	const int count = 1000000;
+
+	success = runEngines
+	(
+		"numeric loop",
+		L"$ total = 0\n"
+		L"++ i : 1 -> " + num2wstr(count) + L"\n"
+		L"? i % 3 = 0 || i % 5 = 0\n"
+		L"& total = total + i\n"
+		L"}\n"
+		L"}\n"
+		L"> total",
+		num2wstr(233334166668.0)
+	) && success;
+
+	success = runEngines
+	(
+		"while loop",
+		L"$ i = 0\n"
+		L"$ total = 0\n"
+		L"O\n"
+		L"& i = i + 1\n"
+		L"? i > " + num2wstr(count) + L"\n"
+		L"v\n"
+		L"}\n"
+		L"& total = total + i * 2\n"
+		L"}\n"
+		L"> total",
+		num2wstr(double(count) * (count + 1.0))
+	) && success;
+
+	success = runEngines
+	(
+		"string building",
+		L"$ str = \"\"\n"
+		L"++ i : 1 -> " + num2wstr(count) + L"\n"
+		L"& str = str + \"x\"\n"
+		L"}\n"
+		L"> length(str)",
+		num2wstr(count)
+	) && success;
+
+	success = runEngines
+	(
+		"report building",
+		L"$ report = \"\"\n"
+		L"++ i : 1 -> 100000\n"
+		L"& report = report + \"line \" + i + crlf\n"
+		L"}\n"
+		L"> length(report)",
+		L"1188895"
+	) && success;
+
+	success = runEngines
+	(
+		"recursive calls",
+		L"~ fib(n)\n"
+		L"? n <= 2\n"
+		L"<- 1\n"
+		L"}\n"
+		L"<- fib(n - 1) + fib(n - 2)\n"
+		L"}\n"
+		L"> fib(27)",
+		L"196418"
+	) && success;
+
+	return success;
+}
@@ -0,0 +1,110 @@
+#include "benchmarks.h"
+#include "object.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+using namespace mscript;
+
+// Count the bytes allocated on the heap, keeping each allocation's size just before it
+static std::atomic<long long> g_heapBytes = 0;
+static const size_t sm_sizePrefix = 16;
+
+void* operator new(size_t size)
+{
+	char* block = static_cast<char*>(malloc(size + sm_sizePrefix));
+	if (block == nullptr)
+		throw std::bad_alloc();
+
+	*reinterpret_cast<size_t*>(block) = size;
+	g_heapBytes += size;
+	return block + sm_sizePrefix;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if (ptr == nullptr)
+		return;
+
+	char* block = static_cast<char*>(ptr) - sm_sizePrefix;
+	g_heapBytes -= *reinterpret_cast<size_t*>(block);
+	free(block);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+// Build a list with count elements, and report the heap and inline bytes per element
+static double measureList(const char* name, size_t count, std::function<object(size_t)> makeElement)
+{
+	long long startBytes = g_heapBytes;
+	double bytesPerElement = 0.0;
+	{
+		object::list list;
+		list.reserve(count);
+		for (size_t e = 0; e < count; ++e)
+			list.push_back(makeElement(e));
+
+		bytesPerElement = double(g_heapBytes - startBytes) / double(count);
+	}
+	printf("  %s: %.1f bytes / element\n", name, bytesPerElement);
+	return bytesPerElement;
+}
+
+// Build an index with count number keys and values, and report the bytes per entry
+static double measureIndex(size_t count)
+{
+	long long startBytes = g_heapBytes;
+	double bytesPerEntry = 0.0;
+	{
+		object::index index;
+		for (size_t e = 0; e < count; ++e)
+			index.set(double(e), double(e));
+
+		bytesPerEntry = double(g_heapBytes - startBytes) / double(count);
+	}
+	printf("  index entries: %.1f bytes / entry\n", bytesPerEntry);
+	return bytesPerEntry;
+}
+
+bool runMemoryBenchmarks()
+{
+	printf("memory\n");
+	printf("  sizeof(object): %d bytes\n", int(sizeof(object)));
+
+	const size_t count = 1000000;
+
+	double numberBytes = measureList("numbers", count, [](size_t e) { return object(double(e)); });
+	measureList("bools", count, [](size_t e) { return object(e % 2 == 0); });
+	measureList("strings", count, [](size_t e) { return object(L"item " + num2wstr(double(e))); });
+	measureList("ASCII strings", count, [](size_t e) { return object::fromUtf8("item " + num2str(double(e))); });
+	measureList("indexes", count / 10, [](size_t e)
+	{
+		object::index index;
+		index.set(toWideStr("name"), L"item " + num2wstr(double(e)));
+		index.set(toWideStr("value"), double(e));
+		return object(index);
+	});
+
+	measureIndex(count);
+
+	// Log lines like readFileLines() gives back, ASCII ones should take half the room or less
+	auto logLine = [](size_t e)
+	{
+		return "2024-01-01 12:00:00 INFO request " + num2str(double(e)) + " served in " + num2str(double(e % 250)) + " ms";
+	};
+	double wideLineBytes = measureList("wide log lines", count, [&](size_t e) { return object(toWideStr(logLine(e))); });
+	double asciiLineBytes = measureList("ASCII log lines", count, [&](size_t e) { return object::fromUtf8(logLine(e)); });
+	printf("  ASCII log lines: %.0f%% smaller\n", 100.0 * (1.0 - asciiLineBytes / wideLineBytes));
+
+	// Numbers live right in the list, no allocations of their own
+	bool isCompact = numberBytes <= 24.0 && asciiLineBytes < wideLineBytes;
+	printf("  %s\n", isCompact ? "compact" : "ERROR: not compact");
+	return isCompact;
+}
@@ -0,0 +1,42 @@
+#include "benchmarks.h"
+#include "object_binary.h"
+#include "object_json.h"
+#include "utils.h"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace mscript;
+
+// Time passing a result set like msdb_sql_exec returns across the module boundary and back,
+// with JSON and with the binary format
+bool runModuleBenchmarks()
+{
+	printf("module calls\n");
+
+	const int rowCount = 10000;
+	object::list rows;
+	rows.push_back(object::list{ toWideStr("id"), toWideStr("name"), toWideStr("size"), toWideStr("path") });
+	for (int r = 0; r < rowCount; ++r)
+	{
+		std::wstring name = L"file" + num2wstr(r);
+		rows.push_back(object::list{ double(r), name, r * 1024.0, L"C:\\files\\" + name });
+	}
+	object result = rows;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	object fromJson = objectFromJson(objectToJson(result));
+	double jsonSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	auto binary = objectToBinary(result);
+	object fromBinary = objectFromBinary(binary.data(), binary.size());
+	double binarySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	printf("  %d rows: JSON %.3f s, binary %.3f s\n", rowCount, jsonSeconds, binarySeconds);
+
+	bool matches = fromJson.toString() == fromBinary.toString();
+	if (!matches)
+		printf("  ERROR: JSON and binary results differ\n");
+	return matches;
+}
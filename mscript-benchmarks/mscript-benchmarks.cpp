@@ -0,0 +1,55 @@
+#include "benchmarks.h"
+#include "includes.h"
+#include "script_processor.h"
+#include "utils.h"
+#pragma comment(lib, "mscript-core")
+#pragma comment(lib, "mscript-lib")
+
+#include <chrono>
+#include <string>
+
+using namespace mscript;
+
+double runScript(const std::wstring& script, std::wstring& output, bool useBytecode)
+{
+	output.clear();
+
+	symbol_table symbols;
+	script_processor
+		processor
+		(
+			[&script](const std::wstring&, const std::wstring&)
+			{
+				return split(script, L"\n");
+			},
+			[](const std::wstring& filename)
+			{
+				return filename;
+			},
+			symbols,
+			[]() { return std::optional<std::wstring>(); },
+			[&output](const std::wstring& text)
+			{
+				output += text;
+			}
+		);
+	processor.setEngine(useBytecode ? script_processor::BYTECODE : script_processor::TREE_WALKER);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	processor.process(std::wstring(), L"benchmark.ms");
+	auto elapsed = std::chrono::high_resolution_clock::now() - start;
+	return std::chrono::duration<double>(elapsed).count();
+}
+
+int main()
+{
+	bool success = true;
+	success = runCallBenchmarks() && success;
+	success = runCollectionBenchmarks() && success;
+	success = runMemoryBenchmarks() && success;
+	success = runModuleBenchmarks() && success;
+	success = runNumberBenchmarks() && success;
+	success = runEngineBenchmarks() && success;
+	success = runOperatorBenchmarks() && success;
+	return success ? 0 : 1;
+}
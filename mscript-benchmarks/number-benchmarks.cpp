@@ -0,0 +1,100 @@
+#include "benchmarks.h"
+#include "utils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace mscript;
+
+static double secondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Format and parse numbers of all sizes, checking the output against the stream formatting
+// that num2wstr used to do, then reporting the time per number
+bool runNumberBenchmarks()
+{
+	printf("numbers\n");
+
+	const size_t count = 10000000;
+	std::vector<double> numbers;
+	numbers.reserve(count);
+	uint64_t seed = 12345;
+	for (size_t n = 0; n < count; ++n)
+	{
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		double fraction = double(seed >> 11) / double(1ULL << 53);
+		switch (n % 4)
+		{
+		case 0: numbers.push_back(double(int64_t(seed >> 40) - (1LL << 23))); break; // whole numbers
+		case 1: numbers.push_back(fraction * 1000.0); break;
+		case 2: numbers.push_back((fraction - 0.5) * 1e-8); break;
+		default: numbers.push_back(fraction * 1e22); break;
+		}
+	}
+
+	bool success = true;
+	for (size_t n = 0; n < count; n += 997)
+	{
+		std::wstringstream ss;
+		ss << std::setprecision(10) << numbers[n];
+		if (ss.str() != num2wstr(numbers[n]))
+		{
+			printf("  ERROR: %S formatted as %S\n", ss.str().c_str(), num2wstr(numbers[n]).c_str());
+			success = false;
+			break;
+		}
+	}
+
+	const size_t streamCount = count / 10;
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t streamLength = 0;
+	for (size_t n = 0; n < streamCount; ++n)
+	{
+		std::wstringstream ss;
+		ss << std::setprecision(10) << numbers[n];
+		streamLength += ss.str().size();
+	}
+	double streamSeconds = secondsSince(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	size_t charsLength = 0;
+	wchar_t chars[maxNumberLength];
+	for (double number : numbers)
+		charsLength += num2chars(number, chars);
+	double charsSeconds = secondsSince(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	std::vector<std::wstring> strs;
+	strs.reserve(count);
+	for (double number : numbers)
+		strs.push_back(num2wstr(number));
+	double wstrSeconds = secondsSince(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	size_t roundTrips = 0;
+	for (size_t n = 0; n < count; ++n)
+	{
+		double parsed;
+		if (parseNumber(strs[n], parsed) && num2wstr(parsed) == strs[n])
+			++roundTrips;
+	}
+	double parseSeconds = secondsSince(start);
+
+	printf("  stream formatting: %.1f ns / number (%zu chars)\n", streamSeconds * 1e9 / streamCount, streamLength);
+	printf("  num2chars: %.1f ns / number (%zu chars)\n", charsSeconds * 1e9 / count, charsLength);
+	printf("  num2wstr: %.1f ns / number\n", wstrSeconds * 1e9 / count);
+	printf("  parseNumber and back: %.1f ns / number\n", parseSeconds * 1e9 / count);
+
+	if (roundTrips != count)
+	{
+		printf("  ERROR: %zu of %zu numbers did not parse back the same\n", count - roundTrips, count);
+		success = false;
+	}
+	return success;
+}
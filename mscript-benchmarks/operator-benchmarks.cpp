@@ -0,0 +1,62 @@
+#include "benchmarks.h"
+#include "utils.h"
+
+#include <cstdio>
+#include <string>
+
+using namespace mscript;
+
+// Time a loop of arithmetic, reporting the time per iteration in each engine
+static bool runArithmetic(const char* name, const std::wstring& script, double count, const std::wstring& expected)
+{
+	for (bool useBytecode : { false, true })
+	{
+		std::wstring output;
+		double seconds = runScript(script, output, useBytecode);
+		if (output != expected)
+		{
+			printf("ERROR: %s output %S\n", name, output.c_str());
+			return false;
+		}
+
+		printf("  %s (%s): %.0f iterations in %.3f s = %.1f ns / iteration\n",
+			   name, useBytecode ? "bytecode" : "tree walker", count, seconds, seconds * 1e9 / count);
+	}
+	return true;
+}
+
+bool runOperatorBenchmarks()
+{
+	printf("operators\n");
+
+	bool success = true;
+	const int count = 10000000;
+
+	success = runArithmetic
+	(
+		"sum + i * 2",
+		L"$ sum = 0\n"
+		L"++ i : 1 -> " + num2wstr(count) + L"\n"
+		L"& sum = sum + i * 2\n"
+		L"}\n"
+		L"> sum",
+		count,
+		num2wstr(double(count) * (count + 1.0))
+	) && success;
+
+	success = runArithmetic
+	(
+		"comparisons",
+		L"$ hits = 0\n"
+		L"++ i : 1 -> " + num2wstr(count) + L"\n"
+		L"? i % 7 = 0 && i >= 100\n"
+		L"& hits = hits + 1\n"
+		L"}\n"
+		L"}\n"
+		L"> hits",
+		count,
+		num2wstr(double(count / 7 - 14))
+	) && success;
+
+	return success;
+}
@@ -61,4 +61,33 @@ namespace mscript
 		std::wstring errorStr = L"mscript EXCEPTION ~~~ mscript_ExecuteFunction: " + function + L": " + toWideStr(exp.what());
 		return module_utils::jsonStr(errorStr);
 	}
+
+	object::list module_utils::getParams(const unsigned char* parameters, size_t parametersLength)
+	{
+		object obj = objectFromBinary(parameters, parametersLength);
+		if (obj.type() == object::LIST)
+			return obj.listVal();
+		else
+			return object::list{ obj };
+	}
+
+	unsigned char* module_utils::binaryResult(const object& obj, size_t* outputLength)
+	{
+		const std::vector<unsigned char> binary = objectToBinary(obj);
+		unsigned char* output = new unsigned char[binary.size()];
+		memcpy(output, binary.data(), binary.size());
+		*outputLength = binary.size();
+		return output;
+	}
+
+	unsigned char* module_utils::errorBinary(const std::wstring& function, const user_exception& exp, size_t* outputLength)
+	{
+		return module_utils::errorBinary(function, std::runtime_error(toNarrowStr(exp.obj.toString()).c_str()), outputLength);
+	}
+
+	unsigned char* module_utils::errorBinary(const std::wstring& function, const std::exception& exp, size_t* outputLength)
+	{
+		std::wstring errorStr = L"mscript EXCEPTION ~~~ mscript_ExecuteFunction: " + function + L": " + toWideStr(exp.what());
+		return module_utils::binaryResult(errorStr, outputLength);
+	}
 }
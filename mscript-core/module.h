@@ -5,14 +5,29 @@
 #endif
 
 #include "object.h"
+#include "object_binary.h"
 #include "object_json.h"
 #include "utils.h"
 
+// Modules are DLLs on Windows and shared objects elsewhere
+#if defined(_WIN32) || defined(_WIN64)
+#define MSCRIPT_EXPORT __declspec(dllexport)
+#define MSCRIPT_CALL __cdecl
+#else
+#define MSCRIPT_EXPORT __attribute__((visibility("default")))
+#define MSCRIPT_CALL
+#endif
+
 extern "C"
 {
-	__declspec(dllexport) wchar_t* __cdecl mscript_GetExports();
-	__declspec(dllexport) void __cdecl mscript_FreeString(wchar_t* str);
-	__declspec(dllexport) wchar_t* __cdecl mscript_ExecuteFunction(const wchar_t* functionName, const wchar_t* parametersJson);
+	MSCRIPT_EXPORT wchar_t* MSCRIPT_CALL mscript_GetExports();
+	MSCRIPT_EXPORT void MSCRIPT_CALL mscript_FreeString(wchar_t* str);
+	MSCRIPT_EXPORT wchar_t* MSCRIPT_CALL mscript_ExecuteFunction(const wchar_t* functionName, const wchar_t* parametersJson);
+
+	// Modules can also export these to get parameters and return results in the binary format,
+	// which mscript uses instead of mscript_ExecuteFunction if both are exported
+	MSCRIPT_EXPORT unsigned char* MSCRIPT_CALL mscript_ExecuteFunction2(const wchar_t* functionName, const unsigned char* parameters, size_t parametersLength, size_t* outputLength);
+	MSCRIPT_EXPORT void MSCRIPT_CALL mscript_FreeBinary(unsigned char* data);
 }
 
 namespace mscript
@@ -33,6 +48,13 @@ namespace mscript
 		static wchar_t* errorStr(const std::wstring& function, const user_exception& exp);
 		static wchar_t* errorStr(const std::wstring& function, const std::exception& exp);
 
+		static object::list getParams(const unsigned char* parameters, size_t parametersLength);
+
+		static unsigned char* binaryResult(const object& obj, size_t* outputLength);
+
+		static unsigned char* errorBinary(const std::wstring& function, const user_exception& exp, size_t* outputLength);
+		static unsigned char* errorBinary(const std::wstring& function, const std::exception& exp, size_t* outputLength);
+
 	private:
 		module_utils() = delete;
 		module_utils(const module_utils&) = delete;
@@ -2,14 +2,260 @@
 #include "object.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+// Mix one hash into another, the golden ratio spreads out the bits
+static const size_t sm_hashMixer = size_t(0x9E3779B97F4A7C15ULL);
+static size_t hashCombine(size_t hash, size_t more)
+{
+	return hash ^ (more + sm_hashMixer + (hash << 6) + (hash >> 2));
+}
+
+// Strings hash by their characters, FNV-1a style,
+// so ASCII strings hash the same as wide strings with the same characters
+template <typename CharT>
+static size_t hashChars(std::basic_string_view<CharT> chars)
+{
+	size_t hash = size_t(mscript::object::STRING) * sm_hashMixer;
+	for (CharT c : chars)
+		hash = (hash ^ size_t(c)) * size_t(0x100000001B3ULL);
+	return hash;
+}
+
 // Finish up the custom hasher for the object type
+// Numbers that are equal with rounding have to hash the same,
+// and they format the same, so the formatted number is what gets hashed
 std::size_t std::hash<mscript::object>::operator()(const mscript::object& obj) const
 {
-	return std::hash<std::wstring>()(obj.toString());
+	using namespace mscript;
+
+	size_t typeHash = size_t(obj.type()) * sm_hashMixer;
+	switch (obj.type())
+	{
+	case object::NOTHING:
+		return typeHash;
+
+	case object::NUMBER:
+	{
+		double number = obj.numberVal();
+		if (number == 0.0) // -0 equals 0 but formats as -0
+			number = 0.0;
+		char chars[maxNumberLength];
+		size_t length = num2chars(number, chars);
+		return typeHash ^ hashChars<char>(std::string_view(chars, length));
+	}
+
+	case object::STRING:
+		if (obj.isAsciiString())
+			return hashChars<char>(obj.asciiVal());
+		return hashChars<wchar_t>(obj.stringVal());
+
+	case object::BOOL:
+		return typeHash ^ std::hash<bool>()(obj.boolVal());
+
+	case object::LIST:
+	{
+		size_t hash = typeHash;
+		for (const auto& elem : obj.listVal())
+			hash = hashCombine(hash, operator()(elem));
+		return hash;
+	}
+
+	case object::INDEX:
+	{
+		size_t hash = typeHash;
+		for (const auto& kvp : obj.indexVal().vec())
+		{
+			hash = hashCombine(hash, operator()(kvp.first));
+			hash = hashCombine(hash, operator()(kvp.second));
+		}
+		return hash;
+	}
+
+	case object::RANGE:
+	{
+		// Ranges equal lists with the same numbers, so they hash like those lists
+		size_t hash = size_t(object::LIST) * sm_hashMixer;
+		const auto& range = obj.rangeVal();
+		for (size_t i = 0; i < range.count; ++i)
+			hash = hashCombine(hash, operator()(object(range.at(i))));
+		return hash;
+	}
+
+	default:
+		raiseError("Invalid object type for hash: " + num2str(int(obj.type())));
+	}
+}
+
+std::size_t std::hash<mscript::object>::operator()(const std::wstring& str) const
+{
+	return hashChars<wchar_t>(str);
 }
 
 namespace mscript
 {
+	// ASCII and wide strings compare by their characters, the ASCII ones without being widened
+	struct string_chars_equal
+	{
+		template <typename Left, typename Right>
+		bool operator()(const Left& left, const Right& right) const
+		{
+			return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin(),
+				[](auto leftChar, auto rightChar) { return unsigned(leftChar) == unsigned(rightChar); });
+		}
+	};
+
+	struct string_chars_less
+	{
+		template <typename Left, typename Right>
+		bool operator()(const Left& left, const Right& right) const
+		{
+			return std::lexicographical_compare(left.begin(), left.end(), right.begin(), right.end(),
+				[](auto leftChar, auto rightChar) { return leftChar < rightChar; });
+		}
+	};
+
+	object object::fromUtf8(std::string_view utf8)
+	{
+		if (!isAscii(utf8))
+			return toWideStr(utf8);
+
+		object str;
+		str.m_heap = new heap_value<string_heap>(string_chars(std::string(utf8)));
+		str.m_type = STRING;
+		return str;
+	}
+
+	object object::fromUtf8(std::string&& utf8)
+	{
+		if (!isAscii(utf8))
+			return toWideStr(utf8);
+
+		object str;
+		str.m_heap = new heap_value<string_heap>(string_chars(std::move(utf8)));
+		str.m_type = STRING;
+		return str;
+	}
+
+	object object::fromWide(std::wstring_view str)
+	{
+		if (!isAscii(str))
+			return std::wstring(str);
+
+		std::string ascii;
+		ascii.reserve(str.size());
+		for (wchar_t c : str)
+			ascii += char(c);
+
+		object asciiStr;
+		asciiStr.m_heap = new heap_value<string_heap>(string_chars(std::move(ascii)));
+		asciiStr.m_type = STRING;
+		return asciiStr;
+	}
+
+	object object::fromWide(std::wstring&& str)
+	{
+		if (!isAscii(str))
+			return std::move(str);
+		return fromWide(std::wstring_view(str));
+	}
+
+	object::object(object_type objType)
+		: m_type(objType)
+	{
+		switch (m_type)
+		{
+		case STRING:
+			m_heap = new heap_value<string_heap>(string_chars());
+			break;
+		case LIST:
+			m_heap = new heap_value<list_heap>(list_heap(list()));
+			break;
+		case INDEX:
+			m_heap = new heap_value<index_heap>(index_heap(index()));
+			break;
+		case RANGE:
+			m_heap = new heap_value<range>(range());
+			break;
+		default:
+			break;
+		}
+	}
+
+	void object::freeHeap()
+	{
+		switch (m_type)
+		{
+		case STRING:
+			delete static_cast<heap_value<string_heap>*>(m_heap);
+			break;
+		case LIST:
+			delete static_cast<heap_value<list_heap>*>(m_heap);
+			break;
+		case INDEX:
+			delete static_cast<heap_value<index_heap>*>(m_heap);
+			break;
+		case RANGE:
+			delete static_cast<heap_value<range>*>(m_heap);
+			break;
+		default:
+			break;
+		}
+	}
+
+	object::string_chars& object::stringToChange()
+	{
+		if (m_heap->isShared())
+		{
+			heap_base* copy = new heap_value<string_heap>(heapVal<string_heap>());
+			release();
+			m_heap = copy;
+		}
+		return heapVal<string_heap>().getToChange();
+	}
+
+	std::wstring& object::stringVal()
+	{
+		validateType(STRING);
+		string_chars& chars = stringToChange();
+		if (const std::string* ascii = std::get_if<std::string>(&chars))
+			chars = std::wstring(ascii->begin(), ascii->end());
+		return std::get<std::wstring>(chars);
+	}
+
+	const std::wstring& object::string_heap::widened() const
+	{
+		// Every object sharing the string gets the same wide one,
+		// if two widen it at once, the first one in is kept
+		std::wstring* wide = m_wide.load(std::memory_order_acquire);
+		if (wide != nullptr)
+			return *wide;
+
+		const std::string& ascii = std::get<std::string>(m_chars);
+		std::wstring* widening = new std::wstring(ascii.begin(), ascii.end());
+		if (m_wide.compare_exchange_strong(wide, widening, std::memory_order_acq_rel, std::memory_order_acquire))
+			return *widening;
+
+		delete widening;
+		return *wide;
+	}
+
+	const std::string& object::asciiVal() const
+	{
+		if (!isAsciiString())
+			raiseError("Invalid type access: ASCII string, should be " + (m_type == STRING ? std::string("wide string") : typeStr()));
+		return std::get<std::string>(heapVal<string_heap>().get());
+	}
+
+	std::string& object::asciiVal()
+	{
+		std::as_const(*this).asciiVal(); // validate
+		return std::get<std::string>(stringToChange());
+	}
+
 	object object::clone() const
 	{
 		switch (m_type)
@@ -18,7 +264,7 @@ namespace mscript
 			return object();
 
 		case STRING:
-			return m_string;
+			return *this; // strings are copied on write
 
 		case NUMBER:
 			return m_number;
@@ -28,26 +274,57 @@ namespace mscript
 
 		case LIST:
 		{
+			// Changes to lists and indexes inside would show through both, so those get cloned now
+			const list& items = listVal();
+			if (std::none_of(items.begin(), items.end(), [](const object& obj) { return obj.isContainer(); }))
+				return copyValue();
+
 			object::list retVal;
-			retVal.reserve(m_list->size());
-			for (const auto& obj : *m_list)
+			retVal.reserve(items.size());
+			for (const auto& obj : items)
 				retVal.push_back(obj.clone());
 			return retVal;
 		}
 
 		case INDEX:
 		{
+			const auto& items = indexVal().vec();
+			if (std::none_of(items.begin(), items.end(), [](const auto& kvp) { return kvp.first.isContainer() || kvp.second.isContainer(); }))
+				return copyValue();
+
 			object::index retVal;
-			for (const auto& kvp : m_index->vec())
+			retVal.reserve(items.size());
+			for (const auto& kvp : items)
 				retVal.set(kvp.first.clone(), kvp.second.clone());
 			return retVal;
 		}
 
+		case RANGE:
+			return *this; // ranges never change, so sharing is as good as copying
+
 		default:
 			raiseError("Invalid object type for clone(): " + num2str(int(m_type)));
 		}
 	}
 
+	object object::copyValue() const
+	{
+		object copy;
+		switch (m_type)
+		{
+		case LIST:
+			copy.m_heap = new heap_value<list_heap>(heapVal<list_heap>());
+			break;
+		case INDEX:
+			copy.m_heap = new heap_value<index_heap>(heapVal<index_heap>());
+			break;
+		default:
+			return *this;
+		}
+		copy.m_type = m_type;
+		return copy;
+	}
+
 	std::wstring object::toString() const
 	{
 		switch (m_type)
@@ -56,7 +333,7 @@ namespace mscript
 			return L"null";
 
 		case STRING:
-			return m_string;
+			return std::visit([](const auto& chars) { return std::wstring(chars.begin(), chars.end()); }, heapVal<string_heap>().get());
 
 		case NUMBER:
 			return num2wstr(m_number);
@@ -67,8 +344,8 @@ namespace mscript
 		case LIST:
 		{
 			std::vector<std::wstring> listStrs;
-			listStrs.reserve(m_list->size());
-			for (const auto& obj : *m_list)
+			listStrs.reserve(listVal().size());
+			for (const auto& obj : listVal())
 				listStrs.push_back(obj.toString());
 			return L"[" + join(listStrs, L", ") + L"]";
 		}
@@ -76,12 +353,22 @@ namespace mscript
 		case INDEX:
 		{
 			std::vector<std::wstring> indexStrs;
-			indexStrs.reserve(m_index->size());
-			for (const auto& kvp : m_index->vec())
+			indexStrs.reserve(indexVal().size());
+			for (const auto& kvp : indexVal().vec())
 				indexStrs.push_back(kvp.first.toString() + L": " + kvp.second.toString());
 			return L"{" + join(indexStrs, L", ") + L"}";
 		}
 
+		case RANGE:
+		{
+			const auto& range = heapVal<object::range>();
+			std::vector<std::wstring> rangeStrs;
+			rangeStrs.reserve(range.count);
+			for (size_t i = 0; i < range.count; ++i)
+				rangeStrs.push_back(num2wstr(range.at(i)));
+			return L"[" + join(rangeStrs, L", ") + L"]";
+		}
+
 		default:
 			raiseError("Invalid object type for toString(): " + num2str(int(m_type)));
 		}
@@ -91,7 +378,14 @@ namespace mscript
 	{
 		switch (m_type)
 		{
-		case STRING: return std::stod(m_string.c_str());
+		case STRING:
+		{
+			std::wstring str = toString();
+			double number;
+			if (!parseNumber(str, number))
+				raiseWError(L"Cannot convert to number: " + str);
+			return number;
+		}
 		case NUMBER: return m_number;
 		case BOOL: return m_bool ? 1.0 : 0.0;
 		default: raiseError("Cannot convert to number: " + typeStr());
@@ -102,9 +396,10 @@ namespace mscript
 	{
 		switch (m_type)
 		{
-		case STRING: return m_string.length();
-		case LIST: return m_list->size();
-		case INDEX: return m_index->size();
+		case STRING: return std::visit([](const auto& chars) { return chars.size(); }, heapVal<string_heap>().get());
+		case LIST: return listVal().size();
+		case INDEX: return indexVal().size();
+		case RANGE: return heapVal<range>().count;
 		default: raiseError("Invalid type for length(): " + typeStr());
 		}
 	}
@@ -125,6 +420,8 @@ namespace mscript
 			return "list";
 		case INDEX:
 			return "index";
+		case RANGE:
+			return "range";
 		default:
 			raiseError("Invalid type: " + num2str(int(typeVal)));
 		}
@@ -136,11 +433,36 @@ namespace mscript
 			raiseError("Invalid type access: " + getTypeName(shouldBe) + ", should be " + getTypeName(m_type));
 	}
 
+	object object::elementAt(size_t idx) const
+	{
+		if (m_type == RANGE)
+			return heapVal<range>().at(idx);
+		else
+			return listVal()[idx];
+	}
+
 	bool object::operator==(const object& other) const
 	{
 		if (m_type == NOTHING || other.m_type == NOTHING)
 			return m_type == other.m_type; // if both null, match, otherwise fail
 		
+		// Ranges compare like lists of their numbers, with lists and with each other
+		if (m_type == RANGE || other.m_type == RANGE)
+		{
+			if (m_type != other.m_type && m_type != LIST && other.m_type != LIST)
+				raiseError("Type mismatch for equality comparison: " + typeStr() + " and " + other.typeStr());
+
+			size_t count = length();
+			if (count != other.length())
+				return false;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (elementAt(i) != other.elementAt(i))
+					return false;
+			}
+			return true;
+		}
+
 		if (m_type != other.m_type)
 			raiseError("Type mismatch for equality comparison: " + typeStr() + " and " + other.typeStr());
 		
@@ -152,12 +474,17 @@ namespace mscript
 				return true;
 			else if (int64_t(m_number) != int64_t(other.m_number))
 				return false;
-			else
-				return num2str(m_number) == num2str(other.m_number); // handle rounding
+			else // handle rounding
+			{
+				char chars[maxNumberLength], otherChars[maxNumberLength];
+				size_t length = num2chars(m_number, chars);
+				size_t otherLength = num2chars(other.m_number, otherChars);
+				return length == otherLength && memcmp(chars, otherChars, length) == 0;
+			}
 		}
 		case STRING:
 		{
-			return m_string == other.m_string;
+			return std::visit(string_chars_equal(), heapVal<string_heap>().get(), other.heapVal<string_heap>().get());
 		}
 		case BOOL:
 		{
@@ -165,8 +492,8 @@ namespace mscript
 		}
 		case LIST:
 		{
-			const auto& list1 = *m_list;
-			const auto& list2 = *other.m_list;
+			const auto& list1 = listVal();
+			const auto& list2 = other.listVal();
 			if (list1.size() != list2.size())
 				return false;
 			for (size_t i = 0; i < list1.size(); ++i)
@@ -178,8 +505,8 @@ namespace mscript
 		}
 		case INDEX:
 		{
-			const auto& keys1 = m_index->vec();
-			const auto& keys2 = other.m_index->vec();
+			const auto& keys1 = indexVal().vec();
+			const auto& keys2 = other.indexVal().vec();
 			if (keys1.size() != keys2.size())
 				return false;
 			for (size_t i = 0; i < keys1.size(); ++i)
@@ -197,6 +524,13 @@ namespace mscript
 		}
 	}
 
+	bool object::operator==(const std::wstring& str) const
+	{
+		if (m_type != STRING)
+			return false;
+		return std::visit([&str](const auto& chars) { return string_chars_equal()(chars, str); }, heapVal<string_heap>().get());
+	}
+
 	bool object::operator<(const object& other) const
 	{
 		if (m_type != other.m_type)
@@ -207,7 +541,7 @@ namespace mscript
 		case NUMBER:
 			return m_number < other.m_number;
 		case STRING:
-			return m_string < other.m_string;
+			return std::visit(string_chars_less(), heapVal<string_heap>().get(), other.heapVal<string_heap>().get());
 		default:
 			raiseError("Invalid type for comparison: " + typeStr());
 		}
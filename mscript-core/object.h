@@ -2,9 +2,13 @@
 
 #include "vectormap.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 
 #pragma warning(disable: 26812) // enum 
@@ -21,6 +25,7 @@ namespace std
 	struct hash<mscript::object>
 	{
 		std::size_t operator()(const mscript::object& obj) const;
+		std::size_t operator()(const std::wstring& str) const; // same as a string object
 	};
 }
 
@@ -37,7 +42,20 @@ namespace mscript
 		typedef std::vector<object> list;
 		typedef vectormap<object, object> index;
 
-		// Who needs more than five kinds of things...and nulls?
+		/// <summary>
+		/// A range is the numbers from, from + step, from + 2 * step...
+		/// computed as needed, so a range of any length takes the same memory
+		/// </summary>
+		struct range
+		{
+			double from = 0.0;
+			double step = 1.0;
+			size_t count = 0;
+
+			double at(size_t idx) const { return from + step * double(idx); }
+		};
+
+		// Who needs more than six kinds of things...and nulls?
 		enum object_type
 		{
 			NOTHING,
@@ -45,39 +63,119 @@ namespace mscript
 			STRING,
 			BOOL,
 			LIST,
-			INDEX
+			INDEX,
+			RANGE
 		};
 
 		// A constructor for each type of object
-		object(object_type objType = NOTHING)
-			: m_type(objType)
-		{}
+		// Strings, lists, and indexes get an empty value, not a null one
+		object(object_type objType = NOTHING);
 		object(double number)
 			: m_type(NUMBER)
 			, m_number(number)
 		{}
 		object(const std::wstring& stringVal)
 			: m_type(STRING)
-			, m_string(stringVal)
+			, m_heap(new heap_value<string_heap>(string_chars(stringVal)))
+		{}
+		object(std::wstring&& stringVal)
+			: m_type(STRING)
+			, m_heap(new heap_value<string_heap>(string_chars(std::move(stringVal))))
 		{}
 		object(bool boolVal)
 			: m_type(BOOL)
-			, m_bool(boolVal)
-		{}
+		{
+			m_bool = boolVal;
+		}
 		object(const list& listVal)
 			: m_type(LIST)
-			, m_list(std::make_shared<list>(listVal))
+			, m_heap(new heap_value<list_heap>(list_heap(listVal)))
+		{}
+		object(list&& listVal)
+			: m_type(LIST)
+			, m_heap(new heap_value<list_heap>(list_heap(std::move(listVal))))
 		{}
 		object(const index& indexVal)
 			: m_type(INDEX)
-			, m_index(std::make_shared<index>(indexVal))
+			, m_heap(new heap_value<index_heap>(index_heap(indexVal)))
+		{}
+		object(index&& indexVal)
+			: m_type(INDEX)
+			, m_heap(new heap_value<index_heap>(index_heap(std::move(indexVal))))
 		{}
+		object(const range& rangeVal)
+			: m_type(RANGE)
+			, m_heap(new heap_value<range>(rangeVal))
+		{}
+
+		// Copying shares any heap value, moving takes it
+		// So copies of a list or index are the same list or index, changes and all
+		object(const object& other)
+			: m_type(other.m_type)
+			, m_bits(other.m_bits)
+		{
+			if (isHeapType())
+				m_heap->addRef();
+		}
+		object(object&& other) noexcept
+			: m_type(other.m_type)
+			, m_bits(other.m_bits)
+		{
+			other.m_type = NOTHING;
+		}
+		object& operator=(const object& other)
+		{
+			if (other.isHeapType())
+				other.m_heap->addRef();
+			release();
+			m_type = other.m_type;
+			m_bits = other.m_bits;
+			return *this;
+		}
+		object& operator=(object&& other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				m_type = other.m_type;
+				m_bits = other.m_bits;
+				other.m_type = NOTHING;
+			}
+			return *this;
+		}
+		~object()
+		{
+			release();
+		}
+
+		/// <summary>
+		/// Make a string from UTF-8, like text read from files and commands
+		/// All-ASCII text is kept a byte a character, see isAsciiString()
+		/// </summary>
+		static object fromUtf8(std::string_view utf8);
+		static object fromUtf8(std::string&& utf8);
+
+		/// <summary>
+		/// Make a string from wide characters, kept a byte a character if they're all ASCII
+		/// </summary>
+		static object fromWide(std::wstring_view str);
+		static object fromWide(std::wstring&& str);
 
 		/// <summary>
 		/// clone() creates a deep copy of this
+		/// Lists and indexes without lists or indexes in them share their items
+		/// with the clone until one of them changes
 		/// </summary>
 		object clone() const;
 
+		/// <summary>
+		/// copyValue() creates a copy of this list or index that does not share changes
+		/// with this one, but shares the items inside, like a shallow copy
+		/// The items are only copied when one side changes, so this is cheap until then
+		/// Other types are returned as is
+		/// </summary>
+		object copyValue() const;
+
 		object_type type() const { return m_type; }
 		std::string typeStr() const { return getTypeName(m_type); }
 
@@ -91,21 +189,46 @@ namespace mscript
 
 		double numberVal() const { validateType(NUMBER); return m_number; }
 
-		const std::wstring& stringVal() const { validateType(STRING); return m_string; }
-		std::wstring& stringVal() { validateType(STRING); return m_string; }
+		// ASCII strings are widened the first time they're needed as a std::wstring,
+		// once for every object that shares them, and stay ASCII strings
+		const std::wstring& stringVal() const
+		{
+			validateType(STRING);
+			const string_heap& str = heapVal<string_heap>();
+			const std::wstring* wide = std::get_if<std::wstring>(&str.get());
+			return wide != nullptr ? *wide : str.widened();
+		}
+		std::wstring& stringVal(); // strings are values, so this makes a copy to change if shared
+
+		/// <summary>
+		/// Is this a string kept a byte a character, because it only has ASCII characters
+		/// Strings from files, commands, JSON, and script literals are kept like this,
+		/// and stay like this until something needs them as a std::wstring
+		/// </summary>
+		bool isAsciiString() const { return m_type == STRING && std::holds_alternative<std::string>(heapVal<string_heap>().get()); }
+
+		// the characters of an ASCII string, good until the string is changed
+		const std::string& asciiVal() const;
+		std::string& asciiVal(); // makes a copy to change if shared, like stringVal()
 
 		bool boolVal() const { validateType(BOOL); return m_bool; }
 
-		const list& listVal() const { validateType(LIST); return *m_list; }
-		list& listVal() { validateType(LIST); return *m_list; }
+		// the non-const versions are for making changes, so they copy the items if copyValue() shares them
+		const list& listVal() const { validateType(LIST); return heapVal<list_heap>().get(); }
+		list& listVal() { validateType(LIST); return heapVal<list_heap>().getToChange(); }
 
-		const index& indexVal() const { validateType(INDEX); return *m_index; }
-		index& indexVal() { validateType(INDEX); return *m_index; }
+		const index& indexVal() const { validateType(INDEX); return heapVal<index_heap>().get(); }
+		index& indexVal() { validateType(INDEX); return heapVal<index_heap>().getToChange(); }
+
+		const range& rangeVal() const { validateType(RANGE); return heapVal<range>(); } // ranges never change
 
 		// unordered...
 		bool operator==(const object& other) const;
 		bool operator!=(const object& other) const { return !operator==(other); }
 
+		// for looking up string keys without making objects, not a type mismatch if not a string
+		bool operator==(const std::wstring& str) const;
+
 		// sort
 		bool operator<(const object& other) const;
 		bool operator<=(const object& other) const { return *this < other || *this == other; }
@@ -115,15 +238,131 @@ namespace mscript
 	private:
 		void validateType(object_type shouldBe) const;
 
+		// an item of a list or a range
+		object elementAt(size_t idx) const;
+
+		bool isContainer() const { return m_type == LIST || m_type == INDEX; }
+
+		// A string's characters, a byte each if they're all ASCII
+		typedef std::variant<std::wstring, std::string> string_chars;
+		string_chars& stringToChange();
+
+		/// <summary>
+		/// Strings, lists, indexes, and ranges live on the heap with a reference count,
+		/// so an object is just its type and one number, bool, or pointer
+		/// </summary>
+		struct heap_base
+		{
+			void addRef() { m_refCount.fetch_add(1, std::memory_order_relaxed); }
+			bool releaseRef() { return m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+			bool isShared() const { return m_refCount.load(std::memory_order_acquire) > 1; }
+
+		private:
+			std::atomic<unsigned> m_refCount{ 1 };
+		};
+
+		template <typename T>
+		struct heap_value : public heap_base
+		{
+			heap_value(const T& _value) : value(_value) {}
+			heap_value(T&& _value) : value(std::move(_value)) {}
+			T value;
+		};
+
+		/// <summary>
+		/// Lists and indexes are one more step away, so copyValue() and clone()
+		/// can share the items between objects that don't share changes,
+		/// and whichever changes first gets its own copy of the items
+		/// </summary>
+		template <typename T>
+		struct cow_container
+		{
+			cow_container(const T& value) : m_items(new heap_value<T>(value)) {}
+			cow_container(T&& value) : m_items(new heap_value<T>(std::move(value))) {}
+			cow_container(const cow_container& other) : m_items(other.m_items) { m_items->addRef(); }
+			cow_container(cow_container&& other) noexcept : m_items(other.m_items) { other.m_items = nullptr; }
+			cow_container& operator=(const cow_container&) = delete;
+			~cow_container()
+			{
+				if (m_items != nullptr && m_items->releaseRef())
+					delete m_items;
+			}
+
+			const T& get() const { return m_items->value; }
+			T& getToChange()
+			{
+				if (m_items->isShared())
+				{
+					heap_value<T>* copy = new heap_value<T>(m_items->value);
+					if (m_items->releaseRef())
+						delete m_items;
+					m_items = copy;
+				}
+				return m_items->value;
+			}
+
+		private:
+			heap_value<T>* m_items;
+		};
+		typedef cow_container<list> list_heap;
+		typedef cow_container<index> index_heap;
+
+		/// <summary>
+		/// Strings keep the wide form of an ASCII string beside the ASCII characters,
+		/// made the first time stringVal() needs it and never in place of them,
+		/// so asciiVal() stays good, and objects sharing the string can widen it at the same time
+		/// </summary>
+		struct string_heap
+		{
+			string_heap(string_chars&& chars) : m_chars(std::move(chars)) {}
+			string_heap(const string_heap& other) : m_chars(other.m_chars) {}
+			string_heap(string_heap&& other) noexcept : m_chars(std::move(other.m_chars)) {}
+			string_heap& operator=(const string_heap&) = delete;
+			~string_heap() { delete m_wide.load(std::memory_order_acquire); }
+
+			const string_chars& get() const { return m_chars; }
+			string_chars& getToChange()
+			{
+				delete m_wide.exchange(nullptr, std::memory_order_acq_rel);
+				return m_chars;
+			}
+
+			const std::wstring& widened() const;
+
+		private:
+			string_chars m_chars;
+			mutable std::atomic<std::wstring*> m_wide{ nullptr };
+		};
+
+		bool isHeapType() const
+		{
+			return m_type == STRING || m_type == LIST || m_type == INDEX || m_type == RANGE;
+		}
+
+		template <typename T>
+		T& heapVal() const
+		{
+			return static_cast<heap_value<T>*>(m_heap)->value;
+		}
+
+		void release()
+		{
+			if (isHeapType() && m_heap->releaseRef())
+				freeHeap();
+		}
+		void freeHeap();
+
 	private:
 		object_type m_type = NOTHING;
 
-		double m_number = 0.0;
-		std::wstring m_string; // copied by value
-		bool m_bool = false;
-
-		// copied by reference
-		std::shared_ptr<list> m_list;
-		std::shared_ptr<index> m_index;
+		union
+		{
+			uint64_t m_bits = 0;
+			double m_number;
+			bool m_bool;
+			heap_base* m_heap; // copied by reference, except strings are copied on write
+		};
 	};
+
+	static_assert(sizeof(object) <= 16, "object should be a type and one 8-byte value");
 }
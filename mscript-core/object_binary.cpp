@@ -0,0 +1,228 @@
+#include "pch.h"
+#include "object_binary.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace mscript
+{
+	class binary_writer
+	{
+	public:
+		binary_writer(std::vector<unsigned char>& output)
+			: m_output(output)
+		{}
+
+		void write(const object& obj)
+		{
+			// Ranges are written as lists, so modules only deal with lists
+			if (obj.type() == object::RANGE)
+			{
+				const object::range& range = obj.rangeVal();
+				m_output.push_back(static_cast<unsigned char>(object::LIST));
+				writeCount(range.count);
+				for (size_t i = 0; i < range.count; ++i)
+					write(range.at(i));
+				return;
+			}
+
+			m_output.push_back(static_cast<unsigned char>(obj.type()));
+			switch (obj.type())
+			{
+			case object::NOTHING:
+				break;
+
+			case object::NUMBER:
+			{
+				double number = obj.numberVal();
+				writeBytes(&number, sizeof(number));
+				break;
+			}
+
+			case object::BOOL:
+				m_output.push_back(obj.boolVal() ? 1 : 0);
+				break;
+
+			case object::STRING:
+			{
+				// ASCII strings are written as wide characters without widening them
+				if (obj.isAsciiString())
+				{
+					const std::string& ascii = obj.asciiVal();
+					writeCount(ascii.size());
+					for (char c : ascii)
+					{
+						wchar_t wide = wchar_t(c);
+						writeBytes(&wide, sizeof(wide));
+					}
+					break;
+				}
+
+				const std::wstring& str = obj.stringVal();
+				writeCount(str.size());
+				writeBytes(str.data(), str.size() * sizeof(wchar_t));
+				break;
+			}
+
+			case object::LIST:
+			{
+				const object::list& list = obj.listVal();
+				writeCount(list.size());
+				for (const auto& elem : list)
+					write(elem);
+				break;
+			}
+
+			case object::INDEX:
+			{
+				const auto& vec = obj.indexVal().vec();
+				writeCount(vec.size());
+				for (const auto& kvp : vec)
+				{
+					write(kvp.first);
+					write(kvp.second);
+				}
+				break;
+			}
+
+			default:
+				raiseError("Invalid object type for binary: " + num2str(int(obj.type())));
+			}
+		}
+
+	private:
+		void writeBytes(const void* data, size_t length)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			m_output.insert(m_output.end(), bytes, bytes + length);
+		}
+
+		void writeCount(size_t count)
+		{
+			if (count > UINT32_MAX)
+				raiseError("Too much data for binary: " + num2str(double(count)));
+			uint32_t count32 = static_cast<uint32_t>(count);
+			writeBytes(&count32, sizeof(count32));
+		}
+
+		std::vector<unsigned char>& m_output;
+	};
+
+	class binary_reader
+	{
+	public:
+		binary_reader(const unsigned char* data, size_t length)
+			: m_cur(data)
+			, m_end(data + length)
+		{}
+
+		bool atEnd() const { return m_cur == m_end; }
+
+		unsigned char readByte()
+		{
+			unsigned char byte = 0;
+			readBytes(&byte, 1);
+			return byte;
+		}
+
+		object read()
+		{
+			unsigned char type = readByte();
+			switch (type)
+			{
+			case object::NOTHING:
+				return object();
+
+			case object::NUMBER:
+			{
+				double number = 0.0;
+				readBytes(&number, sizeof(number));
+				return number;
+			}
+
+			case object::BOOL:
+				return readByte() != 0;
+
+			case object::STRING:
+			{
+				uint32_t length = readCount(sizeof(wchar_t));
+				std::wstring str(length, L'\0');
+				readBytes(str.data(), length * sizeof(wchar_t));
+				return object::fromWide(std::move(str));
+			}
+
+			case object::LIST:
+			{
+				uint32_t count = readCount(1);
+				object::list list;
+				list.reserve(count);
+				for (uint32_t e = 0; e < count; ++e)
+					list.push_back(read());
+				return list;
+			}
+
+			case object::INDEX:
+			{
+				uint32_t count = readCount(2);
+				object::index index;
+				index.reserve(count);
+				for (uint32_t e = 0; e < count; ++e)
+				{
+					object key = read();
+					index.set(key, read());
+				}
+				return index;
+			}
+
+			default:
+				raiseError("Invalid object type in binary: " + num2str(int(type)));
+			}
+		}
+
+	private:
+		void readBytes(void* output, size_t length)
+		{
+			if (size_t(m_end - m_cur) < length)
+				raiseError("Binary data ended early");
+			memcpy(output, m_cur, length);
+			m_cur += length;
+		}
+
+		// Read a count of things that each take at least minSize bytes,
+		// making sure that many could be there before anything gets allocated
+		uint32_t readCount(size_t minSize)
+		{
+			uint32_t count = 0;
+			readBytes(&count, sizeof(count));
+			if (size_t(m_end - m_cur) / minSize < count)
+				raiseError("Binary data ended early");
+			return count;
+		}
+
+		const unsigned char* m_cur;
+		const unsigned char* m_end;
+	};
+
+	object objectFromBinary(const unsigned char* data, size_t length)
+	{
+		binary_reader reader(data, length);
+		unsigned char version = reader.readByte();
+		if (version != objectBinaryVersion)
+			raiseError("Unsupported binary version: " + num2str(int(version)));
+
+		object obj = reader.read();
+		if (!reader.atEnd())
+			raiseError("Extra binary data after object");
+		return obj;
+	}
+
+	std::vector<unsigned char> objectToBinary(const object& obj)
+	{
+		std::vector<unsigned char> output;
+		output.push_back(objectBinaryVersion);
+		binary_writer writer(output);
+		writer.write(obj);
+		return output;
+	}
+}
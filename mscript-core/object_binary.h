@@ -0,0 +1,20 @@
+#pragma once
+
+#include "object.h"
+
+#include <vector>
+
+namespace mscript
+{
+	/// <summary>
+	/// The binary format for passing objects to and from modules,
+	/// which are in the same process, so numbers and characters are kept native
+	/// It starts with a format version byte, then each object is a type byte followed by
+	/// NUMBER: 8-byte double, BOOL: 1 byte, STRING: 4-byte length then the wchar_t's,
+	/// LIST: 4-byte count then the objects, INDEX: 4-byte count then key and value objects
+	/// </summary>
+	const unsigned char objectBinaryVersion = 1;
+
+	object objectFromBinary(const unsigned char* data, size_t length);
+	std::vector<unsigned char> objectToBinary(const object& obj);
+}
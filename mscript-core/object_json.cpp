@@ -1,207 +1,617 @@
 #include "pch.h"
 #include "object_json.h"
 #include "utils.h"
-#include "../../json/single_include/nlohmann/json.hpp"
 
-#undef max
-
-using json = nlohmann::json;
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace mscript
 {
-	class mscript_json_sax
+	/// <summary>
+	/// json_reader parses JSON text straight into objects, from wide or UTF-8 characters
+	/// Values are collected on one stack, so each list and index is made at its final size
+	/// when its closing bracket is reached, and ASCII strings are kept a byte a character
+	/// </summary>
+	template <typename CharT>
+	class json_reader
 	{
 	public:
-		mscript_json_sax()
+		json_reader(const CharT* begin, const CharT* end)
+			: m_begin(begin)
+			, m_cur(begin)
+			, m_end(end)
+		{}
+
+		object read()
 		{
-			m_objStack.emplace_back();
+			skipWhitespace();
+			object value = readValue(0);
+			skipWhitespace();
+			if (m_cur != m_end)
+				fail("unexpected characters after the value");
+			return value;
 		}
 
-		object final() const
+	private:
+		static const int sm_maxDepth = 1000;
+
+		[[noreturn]] void fail(const std::string& msg) const
 		{
-			return m_objStack.front();
+			raiseError("JSON parse error at " + std::to_string(m_cur - m_begin) + ": " + msg);
 		}
 
-		bool null()
+		void skipWhitespace()
 		{
-			set_obj_val(object());
-			return true;
+			while (m_cur < m_end && (*m_cur == ' ' || *m_cur == '\n' || *m_cur == '\r' || *m_cur == '\t'))
+				++m_cur;
 		}
 
-		bool boolean(bool val)
+		object readValue(int depth)
 		{
-			set_obj_val(val);
-			return true;
+			if (m_cur >= m_end)
+				fail("unexpected end of input");
+
+			switch (*m_cur)
+			{
+			case '{': return readIndex(depth + 1);
+			case '[': return readList(depth + 1);
+			case '"': return readString();
+			case 't': readLiteral("true"); return true;
+			case 'f': readLiteral("false"); return false;
+			case 'n': readLiteral("null"); return object();
+			default: return readNumber();
+			}
 		}
 
-		bool number_integer(json::number_integer_t val)
+		object readList(int depth)
 		{
-			set_obj_val(double(val));
-			return true;
+			if (depth > sm_maxDepth)
+				fail("too deeply nested");
+
+			++m_cur; // [
+			skipWhitespace();
+			if (m_cur < m_end && *m_cur == ']')
+			{
+				++m_cur;
+				return object::list();
+			}
+
+			size_t base = m_values.size();
+			while (true)
+			{
+				skipWhitespace();
+				m_values.push_back(readValue(depth));
+				skipWhitespace();
+				if (m_cur >= m_end)
+					fail("unexpected end of list");
+				if (*m_cur == ',')
+				{
+					++m_cur;
+					continue;
+				}
+				if (*m_cur != ']')
+					fail("expected , or ] in list");
+				++m_cur;
+				break;
+			}
+
+			object::list list(std::make_move_iterator(m_values.begin() + base), std::make_move_iterator(m_values.end()));
+			m_values.resize(base);
+			return list;
 		}
-		bool number_unsigned(json::number_unsigned_t val)
+
+		object readIndex(int depth)
 		{
-			set_obj_val(double(val));
-			return true;
+			if (depth > sm_maxDepth)
+				fail("too deeply nested");
+
+			++m_cur; // {
+			skipWhitespace();
+			if (m_cur < m_end && *m_cur == '}')
+			{
+				++m_cur;
+				return object::index();
+			}
+
+			// keys and values go on the stack in pairs
+			size_t base = m_values.size();
+			while (true)
+			{
+				skipWhitespace();
+				if (m_cur >= m_end || *m_cur != '"')
+					fail("expected a string key");
+				m_values.push_back(readString());
+
+				skipWhitespace();
+				if (m_cur >= m_end || *m_cur != ':')
+					fail("expected : after key");
+				++m_cur;
+
+				skipWhitespace();
+				m_values.push_back(readValue(depth));
+				skipWhitespace();
+				if (m_cur >= m_end)
+					fail("unexpected end of index");
+				if (*m_cur == ',')
+				{
+					++m_cur;
+					continue;
+				}
+				if (*m_cur != '}')
+					fail("expected , or } in index");
+				++m_cur;
+				break;
+			}
+
+			object::index index;
+			index.reserve((m_values.size() - base) / 2);
+			for (size_t v = base; v < m_values.size(); v += 2)
+				index.set(m_values[v], m_values[v + 1]);
+			m_values.resize(base);
+			return index;
 		}
-		bool number_float(json::number_float_t val, const json::string_t&)
+
+		void readLiteral(const char* literal)
 		{
-			set_obj_val(double(val));
-			return true;
+			for (const char* c = literal; *c; ++c, ++m_cur)
+			{
+				if (m_cur >= m_end || *m_cur != CharT(*c))
+					fail("invalid literal, expected " + std::string(literal));
+			}
 		}
 
-		bool string(json::string_t& val)
+		object readNumber()
 		{
-			set_obj_val(toWideStr(val));
-			return true;
+			// -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+			const CharT* start = m_cur;
+			if (m_cur < m_end && *m_cur == '-')
+				++m_cur;
+			if (m_cur >= m_end || !isDigit(*m_cur))
+			{
+				if (m_cur == start)
+					fail("unexpected character");
+				badNumber(start);
+			}
+
+			// Track the power of ten of the leading digit, to tell underflow from overflow
+			long long magnitude;
+			if (*m_cur == '0')
+			{
+				++m_cur;
+				magnitude = -1;
+			}
+			else
+				magnitude = (long long)skipDigits() - 1;
+
+			if (m_cur < m_end && *m_cur == '.')
+			{
+				++m_cur;
+				const CharT* fraction = m_cur;
+				if (skipDigits() == 0)
+					badNumber(start);
+				if (magnitude < 0)
+				{
+					const CharT* firstNonZero = fraction;
+					while (firstNonZero < m_cur && *firstNonZero == '0')
+						++firstNonZero;
+					magnitude = -1 - (long long)(firstNonZero - fraction);
+				}
+			}
+
+			if (m_cur < m_end && (*m_cur == 'e' || *m_cur == 'E'))
+			{
+				++m_cur;
+				bool negative = false;
+				if (m_cur < m_end && (*m_cur == '+' || *m_cur == '-'))
+					negative = *m_cur++ == '-';
+				if (m_cur >= m_end || !isDigit(*m_cur))
+					badNumber(start);
+				long long exponent = 0;
+				for (; m_cur < m_end && isDigit(*m_cur); ++m_cur)
+					exponent = std::min(exponent * 10 + (*m_cur - '0'), 1000000LL);
+				magnitude += negative ? -exponent : exponent;
+			}
+
+			// Things like 01 and 1.2.3 aren't numbers
+			if (m_cur < m_end && isNumberChar(*m_cur))
+				badNumber(start);
+
+			// from_chars wants chars, wide numbers are copied over, they're all ASCII
+			double number = 0.0;
+			bool parsed, underflow;
+			if constexpr (sizeof(CharT) == 1)
+			{
+				auto result = std::from_chars(start, m_cur, number);
+				parsed = result.ec == std::errc() && result.ptr == m_cur;
+				underflow = result.ec == std::errc::result_out_of_range && magnitude < 0;
+			}
+			else
+			{
+				std::string chars(start, m_cur);
+				auto result = std::from_chars(chars.data(), chars.data() + chars.size(), number);
+				parsed = result.ec == std::errc() && result.ptr == chars.data() + chars.size();
+				underflow = result.ec == std::errc::result_out_of_range && magnitude < 0;
+			}
+
+			// Numbers too small for a double are zero, too big ones are errors
+			if (underflow)
+				return *start == '-' ? -0.0 : 0.0;
+			if (!parsed)
+				badNumber(start);
+			return number;
 		}
 
-		bool binary(json::binary_t&)
+		[[noreturn]] void badNumber(const CharT* start)
 		{
-			raiseError("Binary values are not allowed in mscript JSON");
+			m_cur = start;
+			fail("invalid number");
 		}
 
-		bool start_object(std::size_t)
+		static bool isDigit(CharT c)
 		{
-			m_objStack.push_back(object::index());
-			return true;
+			return c >= '0' && c <= '9';
 		}
 
-		bool end_object()
+		size_t skipDigits()
 		{
-			return on_end();
+			const CharT* start = m_cur;
+			while (m_cur < m_end && isDigit(*m_cur))
+				++m_cur;
+			return size_t(m_cur - start);
 		}
 
-		bool start_array(std::size_t)
+		static bool isNumberChar(CharT c)
 		{
-			m_objStack.push_back(object::list());
-			return true;
+			return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
 		}
 
-		bool end_array()
+		static bool isControlChar(CharT c)
 		{
-			return on_end();
+			return std::make_unsigned_t<CharT>(c) < 0x20;
 		}
 
-		bool key(json::string_t& val)
+		static bool isPlainChar(CharT c)
 		{
-			m_keyStack.push_back(object(toWideStr(val)));
-			return true;
+			if (c == '"' || c == '\\' || isControlChar(c))
+				return false;
+			if constexpr (sizeof(CharT) == 1)
+				return (unsigned char)c < 0x80;
+			else
+				return true;
 		}
 
-		bool parse_error(std::size_t pos, const std::string&, const nlohmann::detail::exception& exp)
+		object readString()
 		{
-			raiseError("JSON parse error at " + std::to_string(pos) + ": " + std::string(exp.what()));
-			//return false;
+			++m_cur; // opening quote
+
+			// Most strings are plain characters up to the closing quote,
+			// kept a byte a character if they're ASCII
+			const CharT* start = m_cur;
+			while (m_cur < m_end && isPlainChar(*m_cur))
+				++m_cur;
+			if (m_cur < m_end && *m_cur == '"')
+			{
+				++m_cur;
+				if constexpr (sizeof(CharT) == 1)
+					return object::fromUtf8(std::string_view(start, size_t(m_cur - 1 - start)));
+				else
+					return object::fromWide(std::wstring_view(start, size_t(m_cur - 1 - start)));
+			}
+
+			std::wstring str(start, m_cur);
+
+			while (true)
+			{
+				if (m_cur >= m_end)
+					fail("unterminated string");
+
+				CharT c = *m_cur;
+				if (c == '"')
+				{
+					++m_cur;
+					return object::fromWide(std::move(str));
+				}
+				else if (c == '\\')
+				{
+					readEscape(str);
+				}
+				else if (isControlChar(c))
+				{
+					fail("control character in string");
+				}
+				else if (isPlainChar(c))
+				{
+					str += wchar_t(c);
+					++m_cur;
+				}
+				else if constexpr (sizeof(CharT) == 1)
+				{
+					// UTF-8 sequences are decoded a run at a time
+					start = m_cur;
+					while (m_cur < m_end && (unsigned char)*m_cur >= 0x80)
+						++m_cur;
+					str += toWideStr(std::string_view(start, size_t(m_cur - start)));
+				}
+			}
 		}
 
-	private:
-		void set_obj_val(const object& obj)
+		void readEscape(std::wstring& str)
 		{
-			object& cur_obj = m_objStack.back();
-			if (cur_obj.type() == object::INDEX)
+			++m_cur; // backslash
+			if (m_cur >= m_end)
+				fail("unterminated string");
+
+			switch (*m_cur++)
 			{
-				if (m_keyStack.empty())
-					raiseError("No object key in context");
-				cur_obj.indexVal().set(m_keyStack.back(), obj);
-				m_keyStack.pop_back();
+			case '"': str += '"'; break;
+			case '\\': str += '\\'; break;
+			case '/': str += '/'; break;
+			case 'b': str += '\b'; break;
+			case 'f': str += '\f'; break;
+			case 'n': str += '\n'; break;
+			case 'r': str += '\r'; break;
+			case 't': str += '\t'; break;
+			case 'u':
+			{
+				const CharT* escape = m_cur - 2;
+				unsigned unit = readHex4();
+				if (unit >= 0xDC00 && unit <= 0xDFFF)
+				{
+					m_cur = escape;
+					fail("unpaired surrogate in \\u escape");
+				}
+				if (unit < 0xD800 || unit > 0xDBFF)
+				{
+					str += wchar_t(unit);
+					break;
+				}
+
+				// A high surrogate has to have a low one right after it
+				unsigned low = 0;
+				if (m_end - m_cur >= 6 && m_cur[0] == '\\' && m_cur[1] == 'u')
+				{
+					m_cur += 2;
+					low = readHex4();
+				}
+				if (low < 0xDC00 || low > 0xDFFF)
+				{
+					m_cur = escape;
+					fail("unpaired surrogate in \\u escape");
+				}
+
+				// Surrogate pairs are kept as pairs in UTF-16 strings, combined in UTF-32 ones
+				if constexpr (sizeof(wchar_t) > 2)
+					str += wchar_t(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+				else
+				{
+					str += wchar_t(unit);
+					str += wchar_t(low);
+				}
+				break;
+			}
+			default:
+				--m_cur;
+				fail("invalid escape in string");
 			}
-			else if (cur_obj.type() == object::LIST)
-				cur_obj.listVal().push_back(obj);
-			else
-				cur_obj = obj;
 		}
 
-		bool on_end()
+		unsigned readHex4()
 		{
-			object back_obj = m_objStack.back();
-			m_objStack.pop_back();
+			if (m_end - m_cur < 4)
+				fail("invalid \\u escape");
 
-			object& cur_obj = m_objStack.back();
-			if (cur_obj.type() == object::INDEX)
+			unsigned value = 0;
+			for (int h = 0; h < 4; ++h, ++m_cur)
 			{
-				if (m_keyStack.empty())
-					raiseError("No object key in context");
-				cur_obj.indexVal().set(m_keyStack.back(), back_obj);
-				m_keyStack.pop_back();
+				CharT c = *m_cur;
+				value <<= 4;
+				if (c >= '0' && c <= '9')
+					value |= unsigned(c - '0');
+				else if (c >= 'a' && c <= 'f')
+					value |= unsigned(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F')
+					value |= unsigned(c - 'A' + 10);
+				else
+					fail("invalid \\u escape");
 			}
-			else if (cur_obj.type() == object::LIST)
-				cur_obj.listVal().push_back(back_obj);
-			else
-				cur_obj = back_obj;
-			return true;
+			return value;
 		}
 
-		std::vector<object> m_objStack;
-		std::vector<object> m_keyStack;
+		const CharT* m_begin;
+		const CharT* m_cur;
+		const CharT* m_end;
+		std::vector<object> m_values;
 	};
 
-	object mscript::objectFromJson(const std::wstring& json)
+	object objectFromJson(std::wstring_view json)
 	{
-		mscript_json_sax my_sax;
-		if (!json::sax_parse(json, &my_sax))
-			raiseError("JSON parsing failed");
-		object final = my_sax.final();
-		return final;
+		json_reader<wchar_t> reader(json.data(), json.data() + json.size());
+		return reader.read();
 	}
 
-	std::wstring objectToJson(const object& obj)
+	object objectFromJson(std::string_view utf8Json)
+	{
+		if (utf8Json.size() >= 3 && utf8Json.compare(0, 3, "\xEF\xBB\xBF") == 0)
+			utf8Json.remove_prefix(3);
+
+		json_reader<char> reader(utf8Json.data(), utf8Json.data() + utf8Json.size());
+		return reader.read();
+	}
+
+	// Buffers are handed to sinks when they get this big, in characters
+	static const size_t sm_flushSize = 64 * 1024;
+
+	json_writer::json_writer(bool pretty)
+		: m_pretty(pretty)
+	{}
+
+	json_writer::json_writer(const json_sink& sink, bool pretty)
+		: m_sink(sink)
+		, m_pretty(pretty)
+	{
+		m_buffer.reserve(sm_flushSize + sm_flushSize / 4);
+	}
+
+	void json_writer::write(const object& obj)
+	{
+		writeValue(obj, 0);
+		if (m_sink)
+			flush();
+	}
+
+	void json_writer::flush()
+	{
+		if (m_sink && !m_buffer.empty())
+		{
+			m_sink(m_buffer.data(), m_buffer.size());
+			m_buffer.clear();
+		}
+	}
+
+	void json_writer::checkFlush()
+	{
+		if (m_sink && m_buffer.size() >= sm_flushSize)
+			flush();
+	}
+
+	void json_writer::writeNewLine(int depth)
+	{
+		m_buffer += '\n';
+		m_buffer.append(size_t(depth) * 4, ' ');
+	}
+
+	void json_writer::writeValue(const object& obj, int depth)
 	{
 		switch (obj.type())
 		{
 		case object::NOTHING:
-			return L"null";
+			m_buffer += L"null";
+			break;
+
 		case object::BOOL:
-			return obj.boolVal() ? L"true" : L"false";
+			m_buffer += obj.boolVal() ? L"true" : L"false";
+			break;
+
 		case object::NUMBER:
-			return num2wstr(obj.numberVal());
+			writeNumber(obj.numberVal());
+			break;
+
 		case object::STRING:
-		{
-			std::wstring out_str;
-			out_str.reserve(std::max(size_t(2), obj.stringVal().capacity() * 2));
-			out_str += L"\"";
-			for (wchar_t c : obj.stringVal())
-			{
-				switch (c)
-				{
-				case '\\': out_str += L"\\\\"; break;
-				case '/': out_str += L"\\/"; break;
-				case '\"': out_str += L"\\\""; break;
-				case '\b': out_str += L"\\b"; break;
-				case '\f': out_str += L"\\f"; break;
-				case '\n': out_str += L"\\n"; break;
-				case '\r': out_str += L"\\r"; break;
-				case '\t': out_str += L"\\t"; break;
-				default: out_str += c;
-				}
-			}
-			out_str += L"\"";
-			return out_str;
-		}
+			if (obj.isAsciiString())
+				writeString<char>(obj.asciiVal());
+			else
+				writeString<wchar_t>(obj.stringVal());
+			break;
+
 		case object::LIST:
 		{
 			const object::list& list = obj.listVal();
-			std::vector<std::wstring> strs;
-			strs.reserve(list.size());
+			m_buffer += '[';
 			for (size_t e = 0; e < list.size(); ++e)
-				strs.push_back(objectToJson(list[e]));
-			return L"[" + join(strs, L", ") + L"]";
+			{
+				if (e > 0)
+					m_buffer += m_pretty ? L"," : L", ";
+				if (m_pretty)
+					writeNewLine(depth + 1);
+				writeValue(list[e], depth + 1);
+				checkFlush();
+			}
+			if (m_pretty && !list.empty())
+				writeNewLine(depth);
+			m_buffer += ']';
+			break;
 		}
+
 		case object::INDEX:
 		{
-			const object::index& index = obj.indexVal();
-			std::vector<std::wstring> strs;
-			strs.reserve(index.size());
-			for (size_t e = 0; e < index.vec().size(); ++e)
+			const auto& vec = obj.indexVal().vec();
+			m_buffer += '{';
+			for (size_t e = 0; e < vec.size(); ++e)
+			{
+				if (e > 0)
+					m_buffer += m_pretty ? L"," : L", ";
+				if (m_pretty)
+					writeNewLine(depth + 1);
+				writeValue(vec[e].first, depth + 1);
+				m_buffer += L": ";
+				writeValue(vec[e].second, depth + 1);
+				checkFlush();
+			}
+			if (m_pretty && !vec.empty())
+				writeNewLine(depth);
+			m_buffer += '}';
+			break;
+		}
+
+		case object::RANGE:
+		{
+			const object::range& range = obj.rangeVal();
+			m_buffer += '[';
+			for (size_t e = 0; e < range.count; ++e)
 			{
-				const auto& pair = index.vec()[e];
-				strs.push_back(objectToJson(pair.first) + L": " + objectToJson(pair.second));
+				if (e > 0)
+					m_buffer += m_pretty ? L"," : L", ";
+				if (m_pretty)
+					writeNewLine(depth + 1);
+				writeNumber(range.at(e));
+				checkFlush();
 			}
-			return L"{" + join(strs, L", ") + L"}";
+			if (m_pretty && range.count > 0)
+				writeNewLine(depth);
+			m_buffer += ']';
+			break;
 		}
 
 		default:
 			raiseError("Invalid object type of conversion to JSON: " + num2str((int)obj.type()));
 		}
 	}
+
+	template <typename CharT>
+	void json_writer::writeString(std::basic_string_view<CharT> str)
+	{
+		m_buffer += '\"';
+
+		// Characters that don't need escaping are appended in runs
+		size_t runStart = 0;
+		for (size_t c = 0; c < str.size(); ++c)
+		{
+			const wchar_t* escaped;
+			switch (str[c])
+			{
+			case '\\': escaped = L"\\\\"; break;
+			case '/': escaped = L"\\/"; break;
+			case '\"': escaped = L"\\\""; break;
+			case '\b': escaped = L"\\b"; break;
+			case '\f': escaped = L"\\f"; break;
+			case '\n': escaped = L"\\n"; break;
+			case '\r': escaped = L"\\r"; break;
+			case '\t': escaped = L"\\t"; break;
+			default: continue;
+			}
+			m_buffer.append(str.begin() + runStart, str.begin() + c);
+			m_buffer += escaped;
+			runStart = c + 1;
+		}
+		m_buffer.append(str.begin() + runStart, str.end());
+
+		m_buffer += '\"';
+	}
+
+	void json_writer::writeNumber(double num)
+	{
+		wchar_t chars[maxNumberLength];
+		m_buffer.append(chars, num2chars(num, chars));
+	}
+
+	std::wstring objectToJson(const object& obj, bool pretty)
+	{
+		json_writer writer(pretty);
+		writer.write(obj);
+		return writer.takeOutput();
+	}
 }
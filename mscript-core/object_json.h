@@ -2,8 +2,57 @@
 
 #include "object.h"
 
+#include <functional>
+#include <string>
+#include <string_view>
+
 namespace mscript
 {
-	object objectFromJson(const std::wstring& json);
-	std::wstring objectToJson(const object& obj);
+	/// <summary>
+	/// json_writer writes objects out as JSON in one pass, appending to one buffer
+	/// With a sink, the buffer is handed to the sink whenever it fills up, then reused,
+	/// so big output can go to a file or pipe without all being in memory at once
+	/// Pretty printing puts each item on its own line, indented four spaces per level
+	/// </summary>
+	class json_writer
+	{
+	public:
+		typedef std::function<void(const wchar_t* text, size_t length)> json_sink;
+
+		json_writer(bool pretty = false);
+		json_writer(const json_sink& sink, bool pretty = false);
+
+		void write(const object& obj);
+
+		/// <summary>
+		/// Hand anything buffered to the sink
+		/// </summary>
+		void flush();
+
+		/// <summary>
+		/// Take what has been written, when there is no sink
+		/// </summary>
+		std::wstring takeOutput() { return std::move(m_buffer); }
+
+	private:
+		void writeValue(const object& obj, int depth);
+		template <typename CharT>
+		void writeString(std::basic_string_view<CharT> str);
+		void writeNumber(double num);
+		void writeNewLine(int depth);
+		void checkFlush();
+
+		json_sink m_sink;
+		bool m_pretty;
+		std::wstring m_buffer;
+	};
+
+	/// <summary>
+	/// Parse JSON text into an object, from wide characters or UTF-8 bytes,
+	/// like a file or a module's output
+	/// </summary>
+	object objectFromJson(std::wstring_view json);
+	object objectFromJson(std::string_view utf8Json);
+
+	std::wstring objectToJson(const object& obj, bool pretty = false);
 }
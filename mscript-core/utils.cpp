@@ -3,55 +3,197 @@
 
 #include <Windows.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+
 namespace mscript
 {
+    template <typename CharT>
+    static std::basic_string_view<CharT> trimChars(std::basic_string_view<CharT> str)
+    {
+        size_t start = 0;
+        while (start < str.length() && iswspace(str[start]))
+            ++start;
+
+        size_t end = str.length();
+        while (end > start && iswspace(str[end - 1]))
+            --end;
+
+        return str.substr(start, end - start);
+    }
+
+    template <typename StrT, typename CharT>
+    static std::vector<StrT> splitChars(std::basic_string_view<CharT> str, std::basic_string_view<CharT> seperator)
+    {
+        std::vector<StrT> retVal;
+        if (seperator.empty())
+        {
+            retVal.emplace_back(str);
+        }
+        else if (seperator.size() == 1)
+        {
+            const CharT sep = seperator[0];
+            size_t start = 0;
+            for (size_t c = 0; c < str.size(); ++c)
+            {
+                if (str[c] == sep)
+                {
+                    retVal.emplace_back(str.substr(start, c - start));
+                    start = c + 1;
+                }
+            }
+            if (start < str.size())
+                retVal.emplace_back(str.substr(start));
+        }
+        else
+        {
+            size_t start = 0;
+            while (start < str.size())
+            {
+                size_t next_sep = str.find(seperator, start);
+                if (next_sep == std::basic_string_view<CharT>::npos)
+                {
+                    retVal.emplace_back(str.substr(start));
+                    break;
+                }
+                else
+                {
+                    retVal.emplace_back(str.substr(start, next_sep - start));
+                    start = next_sep + seperator.size();
+                }
+            }
+        }
+        return retVal;
+    }
+
+    size_t mscript::num2chars(double num, char* buffer)
+    {
+        // general format with a precision is printf's %g, same as streams with setprecision
+        auto result = std::to_chars(buffer, buffer + maxNumberLength, num, std::chars_format::general, 10);
+        return size_t(result.ptr - buffer);
+    }
+
+    size_t mscript::num2chars(double num, wchar_t* buffer)
+    {
+        char chars[maxNumberLength];
+        size_t length = num2chars(num, chars);
+        std::copy(chars, chars + length, buffer);
+        return length;
+    }
+
     std::wstring mscript::num2wstr(double num)
     {
-        std::wstringstream ss;
-        ss << std::setprecision(10) << num;
-        return ss.str();
+        wchar_t chars[maxNumberLength];
+        return std::wstring(chars, num2chars(num, chars));
     }
 
     std::string mscript::num2str(double num)
     {
-        std::stringstream ss;
-        ss << std::setprecision(10) << num;
-        return ss.str();
+        char chars[maxNumberLength];
+        return std::string(chars, num2chars(num, chars));
+    }
+
+    bool mscript::parseNumber(std::wstring_view str, double& number)
+    {
+        size_t start = 0;
+        while (start < str.size() && iswspace(str[start]))
+            ++start;
+
+        // from_chars takes chars, and numbers are ASCII, so copy until the first thing that can't be in one
+        char chars[128];
+        size_t length = 0;
+        while (start + length < str.size() && length < sizeof(chars))
+        {
+            wchar_t c = str[start + length];
+            if (c > 0x7F || !(iswalnum(c) || c == '.' || c == '+' || c == '-'))
+                break;
+            chars[length++] = char(c);
+        }
+
+        const char* begin = chars;
+        const char* end = chars + length;
+        bool negative = begin < end && *begin == '-';
+        if (begin < end && (*begin == '-' || *begin == '+'))
+            ++begin;
+        if (begin < end && (*begin == '-' || *begin == '+'))
+            return false;
+
+        std::from_chars_result result;
+        if (end - begin > 2 && begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X'))
+            result = std::from_chars(begin + 2, end, number, std::chars_format::hex);
+        else
+            result = std::from_chars(begin, end, number);
+        if (result.ec != std::errc())
+            return false;
+
+        if (negative)
+            number = -number;
+        return true;
+    }
+
+    bool isAscii(std::string_view str)
+    {
+        // Check eight bytes at a time, any high bit means there's UTF-8
+        const size_t wordSize = sizeof(uint64_t);
+        const uint64_t highBits = 0x8080808080808080ULL;
+        size_t i = 0;
+        for (; i + wordSize <= str.size(); i += wordSize)
+        {
+            uint64_t word;
+            memcpy(&word, str.data() + i, wordSize);
+            if (word & highBits)
+                return false;
+        }
+
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(str.data());
+        for (; i < str.size(); ++i)
+        {
+            if (bytes[i] > 127)
+                return false;
+        }
+        return true;
     }
 
-    std::wstring mscript::toWideStr(const std::string& str)
+    bool isAscii(std::wstring_view str)
+    {
+        return std::all_of(str.begin(), str.end(), [](wchar_t c) { return unsigned(c) <= 127; });
+    }
+
+    std::wstring mscript::toWideStr(std::string_view str)
     {
         if (str.empty())
             return std::wstring();
 
-        bool allNarrow = true;
+        if (isAscii(str))
         {
-            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(str.data());
+            std::wstring retVal(str.size(), 0);
             for (size_t i = 0; i < str.size(); ++i)
-            {
-                if (bytes[i] > 127)
-                {
-                    allNarrow = false;
-                    break;
-                }
-            }
+                retVal[i] = wchar_t(str[i]);
+            return retVal;
         }
 
-        if (allNarrow)
+        // Decode in chunks that fit in an int, without splitting a character across chunks
+        const size_t maxChunk = size_t(1) << 30;
+        std::wstring result;
+        size_t start = 0;
+        while (start < str.size())
         {
-            std::wstring retVal;
-            retVal.reserve(str.size());
-            for (auto c : str)
-                retVal += char(c);
-            return retVal;
+            size_t len = std::min(str.size() - start, maxChunk);
+            while (start + len < str.size() && len > 0 && (static_cast<unsigned char>(str[start + len]) & 0xC0) == 0x80)
+                --len;
+
+            int needed = MultiByteToWideChar(CP_UTF8, 0, str.data() + start, int(len), nullptr, 0);
+            if (needed <= 0)
+                raiseError("MultiByteToWideChar failed");
+
+            size_t offset = result.size();
+            result.resize(offset + needed);
+            MultiByteToWideChar(CP_UTF8, 0, str.data() + start, int(len), result.data() + offset, needed);
+            start += len;
         }
-
-        int needed = MultiByteToWideChar(CP_UTF8, 0, str.data(), int(str.size()), nullptr, 0);
-        if (needed <= 0)
-            raiseError("MultiByteToWideChar failed");
-
-        std::wstring result(needed, 0);
-        MultiByteToWideChar(CP_UTF8, 0, str.data(), int(str.size()), result.data(), needed);
         return result;
     }
 
@@ -118,34 +260,19 @@ namespace mscript
         return retVal;
     }
 
-    std::wstring mscript::trim(const std::wstring& str)
+    std::wstring mscript::trim(std::wstring_view str)
     {
-        if (str.empty())
-            return std::wstring();
-
-        if (str.length() == 1)
-            return iswspace(str[0]) ? std::wstring() : str;
-
-        if (!iswspace(str.front()) && !iswspace(str.back()))
-            return str;
-
-        std::wstring retVal;
-        retVal.reserve(str.length());
-
-        // skip whitespace
-        size_t c = 0;
-        while (c < str.length() && iswspace(str[c]))
-            ++c;
-
-        // copy the rest
-        while (c < str.length())
-            retVal.push_back(str[c++]);
+        return std::wstring(trimView(str));
+    }
 
-        // pop whitespace
-        while (!retVal.empty() && iswspace(retVal.back()))
-            retVal.pop_back();
+    std::wstring_view mscript::trimView(std::wstring_view str)
+    {
+        return trimChars(str);
+    }
 
-        return retVal;
+    std::string_view mscript::trimView(std::string_view str)
+    {
+        return trimChars(str);
     }
 }
 
@@ -167,7 +294,7 @@ std::wstring mscript::replace(const std::wstring& str, const std::wstring& from,
     return retVal;
 }
 
-bool mscript::startsWith(const std::wstring& str, const wchar_t* starter)
+bool mscript::startsWith(std::wstring_view str, const wchar_t* starter)
 {
     if (str.empty() || !*starter)
         return false;
@@ -185,7 +312,7 @@ bool mscript::startsWith(const std::wstring& str, const wchar_t* starter)
     return true;
 }
 
-bool mscript::endsWith(const std::wstring& str, const wchar_t* finisher)
+bool mscript::endsWith(std::wstring_view str, const wchar_t* finisher)
 {
     if (str.empty() || !*finisher)
         return false;
@@ -204,50 +331,14 @@ bool mscript::endsWith(const std::wstring& str, const wchar_t* finisher)
     return true;
 }
 
-std::vector<std::wstring> mscript::split(const std::wstring& str, const std::wstring& seperator)
+std::vector<std::wstring> mscript::split(std::wstring_view str, std::wstring_view seperator)
 {
-    std::vector<std::wstring> retVal;
-    if (seperator.empty())
-    {
-        retVal.push_back(str);
-    }
-    else if (seperator.size() == 1)
-    {
-        std::wstring acc;
-        const wchar_t sep = seperator[0];
-        for (wchar_t c : str)
-        {
-            if (c == sep)
-            {
-                retVal.push_back(acc);
-                acc.clear();
-            }
-            else
-                acc.push_back(c);
-        }
-        if (!acc.empty())
-            retVal.push_back(acc);
-    }
-    else
-    {
-        wchar_t* last_sep = const_cast<wchar_t*>(str.c_str());
-        size_t sep_len = seperator.length();
-        while (last_sep != nullptr && last_sep[0] != '\0')
-        {
-            wchar_t* next_sep = wcsstr(last_sep, seperator.c_str());
-            if (next_sep == nullptr)
-            {
-                retVal.push_back(last_sep);
-                break;
-            }
-            else
-            {
-                retVal.emplace_back(last_sep, next_sep);
-                last_sep = next_sep + sep_len;
-            }
-        }
-    }
-    return retVal;
+    return splitChars<std::wstring>(str, seperator);
+}
+
+std::vector<std::string_view> mscript::split(std::string_view str, std::string_view seperator)
+{
+    return splitChars<std::string_view>(str, seperator);
 }
 
 #if defined(_WIN32) || defined(_WIN64)
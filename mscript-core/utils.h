@@ -7,6 +7,7 @@
 #endif
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 // Use macros for exception raising helpers to not pollute the stack trace
@@ -15,25 +16,58 @@
 
 namespace mscript
 {
+    /// <summary>
+    /// Numbers are written with up to 10 significant digits, like setprecision(10),
+    /// into a buffer of at least maxNumberLength characters, without allocating or locales
+    /// Returns how many characters were written, there is no null terminator
+    /// </summary>
+    const size_t maxNumberLength = 32;
+    size_t num2chars(double num, char* buffer);
+    size_t num2chars(double num, wchar_t* buffer);
+
     std::wstring num2wstr(double num);
     std::string num2str(double num);
 
+    /// <summary>
+    /// Parse the number at the start of a string, like wcstod without locales:
+    /// leading whitespace, a sign, hex after 0x, inf, and nan are all allowed
+    /// Returns false if there is no number, or it's too big for a double
+    /// </summary>
+    bool parseNumber(std::wstring_view str, double& number);
+
+    /// <summary>
+    /// Are all the characters ASCII, so the string can be kept a byte a character
+    /// </summary>
+    bool isAscii(std::string_view str);
+    bool isAscii(std::wstring_view str);
+
     std::string toNarrowStr(const std::wstring& str);
-    std::wstring toWideStr(const std::string& str);
+    std::wstring toWideStr(std::string_view str);
 
     std::wstring toLower(const std::wstring& str);
     std::wstring toUpper(const std::wstring& str);
 
     std::wstring join(const std::vector<std::wstring>& strs, const std::wstring& seperator);
 
-    std::wstring trim(const std::wstring& str);
+    std::wstring trim(std::wstring_view str);
+
+    /// <summary>
+    /// Trim without copying, the view points into the string passed in
+    /// </summary>
+    std::wstring_view trimView(std::wstring_view str);
+    std::string_view trimView(std::string_view str);
+
+    std::vector<std::wstring> split(std::wstring_view str, std::wstring_view seperator);
 
-    std::vector<std::wstring> split(const std::wstring& str, const std::wstring& seperator);
+    /// <summary>
+    /// Split ASCII text without copying, the views point into the string passed in
+    /// </summary>
+    std::vector<std::string_view> split(std::string_view str, std::string_view seperator);
 
     std::wstring replace(const std::wstring& str, const std::wstring& from, const std::wstring& to);
 
-    bool startsWith(const std::wstring& str, const wchar_t* starter);
-    bool endsWith(const std::wstring& str, const wchar_t* finisher);
+    bool startsWith(std::wstring_view str, const wchar_t* starter);
+    bool endsWith(std::wstring_view str, const wchar_t* finisher);
 
 #if defined(_WIN32) || defined(_WIN64)
     std::wstring getLastErrorMsg(DWORD dwErrorCode = ::GetLastError());
@@ -1,7 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <stdexcept>
-#include <unordered_map>
 #include <vector>
 
 namespace mscript
@@ -9,10 +10,14 @@ namespace mscript
     /// <summary>
     /// A vectormap combines a map with its fast key->value lookups
     /// with a vector to preserve the order that key-value pairs were added
+    /// The vector is the only place keys are kept; the lookup side is
+    /// a compact open-addressed table of positions in the vector
+    /// Lookups can use any type the hasher hashes and that compares with K,
+    /// like looking up object keys with strings, without making a K
     /// </summary>
     /// <typeparam name="K">Key type of the map</typeparam>
     /// <typeparam name="V">Value type of the map</typeparam>
-    template <typename K, typename V>
+    template <typename K, typename V, typename H = std::hash<K>>
     class vectormap
     {
     public:
@@ -21,6 +26,7 @@ namespace mscript
         /// </summary>
         const std::vector<std::pair<K, V>>& vec() const
         {
+            compact();
             return m_vec;
         }
 
@@ -31,12 +37,13 @@ namespace mscript
         ///       and users of the class can use pointers 
         ///       if they want side effects down the line.
         /// </summary>
-        V get(const K& key) const
+        template <typename Q>
+        V get(const Q& key) const
         {
-            const auto& it = m_map.find(key);
-            if (it == m_map.end())
+            int pos = find(key, hashOf(key));
+            if (pos < 0)
                 throw std::runtime_error("key not found");
-            return m_vec[it->second].second;
+            return m_vec[pos].second;
         }
 
         /// <summary>
@@ -48,6 +55,7 @@ namespace mscript
         /// </summary>
         V getAt(size_t index) const
         {
+            compact();
             if (index >= m_vec.size())
                 throw std::runtime_error("index out of range");
             return m_vec[index].second;
@@ -58,15 +66,16 @@ namespace mscript
         /// </summary>
         size_t size() const
         {
-            return m_vec.size();
+            return m_vec.size() - m_erasedCount;
         }
 
         /// <summary>
         /// Does this map contain this key?
         /// </summary>
-        bool contains(const K& key) const
+        template <typename Q>
+        bool contains(const Q& key) const
         {
-            return m_map.find(key) != m_map.end();
+            return find(key, hashOf(key)) >= 0;
         }
 
         /// <summary>
@@ -74,14 +83,62 @@ namespace mscript
         /// </summary>
         void set(const K& key, const V& val)
         {
-            auto it = m_map.find(key);
-            if (it == m_map.end())
+            size_t hash = hashOf(key);
+            int pos = find(key, hash);
+            if (pos >= 0)
             {
-                m_map.insert({ key, m_vec.size() });
-                m_vec.emplace_back(key, val);
+                m_vec[pos].second = val;
+                return;
             }
-            else
-                m_vec[it->second].second = val;
+
+            if ((m_vec.size() + 1) * 3 > m_slots.size() * 2)
+                growSlots(m_vec.size() + 1);
+
+            m_vec.emplace_back(key, val);
+            m_hashes.push_back(hash);
+            if (!m_erased.empty())
+                m_erased.push_back(false);
+            insertSlot(hash, int(m_vec.size()) - 1);
+        }
+
+        /// <summary>
+        /// Remove a key and its value, returning false if the key was not found
+        /// The spot in the vector is marked erased, and the vector is compacted
+        /// the next time it is accessed by position
+        /// </summary>
+        template <typename Q>
+        bool erase(const Q& key)
+        {
+            size_t hash = hashOf(key);
+            size_t slot = 0;
+            int pos = find(key, hash, &slot);
+            if (pos < 0)
+                return false;
+
+            m_slots[slot] = sm_erasedSlot;
+
+            if (m_erased.empty())
+                m_erased.resize(m_vec.size(), false);
+            m_erased[pos] = true;
+            m_vec[pos] = std::pair<K, V>();
+            ++m_erasedCount;
+
+            // Don't let erased entries take over a map that keeps changing
+            if (m_erasedCount > m_vec.size() / 2)
+                compact();
+
+            return true;
+        }
+
+        /// <summary>
+        /// Make room for a number of key-value pairs
+        /// </summary>
+        void reserve(size_t count)
+        {
+            m_vec.reserve(count);
+            m_hashes.reserve(count);
+            if (count * 3 > m_slots.size() * 2)
+                growSlots(count);
         }
 
         /// <summary>
@@ -90,13 +147,14 @@ namespace mscript
         /// <param name="key">Key value to look up</param>
         /// <param name="val">Value to populate</param>
         /// <returns>true if a value exists for the key, false otherwise</returns>
-        bool tryGet(const K& key, V& val) const
+        template <typename Q>
+        bool tryGet(const Q& key, V& val) const
         {
-            const auto& it = m_map.find(key);
-            if (it == m_map.end())
+            int pos = find(key, hashOf(key));
+            if (pos < 0)
                 return false;
 
-            val = m_vec[it->second].second;
+            val = m_vec[pos].second;
             return true;
         }
 
@@ -105,6 +163,7 @@ namespace mscript
         /// </summary>
         std::vector<K> keys() const
         {
+            compact();
             std::vector<K> retVal;
             retVal.reserve(m_vec.size());
             for (size_t k = 0; k < m_vec.size(); ++k)
@@ -117,6 +176,7 @@ namespace mscript
         /// </summary>
         std::vector<V> values() const
         {
+            compact();
             std::vector<V> retVal;
             retVal.reserve(m_vec.size());
             for (size_t v = 0; v < m_vec.size(); ++v)
@@ -125,7 +185,121 @@ namespace mscript
         }
 
     private:
-        std::unordered_map<K, size_t> m_map;
-        std::vector<std::pair<K, V>> m_vec;
+        // Slots hold positions in the vector, or one of these
+        static constexpr int32_t sm_emptySlot = -1;
+        static constexpr int32_t sm_erasedSlot = -2;
+
+        template <typename Q>
+        static size_t hashOf(const Q& key)
+        {
+            return H()(key);
+        }
+
+        /// <summary>
+        /// Find the position of a key in the vector, or -1 if it's not there
+        /// Hashes are compared before keys, so keys that could not be compared
+        /// with each other only get compared if their hashes match
+        /// </summary>
+        template <typename Q>
+        int find(const Q& key, size_t hash, size_t* foundSlot = nullptr) const
+        {
+            if (m_slots.empty())
+                return -1;
+
+            size_t mask = m_slots.size() - 1;
+            size_t perturb = hash;
+            for (size_t slot = hash & mask; ; slot = (slot * 5 + 1 + perturb) & mask)
+            {
+                int32_t pos = m_slots[slot];
+                if (pos == sm_emptySlot)
+                    return -1;
+
+                if (pos >= 0 && m_hashes[pos] == hash && m_vec[pos].first == key)
+                {
+                    if (foundSlot != nullptr)
+                        *foundSlot = slot;
+                    return pos;
+                }
+
+                perturb >>= 5;
+            }
+        }
+
+        /// <summary>
+        /// Put a position into the first open slot for its hash
+        /// </summary>
+        void insertSlot(size_t hash, int32_t pos) const
+        {
+            size_t mask = m_slots.size() - 1;
+            size_t perturb = hash;
+            size_t slot = hash & mask;
+            while (m_slots[slot] >= 0)
+            {
+                perturb >>= 5;
+                slot = (slot * 5 + 1 + perturb) & mask;
+            }
+
+            m_slots[slot] = pos;
+        }
+
+        /// <summary>
+        /// Make enough slots for a number of entries, at most two-thirds full
+        /// Erased entries still count until the vector is compacted,
+        /// so there are always empty slots to end probing
+        /// </summary>
+        void growSlots(size_t count)
+        {
+            size_t slotCount = 8;
+            while (count * 3 > slotCount * 2)
+                slotCount *= 2;
+            rebuildSlots(slotCount);
+        }
+
+        void rebuildSlots(size_t slotCount) const
+        {
+            m_slots.assign(slotCount, sm_emptySlot);
+            for (size_t pos = 0; pos < m_vec.size(); ++pos)
+            {
+                if (m_erased.empty() || !m_erased[pos])
+                    insertSlot(m_hashes[pos], int32_t(pos));
+            }
+        }
+
+        /// <summary>
+        /// Remove erased entries from the vector,
+        /// keeping the order of the others, then point the slots at their new positions
+        /// </summary>
+        void compact() const
+        {
+            if (m_erasedCount == 0)
+                return;
+
+            size_t to = 0;
+            for (size_t from = 0; from < m_vec.size(); ++from)
+            {
+                if (m_erased[from])
+                    continue;
+
+                if (to != from)
+                {
+                    m_vec[to] = std::move(m_vec[from]);
+                    m_hashes[to] = m_hashes[from];
+                }
+                ++to;
+            }
+            m_vec.resize(to);
+            m_hashes.resize(to);
+            m_erased.clear();
+            m_erasedCount = 0;
+
+            rebuildSlots(m_slots.size());
+        }
+
+        // Compacting is done on demand by const members, so these are mutable
+        mutable std::vector<std::pair<K, V>> m_vec;
+        mutable std::vector<size_t> m_hashes;
+        mutable std::vector<int32_t> m_slots;
+        mutable std::vector<bool> m_erased; // empty unless something has been erased
+        mutable size_t m_erasedCount = 0;
     };
 }
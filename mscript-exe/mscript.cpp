@@ -96,15 +96,13 @@ static std::wstring getModuleFilePath(const std::wstring& filename)
 		raiseWError(L"Invalid module file path: " + filename);
 	}
 
-	const unsigned int max_path = 32 * 1024;
-	std::unique_ptr<wchar_t[]> exe_file_path(new wchar_t[max_path + 1]);
-	exe_file_path[max_path] = '\0';
-#if defined(_WIN32) || defined(_WIN64)
-	if (GetModuleFileName(NULL, exe_file_path.get(), max_path) == 0)
-		raiseError("Loading mscript.exe file path failed");
-#endif
-	fs::path exe_dir_path = fs::path(exe_file_path.get()).parent_path();
+	fs::path exe_dir_path = fs::path(getExeFilePath()).parent_path();
 	fs::path module_file_path = exe_dir_path.append(filename);
+#if !defined(_WIN32) && !defined(_WIN64)
+	// Scripts import modules as .dll files, which are .so files here
+	if (toLower(module_file_path.extension().wstring()) == L".dll")
+		module_file_path.replace_extension(L".so");
+#endif
 	return module_file_path;
 }
 
@@ -114,7 +112,8 @@ int wmain(int argc, wchar_t* argv[])
 	{
 		std::cout << std::endl;
 
-		std::cout << "Usage: mscript4 <script path> ..." << std::endl;
+		std::cout << "Usage: mscript4 [-bytecode] <script path> ..." << std::endl;
+		std::cout << "  -bytecode: compile the script to bytecode and run that" << std::endl;
 		
 		std::cout << std::endl;
 
@@ -126,10 +125,20 @@ int wmain(int argc, wchar_t* argv[])
 	}
 	try
 	{
-		std::wstring scriptPath = argv[1];
+		int scriptArg = 1;
+		script_processor::execution_engine engine = script_processor::TREE_WALKER;
+		if (_wcsicmp(argv[scriptArg], L"-bytecode") == 0)
+		{
+			engine = script_processor::BYTECODE;
+			++scriptArg;
+			if (scriptArg >= argc)
+				raiseError("Missing script path after -bytecode");
+		}
+
+		std::wstring scriptPath = argv[scriptArg];
 
 		object::list arguments;
-		for (int a = 2; a < argc; ++a)
+		for (int a = scriptArg + 1; a < argc; ++a)
 			arguments.push_back(std::wstring(argv[a]));
 
 		symbol_table symbols;
@@ -161,6 +170,7 @@ int wmain(int argc, wchar_t* argv[])
 					printf("%S\n", text.c_str()); 
 				}
 			);
+		processor.setEngine(engine);
 		object retVal = processor.process(std::wstring(), scriptPath);
 		if (retVal.type() == object::NUMBER)
 			return int(retVal.numberVal());
@@ -0,0 +1,449 @@
+#include "pch.h"
+#include "bytecode.h"
+#include "utils.h"
+
+namespace mscript
+{
+    /// <summary>
+    /// bytecode_compiler walks statements and expressions,
+    /// adding instructions to a chunk and patching jumps once their targets are known
+    /// </summary>
+    class bytecode_compiler
+    {
+    public:
+        bytecode_compiler(bytecode_chunk& chunk) : m_chunk(chunk) {}
+
+        int here() const { return int(m_chunk.code.size()); }
+
+        int emit(instruction::op_code op, int arg = 0, const statement* stmt = nullptr, const expression_node* node = nullptr)
+        {
+            instruction instr;
+            instr.op = op;
+            instr.arg = arg;
+            instr.stmt = stmt;
+            instr.node = node;
+            m_chunk.code.push_back(instr);
+            return here() - 1;
+        }
+
+        void patch(int pc, int arg) { m_chunk.code[pc].arg = arg; }
+        void patch2(int pc, int arg2) { m_chunk.code[pc].arg2 = arg2; }
+
+        int message(const std::wstring& msg)
+        {
+            m_chunk.messages.push_back(msg);
+            return int(m_chunk.messages.size()) - 1;
+        }
+
+        void raise(const std::wstring& msg)
+        {
+            emit(instruction::RAISE, message(msg));
+        }
+
+        void compileExpression(const expression_node& node, bool allowDynamicCalls)
+        {
+            switch (node.type)
+            {
+            case expression_node::LITERAL:
+                emit(instruction::PUSH_VALUE, 0, nullptr, &node);
+                break;
+
+            case expression_node::VARIABLE:
+                emit(instruction::PUSH_VARIABLE, 0, nullptr, &node);
+                break;
+
+            case expression_node::BINARY_OP:
+            {
+                int shortCircuit = -1;
+                compileExpression(*node.children[0], allowDynamicCalls);
+                if (node.op == expression_node::AND)
+                    shortCircuit = emit(instruction::AND);
+                else if (node.op == expression_node::OR)
+                    shortCircuit = emit(instruction::OR);
+
+                compileExpression(*node.children[1], allowDynamicCalls);
+                emit(instruction::BINARY_OP, 0, nullptr, &node);
+                if (shortCircuit >= 0)
+                    patch(shortCircuit, here());
+                break;
+            }
+
+            case expression_node::NEGATE:
+                compileExpression(*node.children[0], allowDynamicCalls);
+                emit(instruction::NEGATE);
+                break;
+
+            case expression_node::NOT:
+                compileExpression(*node.children[0], allowDynamicCalls);
+                emit(instruction::NOT);
+                break;
+
+            case expression_node::CALL:
+                for (const auto& child : node.children)
+                    compileExpression(*child, allowDynamicCalls);
+                emit(allowDynamicCalls ? instruction::CALL_DYNAMIC : instruction::CALL, int(node.children.size()), nullptr, &node);
+                break;
+
+            case expression_node::GROUP:
+                for (const auto& child : node.children)
+                    compileExpression(*child, allowDynamicCalls);
+                emit(instruction::GROUP, int(node.children.size()));
+                break;
+
+            case expression_node::ERROR:
+                emit(instruction::THROW_VALUE, 0, nullptr, &node);
+                break;
+
+            default:
+                raiseError("Invalid expression node type: " + num2str(int(node.type)));
+            }
+        }
+
+        /// <summary>
+        /// A nested block runs in its own frame, like a symbol_stacker around processing it
+        /// </summary>
+        void compileFramedBlock(const statement_block& statements)
+        {
+            emit(instruction::PUSH_FRAME);
+            compileBlock(statements);
+            emit(instruction::POP_FRAME);
+        }
+
+        int compileBlock(const statement_block& statements)
+        {
+            int blockId = int(m_chunk.blocks.size());
+            m_chunk.blocks.emplace_back();
+            m_chunk.blocks[blockId].statements = &statements;
+
+            emit(instruction::BEGIN_BLOCK, blockId);
+            for (int s = 0; s < int(statements.size()); ++s)
+            {
+                const statement& stmt = statements[s];
+                emit(instruction::STATEMENT, s, &stmt);
+                if (stmt.type == statement::HANDLER)
+                    m_chunk.blocks[blockId].handlers.emplace_back(s, here());
+                compileStatement(stmt);
+            }
+            m_chunk.blocks[blockId].endPc = emit(instruction::END_BLOCK, blockId);
+            return blockId;
+        }
+
+        void compileStatement(const statement& stmt)
+        {
+            switch (stmt.type)
+            {
+            case statement::ERROR:
+                emit(instruction::THROW_ERROR, 0, &stmt);
+                break;
+
+            case statement::DECLARE:
+                if (stmt.exp)
+                {
+                    compileExpression(*stmt.exp, false);
+                    emit(instruction::SET, 0, &stmt);
+                }
+                else
+                    emit(instruction::SET_NULL, 0, &stmt);
+                break;
+
+            case statement::ASSIGN:
+                if (!stmt.appends.empty()) // & x = x + a + b..., adding onto x where it is
+                {
+                    for (const auto& add : stmt.appends)
+                        compileExpression(*add->children[1], stmt.allowDynamicCalls);
+                    emit(instruction::APPEND, int(stmt.appends.size()), &stmt);
+                    break;
+                }
+                compileExpression(*stmt.exp, stmt.allowDynamicCalls);
+                emit(instruction::ASSIGN, 0, &stmt);
+                break;
+
+            case statement::EVALUATE:
+                compileExpression(*stmt.exp, stmt.allowDynamicCalls);
+                emit(instruction::POP);
+                break;
+
+            case statement::HANDLER:
+            {
+                int skip = emit(instruction::HANDLER, 0, &stmt);
+                emit(instruction::PUSH_FRAME);
+                emit(instruction::SET_EXCEPTION, 0, &stmt);
+                compileBlock(stmt.body);
+                emit(instruction::POP_FRAME);
+                emit(instruction::PROPAGATE);
+                patch(skip, here());
+                break;
+            }
+
+            case statement::INFINITE_LOOP:
+            {
+                int top = here();
+                compileFramedBlock(stmt.body);
+                int end = emit(instruction::LOOP_END, top);
+                patch2(end, here());
+                break;
+            }
+
+            case statement::SCOPE:
+                compileFramedBlock(stmt.body);
+                emit(instruction::PROPAGATE);
+                break;
+
+            case statement::RETURN:
+                if (stmt.exp)
+                    compileExpression(*stmt.exp, false);
+                emit(instruction::RETURN, stmt.exp ? 1 : 0);
+                break;
+
+            case statement::COUNT_UP:
+            case statement::COUNT_DOWN:
+            case statement::COUNT:
+            {
+                compileExpression(*stmt.exp, false);
+                emit(instruction::CHECK_FROM);
+                compileExpression(*stmt.exp2, false);
+                emit(instruction::CHECK_TO);
+                emit(instruction::COUNT_BEGIN, 0, &stmt);
+
+                // the frame of the body is popped by COUNT_NEXT,
+                // after it looks at the loop variable from inside the body
+                int top = emit(instruction::COUNT_TEST, 0, &stmt);
+                emit(instruction::PUSH_FRAME);
+                compileBlock(stmt.body);
+                int next = emit(instruction::COUNT_NEXT, top, &stmt);
+
+                int exit = emit(instruction::LOOP_POP);
+                patch(top, exit);
+                patch2(next, exit);
+                break;
+            }
+
+            case statement::IMPORT:
+                compileExpression(*stmt.exp, false);
+                emit(instruction::IMPORT, 0, &stmt);
+                break;
+
+            case statement::IF:
+            {
+                // The checks on the order of the branches only depend on the branches,
+                // but they raise errors when reached, so they are compiled into raises in place
+                std::vector<int> ends;
+                bool seenQuestion = false;
+                bool seenEndingElse = false;
+                for (const auto& branch : stmt.branches)
+                {
+                    if (branch.type == statement_branch::UNFINISHED)
+                    {
+                        raise(L"No ? or <> at end of statement");
+                        break;
+                    }
+
+                    int test = -1;
+                    if (branch.type == statement_branch::CRITERIA)
+                    {
+                        seenQuestion = true;
+                        if (seenEndingElse)
+                        {
+                            raise(L"Already seen <> statement");
+                            break;
+                        }
+
+                        compileExpression(*branch.criteria, false);
+                        test = emit(instruction::IF_TEST);
+                    }
+                    else if (branch.type == statement_branch::ELSE)
+                    {
+                        if (seenEndingElse)
+                        {
+                            raise(L"Already seen <> statement");
+                            break;
+                        }
+
+                        if (!seenQuestion)
+                        {
+                            raise(L"No ? statement before <> statement");
+                            break;
+                        }
+
+                        seenEndingElse = true;
+                    }
+                    else
+                    {
+                        raise(L"Invalid line, not ? or <>");
+                        break;
+                    }
+
+                    compileFramedBlock(branch.body);
+                    ends.push_back(emit(instruction::IF_END));
+                    if (test >= 0)
+                        patch(test, here());
+                }
+
+                for (int end : ends)
+                    patch(end, here());
+                break;
+            }
+
+            case statement::SWITCH:
+            {
+                // The switch value stays on the stack while the cases are checked
+                compileExpression(*stmt.exp, false);
+
+                std::vector<int> ends;
+                bool seenQuestion = false;
+                bool seenEndingElse = false;
+                for (const auto& branch : stmt.branches)
+                {
+                    if (branch.type == statement_branch::UNFINISHED)
+                    {
+                        raise(L"No = or <> at end of statement");
+                        break;
+                    }
+
+                    int test = -1;
+                    if (branch.type == statement_branch::CRITERIA)
+                    {
+                        seenQuestion = true;
+                        if (seenEndingElse)
+                        {
+                            raise(L"Already seen <> statement");
+                            break;
+                        }
+
+                        compileExpression(*branch.criteria, false);
+                        test = emit(instruction::CASE_TEST);
+                    }
+                    else if (branch.type == statement_branch::ELSE)
+                    {
+                        if (seenEndingElse)
+                        {
+                            raise(L"Already seen <> statement");
+                            break;
+                        }
+
+                        if (!seenQuestion)
+                        {
+                            raise(L"No = statement before <> statement");
+                            break;
+                        }
+
+                        seenEndingElse = true;
+                    }
+                    else
+                    {
+                        raise(L"Invalid line, not = or <>");
+                        break;
+                    }
+
+                    compileFramedBlock(branch.body);
+                    ends.push_back(emit(instruction::SWITCH_END));
+                    if (test >= 0)
+                        patch(test, here());
+                }
+
+                for (int end : ends)
+                    patch(end, here());
+                emit(instruction::POP);
+                break;
+            }
+
+            case statement::FOR_EACH:
+            {
+                if (isStreamFileLinesCall(*stmt.exp))
+                {
+                    for (const auto& child : stmt.exp->children)
+                        compileExpression(*child, false);
+                    emit(instruction::FOR_EACH_LINES, int(stmt.exp->children.size()), &stmt);
+                }
+                else
+                {
+                    compileExpression(*stmt.exp, false);
+                    emit(instruction::FOR_EACH_BEGIN, 0, &stmt);
+                }
+
+                int top = emit(instruction::FOR_EACH_NEXT, 0, &stmt);
+                compileBlock(stmt.body);
+                emit(instruction::POP_FRAME);
+                int next = emit(instruction::FOR_EACH_END, top);
+
+                int exit = emit(instruction::LOOP_POP);
+                patch(top, exit);
+                patch2(next, exit);
+                break;
+            }
+
+            case statement::FUNCTION:
+                emit(instruction::FUNCTION);
+                break;
+
+            case statement::CONTINUE:
+                emit(instruction::CONTINUE);
+                break;
+
+            case statement::BREAK:
+                emit(instruction::BREAK);
+                break;
+
+            case statement::TRACE:
+            {
+                int section = emit(instruction::TRACE_SECTION, 0, &stmt);
+                int level = -1;
+                if (stmt.exp2)
+                {
+                    compileExpression(*stmt.exp2, false);
+                    level = emit(instruction::TRACE_LEVEL, 0, &stmt);
+                    if (stmt.exp3)
+                    {
+                        compileExpression(*stmt.exp3, false);
+                        emit(instruction::PRINT);
+                    }
+                }
+                patch(section, here());
+                if (level >= 0)
+                    patch(level, here());
+                break;
+            }
+
+            case statement::PRINT:
+                if (stmt.exp)
+                {
+                    compileExpression(*stmt.exp, false);
+                    emit(instruction::PRINT);
+                }
+                else
+                    emit(instruction::PRINT_EMPTY);
+                break;
+
+            case statement::COMMAND_EXP:
+                compileExpression(*stmt.exp, false);
+                emit(instruction::COMMAND_EXP);
+                break;
+
+            case statement::SUPPRESS:
+                if (stmt.exp)
+                {
+                    compileExpression(*stmt.exp, false);
+                    emit(instruction::SUPPRESS);
+                }
+                else
+                    emit(instruction::SUPPRESS_NEXT);
+                break;
+
+            default: // a command line to run
+                emit(instruction::COMMAND, 0, &stmt);
+                break;
+            }
+        }
+
+    private:
+        bytecode_chunk& m_chunk;
+    };
+
+    bytecode_chunk compileBytecode(const statement_block& statements)
+    {
+        bytecode_chunk chunk;
+        bytecode_compiler compiler(chunk);
+        compiler.compileBlock(statements);
+        return chunk;
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "enumerator.h"
+#include "object.h"
+#include "statements.h"
+#include "user_exception.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mscript
+{
+    /// <summary>
+    /// An instruction is one step of compiled script for the script processor's virtual machine
+    /// Expressions work on a stack of values, statements pop what they need off the stack
+    /// </summary>
+    struct instruction
+    {
+        enum op_code
+        {
+            //
+            // Expressions
+            //
+            PUSH_VALUE,     // push node's literal value
+            PUSH_VARIABLE,  // push the value of node's variable
+            NEGATE,         // -top
+            NOT,            // !top
+            BINARY_OP,      // pop right and left, push node's operator applied to them
+            AND,            // left is on top, if it's false replace it with false and jump to arg
+            OR,             // left is on top, if it's true replace it with true and jump to arg
+            CALL,           // pop arg parameters, push calling node's function with them
+            CALL_DYNAMIC,   // CALL allowing function names in variables
+            GROUP,          // pop arg values, push the first one
+            THROW_VALUE,    // throw node's value
+            POP,            // drop top
+
+            //
+            // Blocks, where each one is like a call to process statements in the tree walker
+            //
+            BEGIN_BLOCK,    // start block arg
+            END_BLOCK,      // end the current block, its outcome is checked by what follows
+            STATEMENT,      // statement arg of the block starts, stmt is the statement
+            PUSH_FRAME,     // push a symbol table frame
+            POP_FRAME,      // pop a symbol table frame
+            JUMP,           // go to arg
+
+            //
+            // Statements
+            //
+            THROW_ERROR,    // throw the stmt's error
+            RAISE,          // raise chunk message arg
+            SET,            // pop into a new variable
+            SET_NULL,       // new variable with no value
+            ASSIGN,         // pop into an existing variable
+            APPEND,         // pop arg values and add them onto stmt's variable, strings in place
+            HANDLER,        // if there's no exception to handle jump to arg
+            SET_EXCEPTION,  // new variable with the exception being handled
+            PROPAGATE,      // a block's return, continue, or break goes to the end of the current block
+            IF_TEST,        // pop condition, jump to arg if false
+            IF_END,         // take the block's outcome, jump to arg if there's nothing to do with it
+            CASE_TEST,      // pop case value, jump to arg if it's not the switch value under it
+            SWITCH_END,     // take the block's outcome, jump to arg unless returning or continuing
+            LOOP_END,       // after an O body, jump to the top at arg or the exit at arg2
+            CHECK_FROM,     // top must be a number to count from
+            CHECK_TO,       // top must be a number to count to
+            COUNT_BEGIN,    // pop to and from, push a loop state and a frame with the loop variable
+            COUNT_TEST,     // if counting is done jump to arg, otherwise set the loop variable
+            COUNT_NEXT,     // after a count body, jump to the top at arg or the exit at arg2
+            FOR_EACH_BEGIN, // pop the value to enumerate, push a loop state and a frame with the loop variable
+            FOR_EACH_LINES, // FOR_EACH_BEGIN with the lines of a file, popping arg parameters of streamFileLines()
+            FOR_EACH_NEXT,  // if enumerating is done jump to arg, otherwise push a frame with the next value
+            FOR_EACH_END,   // after a for each body, jump to the top at arg or the exit at arg2
+            LOOP_POP,       // drop the loop state and the loop variable's frame
+            FUNCTION,       // functions can only be declared at the top level
+            CONTINUE,       // continue out of the current block
+            BREAK,          // break out of the current block
+            RETURN,         // return out of the current block, popping the return value if arg is 1
+            TRACE_SECTION,  // if the trace section is not active jump to arg
+            TRACE_LEVEL,    // pop the trace level, if it's not active jump to arg
+            PRINT,          // pop and output
+            PRINT_EMPTY,    // output an empty line
+            COMMAND,        // run stmt's line
+            COMMAND_EXP,    // pop the command to run
+            SUPPRESS,       // pop the command to run, without raising an error if it fails
+            SUPPRESS_NEXT,  // don't raise an error if the next command fails
+            IMPORT          // pop the script or module to import
+        };
+
+        op_code op = POP;
+        int arg = 0;
+        int arg2 = 0;
+
+        const statement* stmt = nullptr;
+        const expression_node* node = nullptr;
+    };
+
+    /// <summary>
+    /// A bytecode_block is a statement_block in compiled form,
+    /// with where to go to handle exceptions raised by its statements
+    /// </summary>
+    struct bytecode_block
+    {
+        const statement_block* statements = nullptr;
+
+        int endPc = -1;
+
+        // Statement index and where to start the statement for each ! statement in the block
+        std::vector<std::pair<int, int>> handlers;
+    };
+
+    /// <summary>
+    /// A bytecode_chunk is a script or function body compiled for the virtual machine
+    /// The chunk points into the statements it was compiled from,
+    /// so they have to outlive it
+    /// </summary>
+    struct bytecode_chunk
+    {
+        std::vector<instruction> code;
+        std::vector<bytecode_block> blocks;
+        std::vector<std::wstring> messages;
+    };
+
+    /// <summary>
+    /// A vm_block is a block being run, what a call to process statements is in the tree walker
+    /// </summary>
+    struct vm_block
+    {
+        int blockId = -1;
+        int current = -1; // statement being run
+
+        // What to put back when leaving the block or handling an exception in it
+        int frameCount = 0;
+        size_t stackSize = 0;
+        size_t loopCount = 0;
+
+        // The exception being handled, kept off to the side so blocks stay small to start and end
+        std::unique_ptr<user_exception> curException;
+        bool isHandling() const { return curException && curException->obj.type() != object::NOTHING; }
+
+        bool Continue = false;
+        bool Leave = false;
+        bool Return = false;
+        object ReturnValue;
+    };
+
+    /// <summary>
+    /// A vm_loop is the state of a counting or for each loop being run
+    /// </summary>
+    struct vm_loop
+    {
+        int64_t index = 0;
+        int64_t to = 0;
+        int64_t step = 1;
+        bool countUp = true;
+
+        enumerator_ptr items;
+    };
+
+    /// <summary>
+    /// Compile statements into bytecode, the whole thing being block 0
+    /// </summary>
+    bytecode_chunk compileBytecode(const statement_block& statements);
+}
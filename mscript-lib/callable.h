@@ -3,10 +3,15 @@
 #include "object.h"
 #include "utils.h"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 
 namespace mscript
 {
+    struct script_function;
+
     /// <summary>
     /// Since expressions can involve function calls, 
     /// expressions need ways of calling functions
@@ -18,6 +23,33 @@ namespace mscript
         virtual ~callable() {}
         virtual bool hasFunction(const std::wstring& name) const = 0;
         virtual object callFunction(const std::wstring& name, const object::list& parameters) = 0;
+
+        /// <summary>
+        /// Callables with script functions return them here
+        /// so call sites can hold onto them and call them directly
+        /// </summary>
+        virtual std::shared_ptr<script_function> findFunction(const std::wstring& nameLower) const
+        {
+            (void)nameLower;
+            return nullptr;
+        }
+
+        virtual object callScriptFunction(const script_function& function, const object::list& parameters)
+        {
+            (void)function;
+            (void)parameters;
+            raiseError("callable has no script functions");
+        }
+
+        /// <summary>
+        /// Call sites keep what they resolved to until scripts or modules add functions
+        /// Whatever adds functions calls functionsChanged()
+        /// </summary>
+        static uint64_t functionsGeneration() { return sm_functionsGeneration; }
+        static void functionsChanged() { ++sm_functionsGeneration; }
+
+    private:
+        inline static std::atomic<uint64_t> sm_functionsGeneration = 1;
     };
 
     /// <summary>
@@ -0,0 +1,213 @@
+#include "pch.h"
+#include "enumerator.h"
+#include "mapped_file.h"
+#include "utils.h"
+
+#include <filesystem>
+
+namespace mscript
+{
+    class string_enumerator : public enumerator
+    {
+    public:
+        string_enumerator(const object& str) : m_str(str) {}
+
+        bool next(object& value) override
+        {
+            if (m_str.isAsciiString())
+            {
+                const std::string& str = std::as_const(m_str).asciiVal();
+                if (m_next >= str.size())
+                    return false;
+
+                value = object::fromUtf8(std::string_view(str.data() + m_next++, 1));
+                return true;
+            }
+
+            const std::wstring& str = m_str.stringVal();
+            if (m_next >= str.size())
+                return false;
+
+            value = std::wstring{ str[m_next++] };
+            return true;
+        }
+
+    private:
+        object m_str;
+        size_t m_next = 0;
+    };
+
+    // Lists and indexes are enumerated from a copyValue() of them,
+    // which only copies the items if the loop changes the list or index
+    class list_enumerator : public enumerator
+    {
+    public:
+        list_enumerator(const object& list) : m_list(list.copyValue()) {}
+
+        bool next(object& value) override
+        {
+            const object::list& values = m_list.listVal();
+            if (m_next >= values.size())
+                return false;
+
+            value = values[m_next++];
+            return true;
+        }
+
+    private:
+        const object m_list;
+        size_t m_next = 0;
+    };
+
+    class index_keys_enumerator : public enumerator
+    {
+    public:
+        index_keys_enumerator(const object& index) : m_index(index.copyValue()) {}
+
+        bool next(object& value) override
+        {
+            const auto& entries = m_index.indexVal().vec();
+            if (m_next >= entries.size())
+                return false;
+
+            value = entries[m_next++].first;
+            return true;
+        }
+
+    private:
+        const object m_index;
+        size_t m_next = 0;
+    };
+
+    class range_enumerator : public enumerator
+    {
+    public:
+        range_enumerator(const object::range& range) : m_range(range) {}
+
+        bool next(object& value) override
+        {
+            if (m_next >= m_range.count)
+                return false;
+
+            value = m_range.at(m_next++);
+            return true;
+        }
+
+    private:
+        object::range m_range;
+        size_t m_next = 0;
+    };
+
+    // ASCII and UTF-8 files are mapped and decoded a line at a time
+    class mapped_lines_enumerator : public enumerator
+    {
+    public:
+        mapped_lines_enumerator(std::unique_ptr<mapped_file>&& file)
+            : m_file(std::move(file))
+            , m_reader(m_file->view())
+        {}
+
+        bool next(object& value) override
+        {
+            std::string_view line;
+            if (!m_reader.next(line))
+                return false;
+
+            if (line.find('\r') == std::string_view::npos)
+            {
+                value = object::fromUtf8(line);
+            }
+            else
+            {
+                m_withoutCrs.assign(line);
+                m_withoutCrs.erase(std::remove(m_withoutCrs.begin(), m_withoutCrs.end(), '\r'), m_withoutCrs.end());
+                value = object::fromUtf8(m_withoutCrs);
+            }
+            return true;
+        }
+
+    private:
+        std::unique_ptr<mapped_file> m_file;
+        line_reader m_reader;
+        std::string m_withoutCrs;
+    };
+
+    class stream_lines_enumerator : public enumerator
+    {
+    public:
+        stream_lines_enumerator(const std::wstring& filePath) : m_file(std::filesystem::path(filePath)) {}
+
+        bool isOpen() const { return bool(m_file); }
+
+        bool next(object& value) override
+        {
+            if (!std::getline(m_file, m_line))
+                return false;
+
+            value = replace(m_line, L"\r", L"");
+            return true;
+        }
+
+    private:
+        std::wifstream m_file;
+        std::wstring m_line;
+    };
+
+    enumerator_ptr enumerate(const object& value)
+    {
+        switch (value.type())
+        {
+        case object::STRING:
+            return std::make_unique<string_enumerator>(value);
+
+        case object::LIST:
+            return std::make_unique<list_enumerator>(value);
+
+        case object::INDEX:
+            return std::make_unique<index_keys_enumerator>(value);
+
+        case object::RANGE:
+            return std::make_unique<range_enumerator>(value.rangeVal());
+
+        default:
+            raiseError("@ statements only work with strings, lists, indexes, and ranges");
+        }
+    }
+
+    bool isStreamFileLinesCall(const expression_node& node)
+    {
+        // Built-in functions come before script functions, so the name is all it takes
+        return node.type == expression_node::CALL && toLower(node.name) == L"streamfilelines";
+    }
+
+    enumerator_ptr enumerateFileLines(const object::list& paramList)
+    {
+        if (paramList.size() != 2
+            || paramList[0].type() != object::STRING
+            || paramList[1].type() != object::STRING)
+        {
+            raiseError("streamFileLines() works with a file path string and an encoding string");
+        }
+
+        const std::wstring& filePath = paramList[0].stringVal();
+        const std::wstring& encoding = paramList[1].stringVal();
+
+        if (encoding == L"ascii" || encoding == L"utf-8" || encoding == L"utf8")
+        {
+            auto file = std::make_unique<mapped_file>(filePath);
+            if (!file->isOpen())
+                return nullptr;
+            return std::make_unique<mapped_lines_enumerator>(std::move(file));
+        }
+
+        if (encoding == L"utf-16" || encoding == L"utf16")
+        {
+            auto lines = std::make_unique<stream_lines_enumerator>(filePath);
+            if (!lines->isOpen())
+                return nullptr;
+            return lines;
+        }
+
+        raiseError("Unsupported streamFileLines() encoding: must be ascii, utf-8, or utf-16");
+    }
+}
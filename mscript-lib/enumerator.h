@@ -0,0 +1,48 @@
+#pragma once
+
+#include "expression_tree.h"
+#include "object.h"
+
+#include <memory>
+#include <string>
+
+namespace mscript
+{
+    /// <summary>
+    /// An enumerator hands out the values an @ loop goes over, one at a time,
+    /// so loops don't make a list of everything they go over first
+    /// </summary>
+    class enumerator
+    {
+    public:
+        virtual ~enumerator() {}
+
+        /// <summary>
+        /// Get the next value
+        /// Returns false when there are no more values
+        /// </summary>
+        virtual bool next(object& value) = 0;
+    };
+    typedef std::unique_ptr<enumerator> enumerator_ptr;
+
+    /// <summary>
+    /// Enumerate the characters of a string, the items of a list, the keys of an index,
+    /// or the numbers of a range
+    /// Lists and indexes are enumerated as they were when the loop started,
+    /// without copying them unless the loop changes them
+    /// Other values raise an error
+    /// </summary>
+    enumerator_ptr enumerate(const object& value);
+
+    /// <summary>
+    /// Is this a call to streamFileLines(), which @ loops read a line at a time
+    /// instead of reading the whole file into a list
+    /// </summary>
+    bool isStreamFileLinesCall(const expression_node& node);
+
+    /// <summary>
+    /// Enumerate the lines of a file, given streamFileLines() parameters
+    /// Returns nullptr if the file could not be opened
+    /// </summary>
+    enumerator_ptr enumerateFileLines(const object::list& paramList);
+}
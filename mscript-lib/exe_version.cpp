@@ -2,6 +2,8 @@
 #include "exe_version.h"
 #include "utils.h"
 
+#include <filesystem>
+
 std::wstring mscript::getExeFilePath()
 {
 #if defined(_WIN32) || defined(_WIN64)
@@ -12,6 +14,12 @@ std::wstring mscript::getExeFilePath()
 	if (dw_exe_file_path == 0 || dw_exe_file_path >= exe_file_path_size)
 		raiseError("Getting EXE file path failed");
 	return exe_file_path.get();
+#else
+	std::error_code error;
+	std::filesystem::path exe_file_path = std::filesystem::read_symlink("/proc/self/exe", error);
+	if (error)
+		raiseError("Getting EXE file path failed");
+	return exe_file_path.wstring();
 #endif
 }
 
@@ -51,5 +59,9 @@ std::string mscript::getBinaryVersion(const std::wstring& filePath)
 	}
 	else
 		return "0.0.0.0";
+#else
+	// ELF binaries don't carry a version resource
+	(void)filePath;
+	return "0.0.0.0";
 #endif
 }
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "object.h"
+#include "symbols.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mscript
+{
+    struct expression_node;
+    typedef std::shared_ptr<const expression_node> expression_node_ptr;
+
+    class callable;
+    class expression;
+    class lib;
+    struct script_function;
+
+    typedef std::function<object(expression& exp, object& first, const object::list& paramList)> built_in_function;
+
+    /// <summary>
+    /// A call_target is what a function call resolved to,
+    /// so the call can go right to it without looking the function up by name
+    /// Targets are resolved again when imports add functions
+    /// </summary>
+    struct call_target
+    {
+        enum target_type
+        {
+            UNRESOLVED,     // not resolved yet, or function definitions have changed since
+            BUILT_IN,       // builtIn is the function
+            SCRIPT,         // scriptFunction is the function
+            CALLABLE,       // the callable has a function by name, like input()
+            MODULE,         // module exports the function name
+            MEMBER,         // x.func(), memberOf is x, member is what func resolved to
+            OTHER           // not a function we know about, dynamic calls and errors happen by name
+        };
+
+        target_type type = UNRESOLVED;
+
+        // What the target was resolved with, so it can be resolved again when these change
+        uint64_t generation = 0;
+        const callable* resolver = nullptr;
+
+        std::wstring name; // lower-cased function name
+
+        const built_in_function* builtIn = nullptr;
+        bool changesFirst = false; // add() and set() change their first parameter
+        std::shared_ptr<script_function> scriptFunction;
+        std::shared_ptr<lib> module;
+
+        symbol_ref memberOf;
+        std::shared_ptr<call_target> member;
+    };
+
+    /// <summary>
+    /// An expression_node is one piece of a compiled expression
+    /// Expression strings are parsed once into a tree of these,
+    /// then the tree is walked to evaluate the expression
+    /// </summary>
+    struct expression_node
+    {
+        enum node_type
+        {
+            LITERAL,        // value
+            VARIABLE,       // symbol is the variable
+            BINARY_OP,      // op, children are the left and right sides
+            NEGATE,         // -children[0]
+            NOT,            // !children[0]
+            CALL,           // name is the function, children are the parameters
+            GROUP,          // (children...), the value is the first child
+            ERROR           // value is what to throw when evaluated
+        };
+
+        /// <summary>
+        /// Binary operators, parsed once from the operator text
+        /// The symbol and word forms of an operator are the same operator,
+        /// except that < and > compare strings ignoring case, and LSS and GTR do not
+        /// </summary>
+        enum op_type
+        {
+            NO_OP,
+            OR,                 // || OR
+            AND,                // && AND
+            NOT_EQUAL,          // <> != NEQ
+            LESS_OR_EQUAL,      // <= LEQ
+            GREATER_OR_EQUAL,   // >= GEQ
+            LESS,               // <
+            LSS,
+            GREATER,            // >
+            GTR,
+            EQUAL,              // == = EQU
+            MODULO,             // %
+            SUBTRACT,           // -
+            ADD,                // +
+            DIVIDE,             // /
+            MULTIPLY,           // *
+            POWER               // ^
+        };
+
+        node_type type = ERROR;
+
+        object value;
+
+        op_type op = NO_OP;
+        std::wstring name;
+        symbol_ref symbol;
+
+        // The trimmed expression text this node was compiled from, for error messages
+        std::wstring text;
+
+        std::vector<expression_node_ptr> children;
+
+        // CALL nodes resolve their function the first time they are evaluated
+        mutable call_target target;
+    };
+
+    /// <summary>
+    /// expression_cache holds compiled expressions by expression text
+    /// so each expression string only gets parsed once,
+    /// starting over when it fills up with one-off eval() strings
+    /// </summary>
+    class expression_cache
+    {
+    public:
+        /// <summary>
+        /// Get the compiled form of an expression, compiling it if it's new
+        /// </summary>
+        expression_node_ptr get(const std::wstring& expStr);
+
+        size_t size() const { return m_nodes.size(); }
+        void clear() { m_nodes.clear(); }
+
+    private:
+        std::unordered_map<std::wstring, expression_node_ptr> m_nodes;
+        static const size_t sm_maxNodes = 1000;
+    };
+}
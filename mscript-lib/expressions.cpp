@@ -6,7 +6,10 @@
 #include "exe_version.h"
 #include "parse_args.h"
 #include "object_json.h"
+#include "enumerator.h"
 #include "lib.h"
+#include "mapped_file.h"
+#include "regex_cache.h"
 
 #undef min
 #undef max
@@ -53,141 +56,281 @@ namespace mscript
         "^",
     };
 
-    object expression::evaluate(std::wstring expStr)
+    /// <summary>
+    /// Map operator text from sm_ops to the operator
+    /// </summary>
+    static expression_node::op_type opType(const std::string& op)
+    {
+        static std::unordered_map<std::string, expression_node::op_type> opTypes
+        {
+            { "||", expression_node::OR },
+            { "OR", expression_node::OR },
+
+            { "&&", expression_node::AND },
+            { "AND", expression_node::AND },
+
+            { "<>", expression_node::NOT_EQUAL },
+            { "!=", expression_node::NOT_EQUAL },
+            { "NEQ", expression_node::NOT_EQUAL },
+
+            { "<=", expression_node::LESS_OR_EQUAL },
+            { "LEQ", expression_node::LESS_OR_EQUAL },
+
+            { ">=", expression_node::GREATER_OR_EQUAL },
+            { "GEQ", expression_node::GREATER_OR_EQUAL },
+
+            { "<", expression_node::LESS },
+            { "LSS", expression_node::LSS },
+
+            { ">", expression_node::GREATER },
+            { "GTR", expression_node::GTR },
+
+            { "==", expression_node::EQUAL },
+            { "=", expression_node::EQUAL },
+            { "EQU", expression_node::EQUAL },
+
+            { "%", expression_node::MODULO },
+            { "-", expression_node::SUBTRACT },
+            { "+", expression_node::ADD },
+            { "/", expression_node::DIVIDE },
+            { "*", expression_node::MULTIPLY },
+            { "^", expression_node::POWER },
+        };
+
+        const auto& it = opTypes.find(op);
+        if (it == opTypes.end())
+            raiseError("Invalid operator: " + op);
+        return it->second;
+    }
+
+    expression_node_ptr expression_cache::get(const std::wstring& expStr)
+    {
+        const auto& it = m_nodes.find(expStr);
+        if (it != m_nodes.end())
+            return it->second;
+
+        if (m_nodes.size() >= sm_maxNodes)
+            m_nodes.clear();
+
+        expression_node_ptr node = expression::compile(expStr);
+        m_nodes.insert({ expStr, node });
+        return node;
+    }
+
+    object expression::evaluate(const std::wstring& expStr)
     {
-        expStr = trim(expStr);
-        std::string upper = toNarrowStr(toUpper(expStr));
-        std::string narrow = toNarrowStr(expStr);
+        if (m_cache != nullptr)
+            return evaluate(*m_cache->get(expStr));
+        else
+            return evaluate(*compile(expStr));
+    }
+
+    expression_node_ptr expression::compile(std::wstring_view expStr)
+    {
+        try
+        {
+            return foldConstants(compileNode(trimView(expStr)));
+        }
+        catch (const user_exception& exp)
+        {
+            // Parsing errors are raised when the expression is evaluated,
+            // so that short circuiting skips over them like it always has
+            auto node = std::make_shared<expression_node>();
+            node->type = expression_node::ERROR;
+            node->value = exp.obj;
+            node->text.assign(expStr);
+            return node;
+        }
+    }
+
+    expression_node_ptr expression::foldConstants(const expression_node_ptr& node)
+    {
+        // Built-in functions that only work with their parameters,
+        // so calling them with literals always gives the same answer
+        static std::unordered_set<std::wstring> pureFunctions
+        {
+            L"abs", L"sqrt", L"ceil", L"floor", L"exp", L"log", L"log2", L"log10",
+            L"sin", L"cos", L"tan", L"asin", L"acos", L"atan", L"sinh", L"cosh", L"tanh", L"round",
+            L"gettype", L"number", L"string", L"length",
+            L"trimmed", L"toupper", L"tolower", L"replaced",
+            L"firstlocation", L"lastlocation", L"subset",
+            L"htmlencoded", L"htmldecoded", L"urlencoded", L"urldecoded",
+        };
+
+        switch (node->type)
+        {
+        case expression_node::BINARY_OP:
+        case expression_node::NEGATE:
+        case expression_node::NOT:
+        case expression_node::GROUP:
+            break;
+
+        case expression_node::CALL:
+            if (pureFunctions.find(toLower(node->name)) == pureFunctions.end())
+                return node;
+            break;
+
+        default:
+            return node;
+        }
+
+        for (const auto& child : node->children)
+        {
+            if (child->type != expression_node::LITERAL)
+                return node;
+        }
+
+        // Evaluate the node now, leaving it be if that raises an error
+        // so that the error is raised when it's evaluated, like always
+        object value;
+        try
+        {
+            symbol_table symbols;
+            no_op_callable callable;
+            tracing traceInfo;
+            expression exp(symbols, callable, traceInfo);
+            value = exp.evaluate(*node);
+        }
+        catch (const user_exception&)
+        {
+            return node;
+        }
+        catch (const std::exception&)
+        {
+            return node;
+        }
+
+        // Lists and indexes are values scripts can change, so each evaluation gets its own
+        if (value.type() == object::LIST || value.type() == object::INDEX)
+            return node;
+
+        auto folded = std::make_shared<expression_node>();
+        folded->type = expression_node::LITERAL;
+        folded->value = value;
+        folded->text = node->text;
+        return folded;
+    }
+
+    expression_node_ptr expression::compileNode(std::wstring_view expStr)
+    {
+        auto node = std::make_shared<expression_node>();
+        node->text.assign(expStr);
 
         // Check for easy stuff
-        if (narrow.empty())
+        if (expStr.empty())
             raiseError("Empty expression");
 
+        node->type = expression_node::LITERAL;
+
+        // Keywords and constants are short ASCII words,
+        // so there's no need to upper-case longer expressions to look for them
+        std::string upper;
+        if (expStr.size() <= 16)
+        {
+            for (wchar_t c : expStr)
+            {
+                if (c <= 0 || c > 127)
+                {
+                    upper.clear();
+                    break;
+                }
+                upper += char(toupper(c));
+            }
+        }
+
         if (upper == "NULL")
-            return object::NOTHING;
+            return node;
 
         if (upper == "TRUE")
-            return true;
+        {
+            node->value = true;
+            return node;
+        }
 
         if (upper == "FALSE")
-            return false;
+        {
+            node->value = false;
+            return node;
+        }
 
         // Do an exact parsing of a number from the full expression string
-        if (narrow[0] == '-' || isdigit(narrow[0]))
+        if (expStr[0] == '-' || iswdigit(expStr[0]))
         {
+            std::string narrow;
+            narrow.reserve(expStr.size());
+            for (wchar_t c : expStr)
+            {
+                if (c <= 0 || c > 127 || iswspace(c))
+                {
+                    narrow.clear();
+                    break;
+                }
+                narrow += char(c);
+            }
+
             double number;
             const char* start = narrow.data();
             const char* end = start + narrow.size();
             auto result = std::from_chars(start, end, number);
-            if (result.ptr == end && result.ec == std::errc())
-                return number;
+            if (!narrow.empty() && result.ptr == end && result.ec == std::errc())
+            {
+                node->value = number;
+                return node;
+            }
         }
 
         // Stay out of string constants
-        if (expStr[0] == '\"')
+        if (expStr[0] == '\"' || expStr[0] == '\'')
         {
-            std::wstring str;
-            bool foundEnd = false;
-            bool foundAtEnd = false;
-            for (size_t s = 1; s < expStr.size(); ++s)
+            size_t endQuote = expStr.find(expStr[0], 1);
+            if (endQuote == std::wstring_view::npos)
+                raiseWError(L"Unfinished string: " + node->text);
+            else if (endQuote == expStr.size() - 1)
             {
-                wchar_t c = expStr[s];
-                if (c == '\"')
-                {
-                    foundEnd = true;
-                    foundAtEnd = s == expStr.size() - 1;
-                    break;
-                }
-                else
-                    str += c;
+                node->value = object::fromWide(expStr.substr(1, endQuote - 1));
+                return node;
             }
-            if (!foundEnd)
-                raiseWError(L"Unfinished string: " + expStr);
-            else if (foundAtEnd)
-                return str;
             // else it's a string at the start of an expression, like "foo" + QUOTE
-            // It will get handled by the recursive evaluate of the two sides of the op
+            // It will get handled by the compile of the two sides of the op
         }
 
-        if (expStr[0] == '\'')
+        static std::unordered_map<std::string, object> constants
+        {
+            { "DQUOTE", toWideStr("\"") },
+            { "SQUOTE", toWideStr("\'") },
+            { "TAB", toWideStr("\t") },
+            { "CR", toWideStr("\f") },
+            { "LF", toWideStr("\n") },
+            { "CRLF", toWideStr("\r\n") },
+            { "ESC", toWideStr("\033") },
+
+            { "PI", M_PI },
+            { "E", M_E },
+
+            { "TRACE_NONE", double(TRACE_NONE) },
+            { "TRACE_CRITICAL", double(TRACE_CRITICAL) },
+            { "TRACE_ERROR", double(TRACE_ERROR) },
+            { "TRACE_WARNING", double(TRACE_WARNING) },
+            { "TRACE_INFO", double(TRACE_INFO) },
+            { "TRACE_DEBUG", double(TRACE_DEBUG) },
+        };
         {
-            std::wstring str;
-            bool foundEnd = false;
-            bool foundAtEnd = false;
-            for (size_t s = 1; s < expStr.size(); ++s)
+            const auto& constIt = constants.find(upper);
+            if (constIt != constants.end())
             {
-                wchar_t c = expStr[s];
-                if (c == '\'')
-                {
-                    foundEnd = true;
-                    foundAtEnd = s == expStr.size() - 1;
-                    break;
-                }
-                else
-                    str += c;
+                node->value = constIt->second;
+                return node;
             }
-            if (!foundEnd)
-                raiseWError(L"Unfinished string: " + expStr);
-            else if (foundAtEnd)
-                return str;
-            // else it's a string at the start of an expression, like 'foo' + squote
-            // It will get handled by the recursive evaluate of the two sides of the op
         }
 
-        if (upper == "DQUOTE")
-            return toWideStr("\"");
-
-        if (upper == "SQUOTE")
-            return toWideStr("\'");
-
-        if (upper == "TAB")
-            return toWideStr("\t");
-
-        if (upper == "CR")
-            return toWideStr("\f");
-
-        if (upper == "LF")
-            return toWideStr("\n");
-
-        if (upper == "CRLF")
-            return toWideStr("\r\n");
-
-        if (upper == "ESC")
-            return toWideStr("\033");
-
-        if (upper == "PI")
-            return M_PI;
-
-        if (upper == "E")
-            return M_E;
-
-        if (upper == "TRACE_NONE")
-            return double(TRACE_NONE);
-
-        if (upper == "TRACE_CRITICAL")
-            return double(TRACE_CRITICAL);
-
-        if (upper == "TRACE_ERROR")
-            return double(TRACE_ERROR);
-
-        if (upper == "TRACE_WARNING")
-            return double(TRACE_WARNING);
-
-        if (upper == "TRACE_INFO")
-            return double(TRACE_INFO);
-
-        if (upper == "TRACE_DEBUG")
-            return double(TRACE_DEBUG);
-
+        // Names can only be variables, and the symbol table is checked at runtime
+        if (isName(expStr))
         {
-            object symvalue;
-            if (m_symbols.tryGet(expStr, symvalue))
-                return symvalue;
+            node->type = expression_node::VARIABLE;
+            node->symbol = symbol_ref(node->text);
+            return node;
         }
 
-        if (isName(expStr)) // should have been found in symbol table
-            raiseWError(L"Unknown variable name: " + expStr);
-
         // Walk the operators, least to most precedenced
         for (size_t opdx = 0; opdx < sm_ops.size(); ++opdx)
         {
@@ -253,7 +396,7 @@ namespace mscript
                             toupper(expStr[idx + 2]) == op[2];
                     }
                     else
-                        raiseWError(L"Invalid operator length: " + expStr);
+                        raiseWError(L"Invalid operator length: " + node->text);
                 }
                 if (opMatches && is_op_alpha)
                 {
@@ -268,175 +411,14 @@ namespace mscript
                 if (opMatches)
                 {
                     // Make sure our operator isn't some 5E+5 nonsense
-                    if (isOperator(trim(expStr), op, idx))
+                    if (isOperator(expStr, op, idx))
                     {
-                        object value;
-
                         // Split the string into left and right parts
-                        std::wstring leftStr = expStr.substr(0, idx);
-                        std::wstring rightStr = expStr.substr(idx + opLen);
-
-                        // Evaluate the left part
-                        object leftVal = evaluate(leftStr);
-
-                        // Short circuitry
-                        if ((op == "&&" || op == "AND") && !leftVal.boolVal())
-                        {
-                            value = false;
-                        }
-                        else if ((op == "||" || op == "OR") && leftVal.boolVal())
-                        {
-                            value = true;
-                        }
-                        else
-                        {
-                            // Evaluate the right part
-                            object rightVal = evaluate(rightStr);
-
-                            // Handle nulls with equivalent checks
-                            if (leftVal.isNull() || rightVal.isNull())
-                            {
-                                if (op == "=" || op == "==" || op == "EQU")
-                                    value = leftVal == rightVal;
-                                else if (op == "!=" || op == "<>" || op == "NEQ")
-                                    value = leftVal != rightVal;
-                                else
-                                    raiseWError(L"Invalid operator for null values: " + expStr);
-                            }
-                            // Handle string on either side, string promotion
-                            else if (leftVal.type() == object::STRING || rightVal.type() == object::STRING)
-                            {
-                                std::wstring leftValStr = leftVal.toString();
-                                std::wstring rightValStr = rightVal.toString();
-
-                                if (opLen == 1)
-                                {
-                                    switch (op[0])
-                                    {
-                                    case '+': value = leftValStr + rightValStr; break;
-                                    case '=': value = leftValStr == rightValStr; break;
-                                    case '<': value = _wcsicmp(leftValStr.c_str(), rightValStr.c_str()) < 0; break;
-                                    case '>': value = _wcsicmp(leftValStr.c_str(), rightValStr.c_str()) > 0; break;
-                                    default:
-                                        raiseWError(L"Unrecognized string operator: " + expStr);
-                                    }
-                                }
-                                else if (opLen == 2)
-                                {
-                                    if (op == "==")
-                                        value = leftValStr == rightValStr;
-                                    else if (op == "!=" || op == "<>")
-                                        value = leftValStr != rightValStr;
-                                    else if (op == "<=")
-                                        value = leftValStr <= rightValStr;
-                                    else if (op == ">=")
-                                        value = leftValStr >= rightValStr;
-                                    else
-                                        raiseWError(L"Unrecognized string operator: " + expStr);
-                                }
-                                else if (opLen == 3)
-                                {
-                                    if (_stricmp(op.c_str(), "EQU") == 0)
-                                        value = leftValStr == rightValStr;
-                                    else if (_stricmp(op.c_str(), "NEQ") == 0)
-                                        value = leftValStr != rightValStr;
-                                    else if (_stricmp(op.c_str(), "LSS") == 0)
-                                        value = leftValStr < rightValStr;
-                                    else if (_stricmp(op.c_str(), "LEQ") == 0)
-                                        value = leftValStr <= rightValStr;
-                                    else if (_stricmp(op.c_str(), "GTR") == 0)
-                                        value = leftValStr > rightValStr;
-                                    else if (_stricmp(op.c_str(), "GEQ") == 0)
-                                        value = leftValStr >= rightValStr;
-                                    else
-                                        raiseWError(L"Unrecognized string operator: " + expStr);
-                                }
-                                else
-                                    raiseWError(L"Unrecognized string operator: " + expStr);
-                            }
-                            // Numbers are easy
-                            else if (leftVal.type() == object::NUMBER && rightVal.type() == object::NUMBER)
-                            {
-                                double leftNum = leftVal.numberVal();
-                                double rightNum = rightVal.numberVal();
-
-                                if (isnan(leftNum) || isnan(rightNum))
-                                {
-                                    value = nan("");
-                                }
-                                else
-                                {
-                                    if (opLen == 1)
-                                    {
-                                        switch (op[0])
-                                        {
-                                        case '+': value = leftNum + rightNum; break;
-                                        case '-': value = leftNum - rightNum; break;
-                                        case '*': value = leftNum * rightNum; break;
-                                        case '/': value = leftNum / rightNum; break;
-                                        case '%': value = double(int64_t(leftNum) % int64_t(rightNum)); break;
-                                        case '^': value = pow(leftNum, rightNum); break;
-                                        case '=': value = leftNum == rightNum; break;
-                                        case '<': value = leftNum < rightNum; break;
-                                        case '>': value = leftNum > rightNum; break;
-                                        default: raiseWError(L"Unrecognized numeric operator: " + expStr);
-                                        }
-                                    }
-                                    else if (opLen == 2)
-                                    {
-                                        if (op == "==")
-                                            value = leftNum == rightNum;
-                                        else if (op == "!=" || op == "<>")
-                                            value = leftNum != rightNum;
-                                        else if (op == "<=")
-                                            value = leftNum <= rightNum;
-                                        else if (op == ">=")
-                                            value = leftNum >= rightNum;
-                                        else
-                                            raiseWError(L"Unrecognized numeric operator: " + expStr);
-                                    }
-                                    else if (opLen == 3)
-                                    {
-                                        if (_stricmp(op.c_str(), "EQU") == 0)
-                                            value = leftNum == rightNum;
-                                        else if (_stricmp(op.c_str(), "NEQ") == 0)
-                                            value = leftNum != rightNum;
-                                        else if (_stricmp(op.c_str(), "LSS") == 0)
-                                            value = leftNum < rightNum;
-                                        else if (_stricmp(op.c_str(), "LEQ") == 0)
-                                            value = leftNum <= rightNum;
-                                        else if (_stricmp(op.c_str(), "GTR") == 0)
-                                            value = leftNum > rightNum;
-                                        else if (_stricmp(op.c_str(), "GEQ") == 0)
-                                            value = leftNum >= rightNum;
-                                        else
-                                            raiseWError(L"Unrecognized numeric operator: " + expStr);
-                                    }
-                                    else
-                                        raiseWError(L"Unrecognized numeric operator: " + expStr);
-                                }
-                            }
-                            // Bools are easy
-                            else if (leftVal.type() == object::BOOL && rightVal.type() == object::BOOL)
-                            {
-                                bool leftBool = leftVal.boolVal();
-                                bool rightBool = rightVal.boolVal();
-
-                                if (op == "&&" || op == "AND")
-                                    value = leftBool && rightBool;
-                                else if (op == "||" || op == "OR")
-                                    value = leftBool || rightBool;
-                                else if (op == "=" || op == "==" || op == "EQU")
-                                    value = leftBool == rightBool;
-                                else if (op == "!=" || op == "<>" || op == "NEQ")
-                                    value = leftBool != rightBool;
-                                else
-                                    raiseWError(L"Unrecognized boolean operator: " + expStr);
-                            }
-                            else
-                                raiseWError(L"Expression types do not match: " + expStr);
-                        }
-                        return value;
+                        node->type = expression_node::BINARY_OP;
+                        node->op = opType(op);
+                        node->children.push_back(compile(expStr.substr(0, idx)));
+                        node->children.push_back(compile(expStr.substr(idx + opLen)));
+                        return node;
                     }
                     else // not an operator after all, so look for the next op
                     {
@@ -450,46 +432,393 @@ namespace mscript
         // Deal with unary operators
         if (expStr[0] == '-')
         {
-            object answer = evaluate(expStr.substr(1));
-            return -answer.numberVal();
+            node->type = expression_node::NEGATE;
+            node->children.push_back(compile(expStr.substr(1)));
+            return node;
         }
         else if (expStr[0] == '!')
         {
-            object answer = evaluate(expStr.substr(1));
-            return !answer.boolVal();
+            node->type = expression_node::NOT;
+            node->children.push_back(compile(expStr.substr(1)));
+            return node;
         }
-        else if (startsWith(toUpper(expStr), L"NOT "))
+        else if (expStr.size() >= 4 && _wcsnicmp(expStr.data(), L"NOT ", 4) == 0)
         {
             static size_t notLen = strlen("NOT ");
-            object answer = evaluate(expStr.substr(notLen));
-            return !answer.boolVal();
+            node->type = expression_node::NOT;
+            node->children.push_back(compile(expStr.substr(notLen)));
+            return node;
         }
 
         // Deal with parens, including function calls
-        auto trimmed_exp_str = trim(expStr);
-        size_t leftParen = trimmed_exp_str.find('(');
-        if (trimmed_exp_str.size() > 2 && leftParen != std::wstring::npos && trimmed_exp_str.back() == ')')
+        size_t leftParen = expStr.find('(');
+        if (expStr.size() > 2 && leftParen != std::wstring::npos && expStr.back() == ')')
         {
-            std::wstring functionName = trim(expStr.substr(0, leftParen));
+            std::wstring_view functionName = trimView(expStr.substr(0, leftParen));
 
             int subStrLen = (int(expStr.size()) - 1) - int(leftParen) - 1;
+            std::wstring_view paramsStr = expStr.substr(leftParen + 1, subStrLen);
+            for (const auto& paramStr : parseParameters(paramsStr))
+                node->children.push_back(compile(paramStr));
+
+            if (functionName.empty())
+            {
+                if (node->children.empty())
+                    raiseWError(L"Expression not evaluated: " + std::wstring(paramsStr));
+                node->type = expression_node::GROUP;
+                return node;
+            }
+
+            node->type = expression_node::CALL;
+            node->name.assign(functionName);
+            return node;
+        }
+
+        // Oh well, not processed, must not be a valid expression
+        raiseWError(L"Expression not evaluated: " + node->text);
+    }
+
+    object expression::evaluate(const expression_node& node)
+    {
+        switch (node.type)
+        {
+        case expression_node::LITERAL:
+            return node.value;
+
+        case expression_node::VARIABLE:
+        {
+            object symvalue;
+            if (m_symbols.tryGet(node.symbol, symvalue))
+                return symvalue;
+            else // should have been found in symbol table
+                raiseWError(L"Unknown variable name: " + node.text);
+        }
+
+        case expression_node::BINARY_OP:
+        {
+            // Evaluate the left part
+            object leftVal = evaluate(*node.children[0]);
+
+            // Short circuitry
+            if (node.op == expression_node::AND && !leftVal.boolVal())
+                return false;
+            else if (node.op == expression_node::OR && leftVal.boolVal())
+                return true;
 
-            expStr = expStr.substr(leftParen + 1, subStrLen);
+            // Evaluate the right part
+            object rightVal = evaluate(*node.children[1]);
+            return evaluateBinaryOp(node.op, leftVal, rightVal, node.text);
+        }
+
+        case expression_node::NEGATE:
+        {
+            object answer = evaluate(*node.children[0]);
+            return -answer.numberVal();
+        }
+
+        case expression_node::NOT:
+        {
+            object answer = evaluate(*node.children[0]);
+            return !answer.boolVal();
+        }
 
-            auto expStrs = parseParameters(expStr);
-            object::list values = processParameters(expStrs);
+        case expression_node::CALL:
+        {
+            object::list values = processParameters(node.children);
+            return call(node, values);
+        }
+
+        case expression_node::GROUP:
+        {
+            object::list values = processParameters(node.children);
+            return values[0];
+        }
+
+        case expression_node::ERROR:
+            throw user_exception(node.value);
+
+        default:
+            raiseError("Invalid expression node type: " + num2str(int(node.type)));
+        }
+    }
+
+    // Binary operations are handled by the types of the two sides, then by the operator
+    typedef object(*binary_op_handler)(expression_node::op_type op, const object& leftVal, const object& rightVal, const std::wstring& expStr);
+
+    // Handle nulls with equivalent checks
+    static object nullBinaryOp(expression_node::op_type op, const object& leftVal, const object& rightVal, const std::wstring& expStr)
+    {
+        switch (op)
+        {
+        case expression_node::EQUAL: return leftVal == rightVal;
+        case expression_node::NOT_EQUAL: return leftVal != rightVal;
+        default: raiseWError(L"Invalid operator for null values: " + expStr);
+        }
+    }
+
+    // ASCII strings, numbers, and bools can be added onto ASCII strings without widening them
+    static bool isAsciiText(const object& value)
+    {
+        switch (value.type())
+        {
+        case object::STRING: return value.isAsciiString() || isAscii(value.stringVal());
+        case object::NUMBER: return true;
+        case object::BOOL: return true;
+        default: return false;
+        }
+    }
 
-            if (!functionName.empty())
+    static void appendAscii(std::string& str, const object& value)
+    {
+        switch (value.type())
+        {
+        case object::STRING:
+            if (value.isAsciiString())
             {
-                object functionValue = executeFunction(functionName, values);
-                return functionValue;
+                str += value.asciiVal();
             }
             else
-                return values[0];
+            {
+                for (wchar_t c : value.stringVal())
+                    str += char(c);
+            }
+            break;
+
+        case object::NUMBER:
+        {
+            char chars[maxNumberLength];
+            str.append(chars, num2chars(value.numberVal(), chars));
+            break;
         }
 
-        // Oh well, not processed, must not be a valid expression
-        raiseWError(L"Expression not evaluated: " + expStr);
+        case object::BOOL:
+            str += value.boolVal() ? "true" : "false";
+            break;
+
+        default:
+            raiseError("Not ASCII text: " + value.typeStr());
+        }
+    }
+
+    // < and > ignore case, a byte a character or wide
+    static int compareIgnoringCase(const std::string& leftStr, const std::string& rightStr) { return _stricmp(leftStr.c_str(), rightStr.c_str()); }
+    static int compareIgnoringCase(const std::wstring& leftStr, const std::wstring& rightStr) { return _wcsicmp(leftStr.c_str(), rightStr.c_str()); }
+
+    // Compare strings, ASCII ones without widening them
+    template <typename StrT>
+    static object stringCompareOp(expression_node::op_type op, const StrT& leftStr, const StrT& rightStr, const std::wstring& expStr)
+    {
+        switch (op)
+        {
+        case expression_node::EQUAL: return leftStr == rightStr;
+        case expression_node::NOT_EQUAL: return leftStr != rightStr;
+        case expression_node::LESS: return compareIgnoringCase(leftStr, rightStr) < 0;
+        case expression_node::GREATER: return compareIgnoringCase(leftStr, rightStr) > 0;
+        case expression_node::LSS: return leftStr < rightStr;
+        case expression_node::GTR: return leftStr > rightStr;
+        case expression_node::LESS_OR_EQUAL: return leftStr <= rightStr;
+        case expression_node::GREATER_OR_EQUAL: return leftStr >= rightStr;
+        default: raiseWError(L"Unrecognized string operator: " + expStr);
+        }
+    }
+
+    // Regexes need wide strings, ASCII strings are matched as wide copies so they stay a byte a character
+    static const std::wstring& regexInput(const object& value)
+    {
+        thread_local std::wstring wideCopy;
+        if (!value.isAsciiString())
+            return value.stringVal();
+        wideCopy.assign(value.asciiVal().begin(), value.asciiVal().end());
+        return wideCopy;
+    }
+
+    // Handle string on either side, string promotion
+    static object stringBinaryOp(expression_node::op_type op, const object& leftVal, const object& rightVal, const std::wstring& expStr)
+    {
+        // ASCII strings stay a byte a character when ASCII text is added to them
+        if (op == expression_node::ADD && (leftVal.isAsciiString() || rightVal.isAsciiString()) && isAsciiText(leftVal) && isAsciiText(rightVal))
+        {
+            std::string sum;
+            appendAscii(sum, leftVal);
+            appendAscii(sum, rightVal);
+            return object::fromUtf8(std::move(sum));
+        }
+        if (leftVal.isAsciiString() && rightVal.isAsciiString())
+            return stringCompareOp(op, leftVal.asciiVal(), rightVal.asciiVal(), expStr);
+
+        // Strings are used where they are, only the other types are turned into strings
+        std::wstring leftOther, rightOther;
+        const std::wstring& leftValStr = leftVal.type() == object::STRING ? leftVal.stringVal() : (leftOther = leftVal.toString());
+        const std::wstring& rightValStr = rightVal.type() == object::STRING ? rightVal.stringVal() : (rightOther = rightVal.toString());
+
+        if (op == expression_node::ADD)
+            return leftValStr + rightValStr;
+        return stringCompareOp(op, leftValStr, rightValStr, expStr);
+    }
+
+    // Numbers are easy
+    static object numberBinaryOp(expression_node::op_type op, const object& leftVal, const object& rightVal, const std::wstring& expStr)
+    {
+        double leftNum = leftVal.numberVal();
+        double rightNum = rightVal.numberVal();
+
+        if (isnan(leftNum) || isnan(rightNum))
+            return nan("");
+
+        switch (op)
+        {
+        case expression_node::ADD: return leftNum + rightNum;
+        case expression_node::SUBTRACT: return leftNum - rightNum;
+        case expression_node::MULTIPLY: return leftNum * rightNum;
+        case expression_node::DIVIDE: return leftNum / rightNum;
+        case expression_node::MODULO: return double(int64_t(leftNum) % int64_t(rightNum));
+        case expression_node::POWER: return pow(leftNum, rightNum);
+        case expression_node::EQUAL: return leftNum == rightNum;
+        case expression_node::NOT_EQUAL: return leftNum != rightNum;
+        case expression_node::LESS:
+        case expression_node::LSS: return leftNum < rightNum;
+        case expression_node::GREATER:
+        case expression_node::GTR: return leftNum > rightNum;
+        case expression_node::LESS_OR_EQUAL: return leftNum <= rightNum;
+        case expression_node::GREATER_OR_EQUAL: return leftNum >= rightNum;
+        default: raiseWError(L"Unrecognized numeric operator: " + expStr);
+        }
+    }
+
+    // Bools are easy
+    static object boolBinaryOp(expression_node::op_type op, const object& leftVal, const object& rightVal, const std::wstring& expStr)
+    {
+        bool leftBool = leftVal.boolVal();
+        bool rightBool = rightVal.boolVal();
+
+        switch (op)
+        {
+        case expression_node::AND: return leftBool && rightBool;
+        case expression_node::OR: return leftBool || rightBool;
+        case expression_node::EQUAL: return leftBool == rightBool;
+        case expression_node::NOT_EQUAL: return leftBool != rightBool;
+        default: raiseWError(L"Unrecognized boolean operator: " + expStr);
+        }
+    }
+
+    static object mismatchedBinaryOp(expression_node::op_type, const object&, const object&, const std::wstring& expStr)
+    {
+        raiseWError(L"Expression types do not match: " + expStr);
+    }
+
+    object expression::evaluateBinaryOp(expression_node::op_type op, const object& leftVal, const object& rightVal, const std::wstring& expStr)
+    {
+        // The handler for each pair of left and right types
+        static const auto handlers = []()
+        {
+            const int typeCount = object::RANGE + 1;
+            std::array<std::array<binary_op_handler, typeCount>, typeCount> table;
+            for (auto& row : table)
+                row.fill(&mismatchedBinaryOp);
+            for (int t = 0; t < typeCount; ++t)
+                table[object::STRING][t] = table[t][object::STRING] = &stringBinaryOp;
+            for (int t = 0; t < typeCount; ++t)
+                table[object::NOTHING][t] = table[t][object::NOTHING] = &nullBinaryOp;
+            table[object::NUMBER][object::NUMBER] = &numberBinaryOp;
+            table[object::BOOL][object::BOOL] = &boolBinaryOp;
+            return table;
+        }();
+        return handlers[leftVal.type()][rightVal.type()](op, leftVal, rightVal, expStr);
+    }
+
+    std::vector<expression_node_ptr> expression::findAppends(const expression_node_ptr& exp, const std::wstring& nameLower)
+    {
+        // x + a + b is (x + a) + b, so walk down the left sides to x
+        std::vector<expression_node_ptr> appends;
+        expression_node_ptr node = exp;
+        while (node->type == expression_node::BINARY_OP && node->op == expression_node::ADD)
+        {
+            if (!leavesVariableBe(*node->children[1], nameLower))
+                return {};
+
+            appends.push_back(node);
+            node = node->children[0];
+        }
+
+        if (node->type != expression_node::VARIABLE || node->symbol.nameLower != nameLower)
+            return {};
+
+        std::reverse(appends.begin(), appends.end());
+        return appends;
+    }
+
+    bool expression::leavesVariableBe(const expression_node& node, const std::wstring& nameLower)
+    {
+        switch (node.type)
+        {
+        case expression_node::VARIABLE:
+            return node.symbol.nameLower != nameLower;
+
+        case expression_node::CALL:
+        {
+            // Script functions can change variables, so can eval(), and x.add() and x.set() change x
+            std::wstring functionLower = toLower(node.name);
+            size_t dotIndex = functionLower.find('.');
+            if (dotIndex != std::wstring::npos)
+            {
+                if (functionLower.substr(0, dotIndex) == nameLower)
+                    return false;
+                functionLower = functionLower.substr(dotIndex + 1);
+            }
+
+            const auto& functions = builtInFunctions();
+            if (functionLower == L"eval" || functions.find(toNarrowStr(functionLower)) == functions.end())
+                return false;
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        for (const auto& child : node.children)
+        {
+            if (!leavesVariableBe(*child, nameLower))
+                return false;
+        }
+        return true;
+    }
+
+    void expression::addToVariable(symbol_table& symbols, const symbol_ref& symbol, const std::vector<expression_node_ptr>& appends, const object* values)
+    {
+        object* variable = symbols.tryGetVariable(symbol);
+        if (variable == nullptr)
+            raiseWError(L"Unknown variable name: " + appends.front()->children[0]->text);
+
+        // Nulls can't be added to strings, the + raises the error for them
+        bool appendable =
+            variable->type() == object::STRING
+            &&
+            std::none_of(values, values + appends.size(), [](const object& value) { return value.type() == object::NOTHING; });
+        if (appendable && variable->isAsciiString() && std::all_of(values, values + appends.size(), isAsciiText))
+        {
+            std::string& str = variable->asciiVal(); // only copied if other values share the string
+            for (size_t v = 0; v < appends.size(); ++v)
+                appendAscii(str, values[v]);
+            return;
+        }
+        if (appendable)
+        {
+            std::wstring& str = variable->stringVal(); // only copied if other values share the string
+            for (size_t v = 0; v < appends.size(); ++v)
+            {
+                if (values[v].type() == object::STRING)
+                    str += values[v].stringVal();
+                else
+                    str += values[v].toString();
+            }
+            return;
+        }
+
+        object answer = *variable;
+        for (size_t v = 0; v < appends.size(); ++v)
+            answer = evaluateBinaryOp(expression_node::ADD, answer, values[v], appends[v]->text);
+        symbols.assign(symbol, answer);
     }
 
     bool expression::isCharAlphaOpBoundary(wchar_t c)
@@ -497,7 +826,7 @@ namespace mscript
         return c == ' '; // || c == '(' || c == ')' || c == 0;
     }
 
-    bool expression::isOperator(const std::wstring& expr, const std::string& op, int n)
+    bool expression::isOperator(std::wstring_view expr, const std::string& op, int n)
     {
         if (expr.empty())
             return true;
@@ -531,12 +860,18 @@ namespace mscript
                 return false;
 
             // Get the start up to previous charcater, trim it, then get the last char
-            std::string sign = toNarrowStr(trim(expr.substr(0, n)));
-            sign = sign.substr(sign.length() - 1);
+            std::wstring_view before = trimView(expr.substr(0, n));
+            if (before.empty())
+                return false;
 
             // If the last char is an operator, then this is a unary -, not an operator
-            if (std::find(sm_ops.begin(), sm_ops.end(), sign) != sm_ops.end())
-                return false;
+            wchar_t last = before.back();
+            if (last > 0 && last <= 127)
+            {
+                std::string sign(1, char(last));
+                if (std::find(sm_ops.begin(), sm_ops.end(), sign) != sm_ops.end())
+                    return false;
+            }
 
             // Exponent?
             bool expResult =
@@ -561,7 +896,7 @@ namespace mscript
         return true;
     }
 
-    int expression::reverseFind(const std::wstring& source, const std::wstring& searchW, int start)
+    int expression::reverseFind(std::wstring_view source, std::wstring_view searchW, int start)
     {
         int searchLen = int(searchW.length());
         if (searchLen > int(source.length()))
@@ -586,7 +921,7 @@ namespace mscript
 
             if (source.length() - (p + searchLen) >= 0)
             {
-                std::wstring sign = source.substr(p, searchLen);
+                std::wstring_view sign = source.substr(p, searchLen);
                 if (sign == searchW && openP == closeP)
                     return p;
             }
@@ -600,22 +935,22 @@ namespace mscript
         return -1;
     }
 
-    object::list expression::processParameters(const std::vector<std::wstring>& expStrs)
+    object::list expression::processParameters(const std::vector<expression_node_ptr>& paramNodes)
     {
         object::list values;
-        values.reserve(expStrs.size());
-        for (const auto& paramStr : expStrs)
+        values.reserve(paramNodes.size());
+        for (const auto& paramNode : paramNodes)
         {
-            object value = evaluate(paramStr);
+            object value = evaluate(*paramNode);
             values.push_back(value);
         }
         return values;
     }
 
-    std::vector<std::wstring> expression::parseParameters(const std::wstring& expStr)
+    std::vector<std::wstring_view> expression::parseParameters(std::wstring_view expStr)
     {
-        std::vector<std::wstring> expStrs;
-        std::wstring curExp;
+        std::vector<std::wstring_view> expStrs;
+        size_t curStart = 0;
         bool inSingleString = false;
         bool inDoubleString = false;
         int parenCount = 0;
@@ -638,19 +973,16 @@ namespace mscript
 
             if (!(inSingleString || inDoubleString) && parenCount == 0 && c == ',')
             {
-                curExp = trim(curExp);
+                std::wstring_view curExp = trimView(expStr.substr(curStart, idx - curStart));
                 if (curExp.empty())
-                    raiseWError(L"Missing parameter: " + expStr);
+                    raiseWError(L"Missing parameter: " + std::wstring(expStr));
 
                 expStrs.push_back(curExp);
-                curExp.clear();
-                continue;
+                curStart = idx + 1;
             }
-
-            curExp += c;
         }
 
-        curExp = trim(curExp);
+        std::wstring_view curExp = trimView(expStr.substr(curStart));
         if (!curExp.empty())
             expStrs.push_back(curExp);
 
@@ -665,42 +997,143 @@ namespace mscript
             return paramList[0].numberVal();
     }
 
-    object expression::executeFunction(std::wstring functionW, const object::list& paramList)
+    // Turn CRLFs into line feeds in place, like reading files in text mode does
+    template <typename StrT>
+    static void removeCarriageReturns(StrT& str)
     {
-        functionW = toLower(functionW);
-        const std::string function = toNarrowStr(functionW);
+        const typename StrT::value_type crlf[] = { '\r', '\n', 0 };
+        size_t out = str.find(crlf);
+        if (out == StrT::npos)
+            return;
 
-        object first = paramList.size() == 0 ? object::NOTHING : paramList[0];
+        for (size_t in = out; in < str.size(); ++in)
+        {
+            if (str[in] == '\r' && in + 1 < str.size() && str[in + 1] == '\n')
+                continue;
+            str[out++] = str[in];
+        }
+        str.resize(out);
+    }
+
+    // The text of a file, copied out of its bytes once, with CRLFs turned into line feeds
+    // on the way for ASCII text, and after decoding for the rest
+    static object fileText(std::string_view bytes)
+    {
+        if (!isAscii(bytes))
+        {
+            std::wstring text = toWideStr(bytes);
+            removeCarriageReturns(text);
+            return object(std::move(text));
+        }
+
+        std::string text;
+        text.reserve(bytes.size());
+        size_t start = 0;
+        for (size_t crlf = bytes.find("\r\n"); crlf != std::string_view::npos; crlf = bytes.find("\r\n", start))
+        {
+            text.append(bytes.substr(start, crlf - start));
+            start = crlf + 1; // the line feed starts the next run
+        }
+        text.append(bytes.substr(start));
+        return object::fromUtf8(std::move(text));
+    }
+
+    // Call f with a string's characters, a std::string_view a byte a character for an ASCII string,
+    // a std::wstring_view otherwise, so string functions are written once for both
+    template <typename F>
+    static auto withChars(const object& str, F&& f)
+    {
+        if (str.isAsciiString())
+            return f(std::string_view(str.asciiVal()));
+        return f(std::wstring_view(str.stringVal()));
+    }
+
+    // Same with two strings, a byte a character if they're both ASCII
+    template <typename F>
+    static auto withChars(const object& str1, const object& str2, F&& f)
+    {
+        if (str1.isAsciiString() && str2.isAsciiString())
+            return f(std::string_view(str1.asciiVal()), std::string_view(str2.asciiVal()));
+        return f(std::wstring_view(str1.stringVal()), std::wstring_view(str2.stringVal()));
+    }
+
+    // Strings made from withChars() characters stay the width they came in
+    static object charsObject(std::string_view chars) { return object::fromUtf8(chars); }
+    static object charsObject(std::wstring_view chars) { return std::wstring(chars); }
+    static object charsObject(std::string&& chars) { return object::fromUtf8(std::move(chars)); }
+    static object charsObject(std::wstring&& chars) { return std::move(chars); }
+
+    template <typename Pieces>
+    static object::list charsObjects(const Pieces& pieces)
+    {
+        object::list objs;
+        objs.reserve(pieces.size());
+        for (const auto& piece : pieces)
+            objs.push_back(charsObject(piece));
+        return objs;
+    }
+
+    // Script indexes and lengths are numbers; whole numbers past SIZE_MAX pin to it
+    static size_t toSize(double number)
+    {
+        number = trunc(number);
+        return number >= double(SIZE_MAX) ? SIZE_MAX : size_t(number);
+    }
+
+    // Where a value falls in a range, or -1 if it's not in there;
+    // range values are all different, so the first location is the last
+    static double rangeLocation(const object::range& range, const object& value)
+    {
+        // Work out which item it would be, then see if it is
+        if (value.type() != object::NUMBER)
+            return -1.0;
+        double item = round((value.numberVal() - range.from) / range.step);
+        if (!(item >= 0.0 && item < double(range.count)))
+            return -1.0;
+        return object(range.at(size_t(item))) == value ? item : -1.0;
+    }
 
-        static std::unordered_map<std::string, std::function<object(object& first, const object::list& paramList)>> functions
+    // The part of a range starting at an index, up to a count of items
+    static object::range subRange(const object::range& range, size_t startIndex, size_t count)
+    {
+        object::range subset;
+        subset.from = range.at(startIndex);
+        subset.step = range.step;
+        subset.count = std::min(count, range.count - startIndex);
+        return subset;
+    }
+
+    const std::unordered_map<std::string, built_in_function>& expression::builtInFunctions()
+    {
+        static std::unordered_map<std::string, built_in_function> functions
         {
             //
             // Math
             //
-            { "abs", [](object& first, const object::list& paramList) -> object { (void)first; return abs(getOneDouble(paramList, "abs")); }},
-            { "sqrt", [](object& first, const object::list& paramList) -> object { (void)first; return sqrt(getOneDouble(paramList, "sqrt")); }},
+            { "abs", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return abs(getOneDouble(paramList, "abs")); }},
+            { "sqrt", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return sqrt(getOneDouble(paramList, "sqrt")); }},
 
-            { "ceil", [](object& first, const object::list& paramList) -> object { (void)first; return ceil(getOneDouble(paramList, "ceil")); }},
-            { "floor", [](object& first, const object::list& paramList) -> object { (void)first; return floor(getOneDouble(paramList, "floor")); }},
+            { "ceil", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return ceil(getOneDouble(paramList, "ceil")); }},
+            { "floor", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return floor(getOneDouble(paramList, "floor")); }},
 
-            { "exp", [](object& first, const object::list& paramList) -> object { (void)first; return exp(getOneDouble(paramList, "exp")); }},
-            { "log", [](object& first, const object::list& paramList) -> object { (void)first; return log(getOneDouble(paramList, "log")); }},
-            { "log2", [](object& first, const object::list& paramList) -> object { (void)first; return log2(getOneDouble(paramList, "log2")); }},
-            { "log10", [](object& first, const object::list& paramList) -> object { (void)first; return log10(getOneDouble(paramList, "log10")); }},
+            { "exp", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return exp(getOneDouble(paramList, "exp")); }},
+            { "log", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return log(getOneDouble(paramList, "log")); }},
+            { "log2", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return log2(getOneDouble(paramList, "log2")); }},
+            { "log10", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return log10(getOneDouble(paramList, "log10")); }},
 
-            { "sin", [](object& first, const object::list& paramList) -> object { (void)first; return sin(getOneDouble(paramList, "sin")); }},
-            { "cos", [](object& first, const object::list& paramList) -> object { (void)first; return cos(getOneDouble(paramList, "cos")); }},
-            { "tan", [](object& first, const object::list& paramList) -> object { (void)first; return tan(getOneDouble(paramList, "tan")); }},
+            { "sin", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return sin(getOneDouble(paramList, "sin")); }},
+            { "cos", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return cos(getOneDouble(paramList, "cos")); }},
+            { "tan", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return tan(getOneDouble(paramList, "tan")); }},
 
-            { "asin", [](object& first, const object::list& paramList) -> object { (void)first; return asin(getOneDouble(paramList, "asin")); }},
-            { "acos", [](object& first, const object::list& paramList) -> object { (void)first; return acos(getOneDouble(paramList, "acos")); }},
-            { "atan", [](object& first, const object::list& paramList) -> object { (void)first; return atan(getOneDouble(paramList, "atan")); }},
+            { "asin", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return asin(getOneDouble(paramList, "asin")); }},
+            { "acos", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return acos(getOneDouble(paramList, "acos")); }},
+            { "atan", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return atan(getOneDouble(paramList, "atan")); }},
 
-            { "sinh", [](object& first, const object::list& paramList) -> object { (void)first; return sinh(getOneDouble(paramList, "sinh")); }},
-            { "cosh", [](object& first, const object::list& paramList) -> object { (void)first; return cosh(getOneDouble(paramList, "cosh")); }},
-            { "tanh", [](object& first, const object::list& paramList) -> object { (void)first; return tanh(getOneDouble(paramList, "tanh")); }},
+            { "sinh", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return sinh(getOneDouble(paramList, "sinh")); }},
+            { "cosh", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return cosh(getOneDouble(paramList, "cosh")); }},
+            { "tanh", [](expression&, object& first, const object::list& paramList) -> object { (void)first; return tanh(getOneDouble(paramList, "tanh")); }},
 
-            { "round", [](object& first, const object::list& paramList) -> object {
+            { "round", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() == 1)
                     return round(getOneDouble(paramList, "round"));
                 if (paramList.size() != 2 || first.type() != object::NUMBER || paramList[1].type() != object::NUMBER)
@@ -713,30 +1146,30 @@ namespace mscript
             //
             // Type Operations
             //
-            { "gettype", [](object& first, const object::list& paramList) -> object {
+            { "gettype", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("getType() takes one parameter");
                 return toWideStr(first.typeStr());
             }},
 
-            { "number", [](object& first, const object::list& paramList) -> object {
+            { "number", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("number() takes one parameter");
                 return first.toNumber();
             }},
 
-            { "string", [](object& first, const object::list& paramList) -> object {
+            { "string", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("string() takes one parameter");
                 return first.toString();
             }},
 
-            { "list", [](object& first, const object::list& paramList) -> object {
+            { "list", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 return object::list(paramList);
             }},
 
-            { "index", [](object& first, const object::list& paramList) -> object {
+            { "index", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 if ((paramList.size() % 2) != 0)
                     raiseError("index() parameters must be an even count, key-value pairs");
@@ -751,7 +1184,34 @@ namespace mscript
                 return newIndex;
             }},
 
-            { "clone", [](object& first, const object::list& paramList) -> object {
+            { "range", [](expression&, object& first, const object::list& paramList) -> object {
+                if (paramList.size() != 2 && paramList.size() != 3)
+                    raiseError("range() works with from and to numbers and an optional step number");
+                for (const auto& param : paramList)
+                {
+                    if (param.type() != object::NUMBER)
+                        raiseError("range() parameters must be numbers");
+                }
+
+                double from = first.numberVal();
+                double to = paramList[1].numberVal();
+                double step = paramList.size() == 3 ? paramList[2].numberVal() : (to < from ? -1.0 : 1.0);
+                if (step == 0.0 || !std::isfinite(from) || !std::isfinite(to) || !std::isfinite(step))
+                    raiseError("range() step must not be zero, and numbers must be finite");
+
+                // to is included, like # loops, with a little slack for fractional steps
+                object::range range;
+                range.from = from;
+                range.step = step;
+                double steps = (to - from) / step;
+                if (steps > 9e15)
+                    raiseError("range() has too many numbers");
+                if (steps >= 0.0)
+                    range.count = size_t(floor(steps + 1e-9)) + 1;
+                return range;
+            }},
+
+            { "clone", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("clone() takes one parameter");
                 return first.clone();
@@ -760,14 +1220,20 @@ namespace mscript
             //
             // Collection Operations
             //
-            { "length", [](object& first, const object::list& paramList) -> object {
+            { "length", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("length() takes one parameter");
                 return double(first.length());
             }},
 
-            { "add", [](object& first, const object::list& paramList) -> object {
-                if (first.type() == object::STRING)
+            { "add", [](expression&, object& first, const object::list& paramList) -> object {
+                if (first.isAsciiString() && std::all_of(paramList.begin() + 1, paramList.end(), isAsciiText))
+                {
+                    for (int v = 1; v < int(paramList.size()); ++v)
+                        appendAscii(first.asciiVal(), paramList[v]);
+                    return first;
+                }
+                else if (first.type() == object::STRING)
                 {
                     for (int v = 1; v < int(paramList.size()); ++v)
                         first.stringVal() += paramList[v].toString();
@@ -798,7 +1264,7 @@ namespace mscript
                     raiseError("add() only works with string, list, and index");
             }},
             
-            { "set", [](object& first, const object::list& paramList) -> object {
+            { "set", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 3)
                     raiseError("set() works with an item, a key, and a value");
 
@@ -808,7 +1274,7 @@ namespace mscript
                 if (first.type() == object::STRING)
                 {
                     size_t idx = size_t(paramList[1].numberVal());
-                    if (idx >= first.stringVal().size())
+                    if (idx >= std::as_const(first).stringVal().size())
                         raiseError("set() out of range");
                     if (paramList[2].type() != object::STRING || paramList[2].stringVal().size() > 1)
                         raiseError("set() value must be a single character");
@@ -830,14 +1296,14 @@ namespace mscript
                 return first;
             }},
 
-            { "get", [](object& first, const object::list& paramList) -> object {
+            { "get", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 2)
                     raiseError("get() invalid argument count");
 
                 if (first.type() == object::INDEX)
                 {
                     object key = paramList[1];
-                    auto& index = first.indexVal();
+                    const auto& index = std::as_const(first).indexVal();
                     if (!index.contains(key))
                         raiseError("get() key not found");
                     return index.get(key);
@@ -846,99 +1312,135 @@ namespace mscript
                 if (paramList[1].type() != object::NUMBER)
                     raiseError("get() parameter is not a number");
 
-                int idx = int(paramList[1].numberVal());
-
-                if (idx < 0 || idx >= int(first.length()))
+                double idxNum = trunc(paramList[1].numberVal());
+                if (!(idxNum >= 0.0 && idxNum < double(first.length())))
                     raiseError("get() index is out of range");
+                size_t idx = size_t(idxNum);
 
                 switch (first.type())
                 {
-                case object::STRING: return object(std::wstring{ first.stringVal()[idx] });
-                case object::LIST: return first.listVal()[idx];
+                case object::STRING:
+                    return withChars(first, [idx](auto chars) { return charsObject(chars.substr(idx, 1)); });
+                case object::LIST: return std::as_const(first).listVal()[idx];
+                case object::RANGE: return first.rangeVal().at(idx);
                 default: raiseError("get() function only works with string, list, and index");
                 }
             } },
 
-            { "has", [](object& first, const object::list& paramList) -> object {
+            { "has", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 2)
                     raiseError("has() invalid parameter count");
-                if (first.type() == object::STRING)
-                    return first.stringVal().find(paramList[1].toString()) != std::wstring::npos;
+                if (first.type() == object::STRING && paramList[1].type() == object::STRING)
+                    return withChars(first, paramList[1], [](auto str, auto key) { return str.find(key) != str.npos; });
+                else if (first.type() == object::STRING)
+                    return std::as_const(first).stringVal().find(paramList[1].toString()) != std::wstring::npos;
                 else if (first.type() == object::LIST)
-                    return std::find(first.listVal().begin(), first.listVal().end(), paramList[1]) != first.listVal().end();
+                {
+                    const auto& list = std::as_const(first).listVal();
+                    return std::find(list.begin(), list.end(), paramList[1]) != list.end();
+                }
                 else if (first.type() == object::INDEX)
-                    return first.indexVal().contains(paramList[1]);
+                    return std::as_const(first).indexVal().contains(paramList[1]);
+                else if (first.type() == object::RANGE)
+                    return rangeLocation(first.rangeVal(), paramList[1]) >= 0.0;
                 else
                     raiseError("has() only works with string, list, and index");
             }},
 
-            { "keys", [](object& first, const object::list& paramList) -> object {
+            { "keys", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::INDEX)
                     raiseError("keys() works with one index");
                 else
-                    return first.indexVal().keys(); // list == vector<object>, types match
+                    return std::as_const(first).indexVal().keys(); // list == vector<object>, types match
             }},
 
-            { "values", [](object& first, const object::list& paramList) -> object {
+            { "values", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::INDEX)
                     raiseError("values() works with one index");
                 else
-                    return first.indexVal().values(); // list == vector<object>, types match
+                    return std::as_const(first).indexVal().values(); // list == vector<object>, types match
             } },
 
-            { "reversed", [](object& first, const object::list& paramList) -> object {
+            { "reversed", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("reversed() works with one item");
 
                 if (first.type() == object::STRING)
                 {
-                    auto copy = first.stringVal();
+                    auto copy = std::as_const(first).stringVal();
                     std::reverse(copy.begin(), copy.end());
                     return copy;
                 }
                 else if (first.type() == object::LIST)
                 {
-                    auto copy = first.listVal();
-                    std::reverse(copy.begin(), copy.end());
+                    object copy = first.copyValue();
+                    auto& list = copy.listVal();
+                    std::reverse(list.begin(), list.end());
                     return copy;
                 }
+                else if (first.type() == object::RANGE)
+                {
+                    auto range = first.rangeVal();
+                    if (range.count > 0)
+                    {
+                        range.from = range.at(range.count - 1);
+                        range.step = -range.step;
+                    }
+                    return range;
+                }
                 else if (first.type() == object::INDEX)
                 {
-                    auto keys = first.indexVal().keys();
-                    std::reverse(keys.begin(), keys.end());
-
+                    const auto& items = std::as_const(first).indexVal().vec();
                     object::index newIndex;
-                    for (const auto& key : keys)
-                        newIndex.set(key, first.indexVal().get(key));
+                    newIndex.reserve(items.size());
+                    for (auto it = items.rbegin(); it != items.rend(); ++it)
+                        newIndex.set(it->first, it->second);
                     return newIndex;
                 }
                 else
                     raiseError("reversed() only works with string, list, and index");
             }},
 
-            { "sorted", [](object& first, const object::list& paramList) -> object {
+            { "sorted", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("sorted() works with one item");
                 if (first.type() == object::STRING)
                 {
-                    auto copy = first.stringVal();
+                    auto copy = std::as_const(first).stringVal();
                     std::sort(copy.begin(), copy.end());
                     return copy;
                 }
                 else if (first.type() == object::LIST)
                 {
-                    auto copy = first.listVal();
-                    std::sort(copy.begin(), copy.end());
+                    // Lists that are already sorted, like sorted() results, are shared, not copied
+                    object copy = first.copyValue();
+                    const auto& items = std::as_const(copy).listVal();
+                    if (!std::is_sorted(items.begin(), items.end()))
+                    {
+                        auto& list = copy.listVal();
+                        std::sort(list.begin(), list.end());
+                    }
                     return copy;
                 }
+                else if (first.type() == object::RANGE)
+                {
+                    auto range = first.rangeVal();
+                    if (range.count > 0 && range.step < 0.0)
+                    {
+                        range.from = range.at(range.count - 1);
+                        range.step = -range.step;
+                    }
+                    return range;
+                }
                 else if (first.type() == object::INDEX)
                 {
-                    auto keys = first.indexVal().keys();
-                    std::sort(keys.begin(), keys.end());
+                    auto items = std::as_const(first).indexVal().vec();
+                    std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
 
                     object::index newIndex;
-                    for (const auto& key : keys)
-                        newIndex.set(key, first.indexVal().get(key));
+                    newIndex.reserve(items.size());
+                    for (const auto& kvp : items)
+                        newIndex.set(kvp.first, kvp.second);
                     return newIndex;
                 }
                 else
@@ -948,21 +1450,30 @@ namespace mscript
             //
             // Strings
             //
-            { "join", [](object& first, const object::list& paramList) -> object {
+            { "join", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() > 2)
                     raiseError("join() takes item to work with, and optional separator");
-                if (first.type() != object::LIST)
-                    raiseError("join() only works with list");
+                if (first.type() != object::LIST && first.type() != object::RANGE)
+                    raiseError("join() only works with list and range");
 
                 std::wstring separator = paramList.size() == 2 ? paramList[1].toString() : L"";
                 std::vector<std::wstring> strings;
-                strings.reserve(first.listVal().size());
-                for (const auto& obj : first.listVal())
-                    strings.push_back(obj.toString());
+                strings.reserve(first.length());
+                if (first.type() == object::RANGE)
+                {
+                    const auto& range = first.rangeVal();
+                    for (size_t i = 0; i < range.count; ++i)
+                        strings.push_back(num2wstr(range.at(i)));
+                }
+                else
+                {
+                    for (const auto& obj : std::as_const(first).listVal())
+                        strings.push_back(obj.toString());
+                }
                 return join(strings, separator.c_str());
             } },
 
-            { "split", [](object& first, const object::list& paramList) -> object {
+            { "split", [](expression&, object& first, const object::list& paramList) -> object {
                 if
                 (
                     paramList.size() != 2
@@ -975,15 +1486,10 @@ namespace mscript
                     raiseError("split() works with an item and a separator string");
                 }
 
-                auto splitted = split(first.stringVal(), paramList[1].stringVal());
-                object::list splittedObjs;
-                splittedObjs.reserve(splitted.size());
-                for (const auto& str : splitted)
-                    splittedObjs.push_back(str);
-                return splittedObjs;
+                return withChars(first, paramList[1], [](auto str, auto separator) { return charsObjects(split(str, separator)); });
             } },
 
-            { "splitlines", [](object& first, const object::list& paramList) -> object {
+            { "splitlines", [](expression&, object& first, const object::list& paramList) -> object {
                 if
                 (
                     paramList.size() != 1
@@ -994,39 +1500,46 @@ namespace mscript
                     raiseError("splitLines() works with a string parameter");
                 }
 
-                auto splitted = split(replace(first.stringVal(), L"\r\n", L"\n"), L"\n");
-                object::list splittedObjs;
-                splittedObjs.reserve(splitted.size());
-                for (const auto& str : splitted)
-                    splittedObjs.push_back(str);
-                return splittedObjs;
+                return withChars(first, [](auto chars) {
+                    typedef typename decltype(chars)::value_type char_type;
+                    std::basic_string<char_type> text(chars);
+                    removeCarriageReturns(text);
+                    const char_type lf[] = { '\n', 0 };
+                    return charsObjects(split(decltype(chars)(text), decltype(chars)(lf)));
+                });
             } },
 
-            { "trimmed", [](object& first, const object::list& paramList) -> object {
+            { "trimmed", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("trimmed() works with one string");
-                return trim(first.stringVal());
+                return withChars(first, [](auto chars) { return charsObject(trimView(chars)); });
             }},
 
-            { "toupper", [](object& first, const object::list& paramList) -> object {
+            { "toupper", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("toUpper() works with one string");
-                auto str = first.stringVal();
-                for (auto& c : str)
-                    c = towupper(c);
-                return str;
+                return withChars(first, [](auto chars) {
+                    typedef typename decltype(chars)::value_type char_type;
+                    std::basic_string<char_type> str(chars);
+                    for (auto& c : str)
+                        c = char_type(towupper(c));
+                    return charsObject(std::move(str));
+                });
             } },
 
-            { "tolower", [](object& first, const object::list& paramList) -> object {
+            { "tolower", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("toLower() works with one string");
-                auto str = first.stringVal();
-                for (auto& c : str)
-                    c = towlower(c);
-                return str;
+                return withChars(first, [](auto chars) {
+                    typedef typename decltype(chars)::value_type char_type;
+                    std::basic_string<char_type> str(chars);
+                    for (auto& c : str)
+                        c = char_type(towlower(c));
+                    return charsObject(std::move(str));
+                });
             } },
 
-            { "replaced", [](object& first, const object::list& paramList) -> object {
+            { "replaced", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 if
                 (
@@ -1059,7 +1572,7 @@ namespace mscript
                 return input;
             } },
 
-            { "random", [](object& first, const object::list& paramList) -> object {
+            { "random", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 if
                 (
@@ -1083,10 +1596,10 @@ namespace mscript
                 return rnd;
             } },
 
-            { "fmt", [](object& first, const object::list& paramList) -> object {
+            { "fmt", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() < 1 || first.type() != object::STRING)
                     raiseError("fmt() one string, and other parameters to insert");
-                std::wstring format = first.stringVal();
+                std::wstring format = std::as_const(first).stringVal();
                 for (size_t p = 1; p < paramList.size(); ++p)
                     format = replace(format, L"{" + std::to_wstring(p - 1) + L"}", paramList[p].toString());
                 return format;
@@ -1095,7 +1608,7 @@ namespace mscript
             //
             // Searching and Slicing
             //
-            { "firstlocation", [](object& first, const object::list& paramList) -> object {
+            { "firstlocation", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 2)
                     raiseError("firstLocation() works with an item to look in and a key to look for");
 
@@ -1103,7 +1616,7 @@ namespace mscript
                 {
                     if (paramList[1].type() != object::STRING)
                         raiseError("firstLocation() invalid parameter");
-                    size_t idx = first.stringVal().find(paramList[1].stringVal());
+                    size_t idx = withChars(first, paramList[1], [](auto str, auto key) { return str.find(key); });
                     if (idx == std::wstring::npos)
                         return double(-1);
                     else
@@ -1111,7 +1624,7 @@ namespace mscript
                 }
                 else if (first.type() == object::LIST)
                 {
-                    const auto& l = first.listVal();
+                    const auto& l = std::as_const(first).listVal();
                     for (size_t i = 0; i < l.size(); ++i)
                     {
                         if (l[i] == paramList[1])
@@ -1119,11 +1632,13 @@ namespace mscript
                     }
                     return double(-1);
                 }
+                else if (first.type() == object::RANGE)
+                    return rangeLocation(first.rangeVal(), paramList[1]);
                 else
-                    raiseError("firstLocation() only works with string and list");
+                    raiseError("firstLocation() only works with string, list, and range");
             } },
 
-            { "lastlocation", [](object& first, const object::list& paramList) -> object {
+            { "lastlocation", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 2)
                     raiseError("lastLocation() works with an item to look in and a key to look for");
 
@@ -1131,7 +1646,7 @@ namespace mscript
                 {
                     if (paramList[1].type() != object::STRING)
                         raiseError("lastLocation() invalid parameter");
-                    size_t idx = first.stringVal().rfind(paramList[1].stringVal());
+                    size_t idx = withChars(first, paramList[1], [](auto str, auto key) { return str.rfind(key); });
                     if (idx == std::wstring::npos)
                         return double(-1);
                     else
@@ -1139,95 +1654,107 @@ namespace mscript
                 }
                 else if (first.type() == object::LIST)
                 {
-                    const auto& l = first.listVal();
-                    for (int i = int(l.size()) - 1; i >= 0; --i)
+                    const auto& l = std::as_const(first).listVal();
+                    for (size_t i = l.size(); i > 0; --i)
                     {
-                        if (l[i] == paramList[1])
-                            return double(i);
+                        if (l[i - 1] == paramList[1])
+                            return double(i - 1);
                     }
                     return double(-1);
                 }
+                else if (first.type() == object::RANGE)
+                    return rangeLocation(first.rangeVal(), paramList[1]);
                 else
-                    raiseError("lastLocation() only works with string and list");
+                    raiseError("lastLocation() only works with string, list, and range");
             } },
 
-            { "subset", [](object& first, const object::list& paramList) -> object {
+            { "subset", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 2 && paramList.size() != 3)
                     raiseError("subset() works with an item and a start index and an optional length");
 
-                int startIndex;
+                size_t startIndex;
                 {
                     if (paramList[1].type() != object::NUMBER)
                         raiseError("subset() start index must be number");
-                    startIndex = int(paramList[1].numberVal());
-                    if (startIndex < 0)
+                    if (!(trunc(paramList[1].numberVal()) >= 0.0))
                         raiseError("subset() start index must be greater than or equal zero");
+                    startIndex = toSize(paramList[1].numberVal());
                 }
 
                 if (paramList.size() == 2)
                 {
                     if (first.type() == object::STRING)
                     {
-                        const auto& s = first.stringVal();
-                        if (startIndex >= int(s.size()))
-                            raiseError("subset() start index must be less than the length of the string");
-                        else
-                            return s.substr(startIndex);
+                        return withChars(first, [startIndex](auto s) {
+                            if (startIndex >= s.size())
+                                raiseError("subset() start index must be less than the length of the string");
+                            return charsObject(s.substr(startIndex));
+                        });
                     }
                     else if (first.type() == object::LIST)
                     {
-                        const auto& list = first.listVal();
-                        if (startIndex >= int(list.size()))
+                        const auto& list = std::as_const(first).listVal();
+                        if (startIndex >= list.size())
                             raiseError("subset() start index must be less than the length of the list");
-                        object::list subset;
-                        for (int i = startIndex; i < int(list.size()); ++i)
-                            subset.push_back(list[i]);
-                        return subset;
+                        if (startIndex == 0)
+                            return first.copyValue();
+                        return object::list(list.begin() + startIndex, list.end());
+                    }
+                    else if (first.type() == object::RANGE)
+                    {
+                        const auto& range = first.rangeVal();
+                        if (startIndex >= range.count)
+                            raiseError("subset() start index must be less than the length of the range");
+                        return subRange(range, startIndex, range.count);
                     }
                     else
-                        raiseError("subset() works with string and list");
+                        raiseError("subset() works with string, list, and range");
                 }
                 else
                 {
-                    int length;
+                    size_t length;
                     {
                         if (paramList[2].type() != object::NUMBER)
                             raiseError("substring() invalid arguments");
-                        length = int(paramList[2].numberVal());
-                        if (length < 0)
+                        if (!(trunc(paramList[2].numberVal()) >= 0.0))
                             raiseError("subset() length must be greater than or equal zero");
+                        length = toSize(paramList[2].numberVal());
                     }
 
                     if (first.type() == object::STRING)
                     {
-                        const auto& s = first.stringVal();
-                        if (startIndex >= int(s.size()))
-                            raiseError("subset() start index must be less than the length of the string");
-                        else
-                            return s.substr(startIndex, length);
+                        return withChars(first, [startIndex, length](auto s) {
+                            if (startIndex >= s.size())
+                                raiseError("subset() start index must be less than the length of the string");
+                            return charsObject(s.substr(startIndex, length));
+                        });
                     }
                     else if (first.type() == object::LIST)
                     {
-                        const auto& list = first.listVal();
-                        if (startIndex >= int(list.size()))
+                        const auto& list = std::as_const(first).listVal();
+                        if (startIndex >= list.size())
                             raiseError("subset() start index must be less than the length of the list");
-                        object::list subset;
-                        int endIndex = std::min(int(list.size()) - 1, startIndex + length - 1);
-                        if (endIndex >= int(list.size()))
-                            raiseError("subset() end index must be less than the length of the list");
-                        for (int i = startIndex; i <= endIndex; ++i)
-                            subset.push_back(list[i]);
-                        return subset;
+                        size_t endIndex = startIndex + std::min(length, list.size() - startIndex);
+                        if (startIndex == 0 && endIndex == list.size())
+                            return first.copyValue();
+                        return object::list(list.begin() + startIndex, list.begin() + endIndex);
+                    }
+                    else if (first.type() == object::RANGE)
+                    {
+                        const auto& range = first.rangeVal();
+                        if (startIndex >= range.count)
+                            raiseError("subset() start index must be less than the length of the range");
+                        return subRange(range, startIndex, length);
                     }
                     else
-                        raiseError("subset() works with string and list");
+                        raiseError("subset() works with string, list, and range");
                 }
             } },
 
             //
             // Regular Expressions
             //
-            { "ismatch", [](object& first, const object::list& paramList) -> object {
+            { "ismatch", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 bool full_match = false;
                 if (paramList.size() < 2 || paramList.size() > 3)
@@ -1244,14 +1771,15 @@ namespace mscript
                         full_match = paramList[2].boolVal();
                 }
 
-                std::wregex re(paramList[1].stringVal());
+                auto re = regex_cache::global().get(paramList[1].stringVal());
+                const std::wstring& str = regexInput(first);
                 return 
                     full_match
-                    ? std::regex_match(first.stringVal(), re)
-                    : std::regex_search(first.stringVal(), re);
+                    ? std::regex_match(str, *re)
+                    : std::regex_search(str, *re);
             } },
 
-            { "getmatches", [](object& first, const object::list& paramList) -> object {
+            { "getmatches", [](expression&, object& first, const object::list& paramList) -> object {
                 bool full_match = false;
                 if (paramList.size() < 2 || paramList.size() > 3)
                     raiseError("getMatches() works string to match and pattern");
@@ -1267,13 +1795,14 @@ namespace mscript
                         full_match = paramList[2].boolVal();
                 }
 
-                std::wregex re(paramList[1].stringVal());
+                auto re = regex_cache::global().get(paramList[1].stringVal());
 
+                const std::wstring& str = regexInput(first);
                 std::wsmatch sm;
                 if (full_match)
-                    std::regex_match(first.stringVal(), sm, re);
+                    std::regex_match(str, sm, *re);
                 else
-                    std::regex_search(first.stringVal(), sm, re);
+                    std::regex_search(str, sm, *re);
 
                 object::list output;
                 for (const auto& m : sm)
@@ -1281,7 +1810,7 @@ namespace mscript
                 return output;
             } },
 
-            { "getmatchlength", [](object& first, const object::list& paramList) -> object {
+            { "getmatchlength", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 bool full_match = false;
                 if (paramList.size() < 2 || paramList.size() > 3)
@@ -1298,13 +1827,14 @@ namespace mscript
                         full_match = paramList[2].boolVal();
                 }
 
-                std::wregex re(paramList[1].stringVal());
+                auto re = regex_cache::global().get(paramList[1].stringVal());
 
+                const std::wstring& str = regexInput(first);
                 std::wsmatch sm;
                 if (full_match)
-                    std::regex_match(first.stringVal(), sm, re);
+                    std::regex_match(str, sm, *re);
                 else
-                    std::regex_search(first.stringVal(), sm, re);
+                    std::regex_search(str, sm, *re);
 
                 object::list output;
                 for (const auto& m : sm)
@@ -1312,10 +1842,24 @@ namespace mscript
                 return double(-1);
             } },
 
+            { "getregexcachestats", [](expression&, object& first, const object::list& paramList) -> object {
+                (void)first;
+                if (paramList.size() != 0)
+                    raiseError("getRegexCacheStats() takes no parameters");
+
+                const regex_cache& cache = regex_cache::global();
+                object::index stats;
+                stats.set(toWideStr("hits"), double(cache.hits()));
+                stats.set(toWideStr("misses"), double(cache.misses()));
+                stats.set(toWideStr("size"), double(cache.size()));
+                stats.set(toWideStr("capacity"), double(cache.capacity()));
+                return stats;
+            } },
+
             //
             // Process Control
             //
-            { "exec", [](object& first, const object::list& paramList) -> object {
+            { "exec", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() < 1 || first.type() != object::STRING)
                     raiseError("exec() works with a command string");
 
@@ -1362,7 +1906,7 @@ namespace mscript
                 int exit_code = -1;
                 if (method.empty() || method == L"popen")
                 {
-                    FILE* file = _wpopen(first.stringVal().c_str(), L"rt");
+                    FILE* file = _wpopen(std::as_const(first).stringVal().c_str(), L"rt");
                     if (file == nullptr)
                         return retVal;
 
@@ -1370,7 +1914,7 @@ namespace mscript
                     std::string output;
                     while (fgets(buffer, sizeof(buffer), file))
                         output.append(buffer);
-                    retVal.set(toWideStr("output"), toWideStr(output));
+                    retVal.set(toWideStr("output"), object::fromUtf8(std::move(output)));
 
                     retVal.set(toWideStr("success"), bool(feof(file)));
 
@@ -1379,7 +1923,7 @@ namespace mscript
                 }
                 else if (method == L"system")
                 {
-                    exit_code = ::_wsystem(first.stringVal().c_str());
+                    exit_code = ::_wsystem(std::as_const(first).stringVal().c_str());
                     retVal.set(toWideStr("success"), true);
                 }
                 else
@@ -1398,7 +1942,7 @@ namespace mscript
                 return retVal;
             } },
 
-            { "system", [this](object& first, const object::list& paramList) -> object {
+            { "system", [](expression& exp, object& first, const object::list& paramList) -> object {
                 if
                 (
                     paramList.empty()
@@ -1416,13 +1960,13 @@ namespace mscript
 
                 // raise errors by default, users to pass true to suppress them
                 bool raise_errors = paramList.size() < 2 || !paramList[1].boolVal();
-                int exit_code = ::_wsystem(first.stringVal().c_str());
+                int exit_code = ::_wsystem(std::as_const(first).stringVal().c_str());
                 if (raise_errors && exit_code != 0)
                     raiseError("system() failed with exit code " + std::to_string(exit_code));
                 return object(double(exit_code));
             } },
 
-            { "popen", [](object& first, const object::list& paramList) -> object {
+            { "popen", [](expression&, object& first, const object::list& paramList) -> object {
                 if
                 (
                     paramList.empty()
@@ -1441,7 +1985,7 @@ namespace mscript
                 // raise errors by default, users to pass true to suppress them
                 bool raise_errors = paramList.size() < 2 || !paramList[1].boolVal();
 
-                FILE* file = _wpopen(first.stringVal().c_str(), L"rt");
+                FILE* file = _wpopen(std::as_const(first).stringVal().c_str(), L"rt");
                 if (file == nullptr)
                 {
                     if (raise_errors)
@@ -1450,12 +1994,10 @@ namespace mscript
                         return std::wstring();
                 }
 
-                std::wstring output;
                 char buffer[4096];
-                std::string temp;
+                std::string output;
                 while (fgets(buffer, sizeof(buffer), file))
-                    temp.append(buffer);
-                output = toWideStr(temp);
+                    output.append(buffer);
 
                 bool success = feof(file) != 0;
 
@@ -1470,57 +2012,57 @@ namespace mscript
                         raiseError("popen() failed with exit code " + std::to_string(exit_code));
                 }
 
-                return output;
+                return object::fromUtf8(std::move(output));
             } },
 
-            { "setenv", [](object& first, const object::list& paramList) -> object {
+            { "setenv", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 if (paramList.size() != 2 || first.type() != object::STRING || paramList[1].type() != object::STRING)
                     raiseError("setEnv() works with name and value string parameters");
 
-                if (_wputenv((first.stringVal() + L"=" + paramList[1].stringVal()).c_str()) != 0)
+                if (_wputenv((std::as_const(first).stringVal() + L"=" + paramList[1].stringVal()).c_str()) != 0)
                     raiseError("setEnv() setting environment variable failed");
 
                 return object();
             } },
 
-            { "getenv", [](object& first, const object::list& paramList) -> object {
+            { "getenv", [](expression&, object& first, const object::list& paramList) -> object {
                 (void)first;
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("getEnv() works with one name string parameter");
 
                 std::wstring envValStr;
                 {
-                    const wchar_t* envVal = _wgetenv(first.stringVal().c_str());
+                    const wchar_t* envVal = _wgetenv(std::as_const(first).stringVal().c_str());
                     if (envVal != nullptr)
                         envValStr = envVal;
                 }
                 return envValStr;
             } },
 #if defined(_WIN32) || defined(_WIN64)
-            { "expandedenvvars", [](object& first, const object::list& paramList) -> object {
+            { "expandedenvvars", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("expandedEnvVars() works with one string parameter");
 
                 const unsigned int output_str_len = 32 * 1024;
                 std::unique_ptr<wchar_t[]> output_str(new wchar_t[output_str_len]);
-                ExpandEnvironmentStrings(first.stringVal().c_str(), output_str.get(), output_str_len);
+                ExpandEnvironmentStrings(std::as_const(first).stringVal().c_str(), output_str.get(), output_str_len);
                 return std::wstring(output_str.get());
             } },
 #endif
-            { "getexefilepath", [](object&, const object::list& paramList) -> object {
+            { "getexefilepath", [](expression&, object&, const object::list& paramList) -> object {
                 if (!paramList.empty())
                     raiseError("getExeFilePath() takes no parameters");
                 return getExeFilePath();
             } },
 
-            { "getbinaryversion", [](object& first, const object::list& paramList) -> object {
+            { "getbinaryversion", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("getBinaryVersion() takes one string parameter");
-                return toWideStr(getBinaryVersion(first.stringVal()));
+                return toWideStr(getBinaryVersion(std::as_const(first).stringVal()));
             } },
 
-            { "parseargs", [](object& first, const object::list& paramList) -> object {
+            { "parseargs", [](expression&, object& first, const object::list& paramList) -> object {
                 if
                 (
                     paramList.size() != 2
@@ -1533,37 +2075,37 @@ namespace mscript
                     raiseError("parseArgs() works with a list of arguments and a list of argument specifications");
                 }
 
-                object ret_val = parseArgs(first.listVal(), paramList[1].listVal());
+                object ret_val = parseArgs(std::as_const(first).listVal(), paramList[1].listVal());
                 return ret_val;
             } },
 
-            { "exit", [](object& first, const object::list& paramList) -> object {
+            { "exit", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::NUMBER)
                     raiseError("exit() works with one exit code number");
                 exit(int(first.numberVal()));
             } },
 
-            { "error", [](object& first, const object::list& paramList) -> object {
+            { "error", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1)
                     raiseError("error() works with one object for error handling");
                 throw user_exception(first);
             } },
 
-            { "sleep", [](object& first, const object::list& paramList) -> object {
+            { "sleep", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::NUMBER)
                     raiseError("sleep() works with one parameter, the number of seconds to sleep");
                 std::this_thread::sleep_for(std::chrono::seconds(int(first.numberVal())));
                 return true;
             } },
 
-            { "cd", [](object& first, const object::list& paramList) -> object {
+            { "cd", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("cd() works with one parameter, the directory to change to");
-                (void)_wchdir(first.stringVal().c_str());
+                (void)_wchdir(std::as_const(first).stringVal().c_str());
                 return true;
             } },
 
-            { "curdir", [](object& first, const object::list& paramList) -> object {
+            { "curdir", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() == 0)
                 {
                     wchar_t* buffer = _wgetcwd(nullptr, 0);
@@ -1583,16 +2125,16 @@ namespace mscript
                     (
                         first.type() != object::STRING
                         || 
-                        first.stringVal().size() > 2 
+                        std::as_const(first).stringVal().size() > 2 
                         || 
-                        !iswalpha(first.stringVal()[0])
+                        !iswalpha(std::as_const(first).stringVal()[0])
                         ||
-                        (first.stringVal().length() == 2 && first.stringVal()[1] != ':')
+                        (std::as_const(first).stringVal().length() == 2 && std::as_const(first).stringVal()[1] != ':')
                     )
                     {
                         raiseError("curDir() drive must be a letter and an optional :");
                     }
-                    int drive = 1 + (int(toUpper(first.stringVal())[0]) - int('A'));
+                    int drive = 1 + (int(toUpper(std::as_const(first).stringVal())[0]) - int('A'));
                     wchar_t* buffer = _wgetdcwd(drive, nullptr, 0);
                     if (buffer != nullptr)
                     {
@@ -1609,13 +2151,13 @@ namespace mscript
             } },
 
 #if defined(_WIN32) || defined(_WIN64)
-            { "getlasterror", [](object&, const object::list& paramList) -> object {
+            { "getlasterror", [](expression&, object&, const object::list& paramList) -> object {
                 if (paramList.size() != 0)
                     raiseError("getLastError() takes no parameters");
                 return double(::GetLastError());
             } },
 
-            { "getlasterrormsg", [](object& first, const object::list& paramList) -> object {
+            { "getlasterrormsg", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() == 0)
                 {
                     return mscript::getLastErrorMsg();
@@ -1632,7 +2174,7 @@ namespace mscript
                     raiseError("getLastErrorMsg() takes at most one parameter, the error number");
             } },
 
-            { "getinistring", [](object&, const object::list& paramList) -> object {
+            { "getinistring", [](expression&, object&, const object::list& paramList) -> object {
                 if
                 (
                     paramList.size() != 4
@@ -1674,7 +2216,7 @@ namespace mscript
                 return std::wstring(output_str.get());
             } },
 
-            { "getininumber", [](object&, const object::list& paramList) -> object {
+            { "getininumber", [](expression&, object&, const object::list& paramList) -> object {
                 if
                 (
                     paramList.size() != 4
@@ -1717,7 +2259,7 @@ namespace mscript
             //
             // File I/O
             //
-            { "readfile", [](object& first, const object::list& paramList) -> object {
+            { "readfile", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 2
                     || first.type() != object::STRING
                     || paramList[1].type() != object::STRING)
@@ -1725,27 +2267,22 @@ namespace mscript
                     raiseError("readFile() works with a file path string and an encoding string");
                 }
 
-                std::wstring filePath = first.stringVal();
+                std::wstring filePath = std::as_const(first).stringVal();
                 std::wstring encoding = paramList[1].stringVal();
 
-                if (encoding == L"ascii")
+                // ASCII and UTF-8 files are mapped and decoded in one go
+                if (encoding == L"ascii" || encoding == L"utf-8" || encoding == L"utf8")
                 {
-                    std::ifstream file(filePath);
-                    if (!file)
+                    mapped_file file(filePath);
+                    if (!file.isOpen())
                         return object();
 
-                    std::stringstream stream;
-                    stream << file.rdbuf();
-
-                    std::string output = stream.str();
-                    return toWideStr(output);
+                    return fileText(file.view());
                 }
 
-                if (encoding == L"utf-8" || encoding == L"utf-16" || encoding == L"utf8" || encoding == L"utf16")
+                if (encoding == L"utf-16" || encoding == L"utf16")
                 {
                     std::wifstream file(filePath);
-                    if (encoding == L"utf-8" || encoding == L"utf8")
-                        file.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
                     if (!file)
                         return object();
 
@@ -1759,7 +2296,7 @@ namespace mscript
                 raiseError("Unsupported readFile() encoding: must be ascii, utf-8, or utf-16");
             } },
 
-            { "readfilelines", [](object& first, const object::list& paramList) -> object {
+            { "readfilelines", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 2
                     || first.type() != object::STRING
                     || paramList[1].type() != object::STRING)
@@ -1767,31 +2304,42 @@ namespace mscript
                     raiseError("readFileLines() works with a file path string and an encoding string");
                 }
 
-                std::wstring filePath = first.stringVal();
+                std::wstring filePath = std::as_const(first).stringVal();
                 std::wstring encoding = paramList[1].stringVal();
 
-                if (encoding == L"ascii")
+                // ASCII and UTF-8 files are mapped and split into lines in place,
+                // each line is decoded straight into the list
+                if (encoding == L"ascii" || encoding == L"utf-8" || encoding == L"utf8")
                 {
-                    std::ifstream file(filePath);
-                    if (!file)
+                    mapped_file file(filePath);
+                    if (!file.isOpen())
                         return object();
 
+                    line_reader reader(file.view());
                     object::list ret_val;
-                    std::string line;
-                    for (;;)
+                    ret_val.reserve(reader.countLines());
+
+                    std::string_view line;
+                    std::string withoutCrs;
+                    while (reader.next(line))
                     {
-                        if (!std::getline(file, line))
-                            break;
-                        ret_val.push_back(replace(toWideStr(line), L"\r", L""));
+                        if (line.find('\r') == std::string_view::npos)
+                        {
+                            ret_val.push_back(object::fromUtf8(line));
+                        }
+                        else
+                        {
+                            withoutCrs.assign(line);
+                            withoutCrs.erase(std::remove(withoutCrs.begin(), withoutCrs.end(), '\r'), withoutCrs.end());
+                            ret_val.push_back(object::fromUtf8(withoutCrs));
+                        }
                     }
                     return ret_val;
                 }
 
-                if (encoding == L"utf-8" || encoding == L"utf-16" || encoding == L"utf8" || encoding == L"utf16")
+                if (encoding == L"utf-16" || encoding == L"utf16")
                 {
                     std::wifstream file(filePath);
-                    if (encoding == L"utf-8" || encoding == L"utf8")
-                        file.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
                     if (!file)
                         return object();
 
@@ -1809,7 +2357,21 @@ namespace mscript
                 raiseError("Unsupported readFileLines() encoding: must be ascii, utf-8, or utf-16");
             } },
 
-            { "writefile", [](object& first, const object::list& paramList) -> object {
+            // @ loops read the lines one at a time, anywhere else this is readFileLines()
+            { "streamfilelines", [](expression&, object& first, const object::list& paramList) -> object {
+                (void)first;
+                enumerator_ptr lines = enumerateFileLines(paramList);
+                if (!lines)
+                    return object();
+
+                object::list ret_val;
+                object line;
+                while (lines->next(line))
+                    ret_val.push_back(line);
+                return ret_val;
+            } },
+
+            { "writefile", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 3
                     || first.type() != object::STRING
                     || paramList[1].type() != object::STRING
@@ -1818,10 +2380,22 @@ namespace mscript
                     raiseError("writeFile() works with a file path string, file contents string, and an encoding string");
                 }
 
-                std::wstring filePath = first.stringVal();
-                std::wstring contents = paramList[1].stringVal();
+                std::wstring filePath = std::as_const(first).stringVal();
                 std::wstring encoding = paramList[2].stringVal();
 
+                // ASCII strings are already the bytes of ASCII and UTF-8 files
+                if (paramList[1].isAsciiString() && (encoding == L"ascii" || encoding == L"utf-8" || encoding == L"utf8"))
+                {
+                    std::ofstream file(filePath, std::ofstream::trunc);
+                    if (!file)
+                        return false;
+
+                    const std::string& narrow = paramList[1].asciiVal();
+                    file.write(narrow.c_str(), narrow.size());
+                    return true;
+                }
+
+                std::wstring contents = paramList[1].stringVal();
                 if (encoding == L"ascii")
                 {
                     std::ofstream file(filePath, std::ofstream::trunc);
@@ -1851,28 +2425,29 @@ namespace mscript
             //
             // JSON
             //
-            { "tojson", [](object& first, const object::list& paramList) -> object {
-                if (paramList.size() != 1)
-                    raiseError("toJson() takes one object to turn into JSON");
+            { "tojson", [](expression&, object& first, const object::list& paramList) -> object {
+                if (paramList.size() != 1 && (paramList.size() != 2 || paramList[1].type() != object::BOOL))
+                    raiseError("toJson() takes one object to turn into JSON, and an optional pretty printing bool");
                 else
-                    return objectToJson(first);
+                    return objectToJson(first, paramList.size() == 2 && paramList[1].boolVal());
             } },
 
-            { "fromjson", [](object& first, const object::list& paramList) -> object {
+            { "fromjson", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::STRING)
                     raiseError("fromJson() takes one JSON string to turn into an object");
-                else
-                    return objectFromJson(first.stringVal());
+
+                // ASCII strings, like readFile() of ASCII JSON files, are parsed as they are
+                return withChars(first, [](auto json) { return objectFromJson(json); });
             } },
 
             //
             // HTML & URL encodings
             //
-            { "htmlencoded", [](object& first, const object::list& paramList) -> object {
+            { "htmlencoded", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::object_type::STRING)
                     raiseError("htmlEncoded() takes one string to HTML encode");
 
-                std::wstring input_str = first.stringVal();
+                std::wstring input_str = std::as_const(first).stringVal();
 
                 std::wstring output_str;
                 output_str.reserve(input_str.size()); // most strings need no encoding
@@ -1891,11 +2466,11 @@ namespace mscript
                 return output_str;
             } },
 
-            { "htmldecoded", [](object& first, const object::list& paramList) -> object {
+            { "htmldecoded", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::object_type::STRING)
                     raiseError("htmlDecoded() takes one string to HTML encode");
 
-                std::wstring output_str = first.stringVal();
+                std::wstring output_str = std::as_const(first).stringVal();
                 output_str = replace(output_str, L"&gt;", L">");
                 output_str = replace(output_str, L"&lt;", L"<");
                 output_str = replace(output_str, L"&apos;", L"\'");
@@ -1904,7 +2479,7 @@ namespace mscript
                 return output_str;
             } },
 
-            { "urlencoded", [](object& first, const object::list& paramList) -> object {
+            { "urlencoded", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::object_type::STRING)
                     raiseError("urlEncoded() takes one string to URL encode");
 
@@ -1928,7 +2503,7 @@ namespace mscript
                 return escaped.str();
             } }, 
 
-            { "urldecoded", [](object& first, const object::list& paramList) -> object {
+            { "urldecoded", [](expression&, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::object_type::STRING)
                     raiseError("urlDecoded() takes one string to URL decode");
 
@@ -1952,7 +2527,7 @@ namespace mscript
             } },
 
             // section / level tracing
-            { "settracing", [this](object& first, const object::list& paramList) -> object {
+            { "settracing", [](expression& exp, object& first, const object::list& paramList) -> object {
                 if
                 (
                     paramList.size() != 2
@@ -1965,32 +2540,169 @@ namespace mscript
                     raiseError("setTracing() takes a list of sections to enable, and a level to trace at");
                 }
 
-                this->m_traceInfo.ActiveSections.clear();
-                for (auto section_obj : first.listVal())
-                    this->m_traceInfo.ActiveSections.push_back(section_obj.toString());
+                exp.m_traceInfo.ActiveSections.clear();
+                for (const auto& section_obj : std::as_const(first).listVal())
+                    exp.m_traceInfo.ActiveSections.push_back(section_obj.toString());
 
-                this->m_traceInfo.CurrentTraceLevel = (TraceLevel)(int)paramList[1].numberVal();
+                exp.m_traceInfo.CurrentTraceLevel = (TraceLevel)(int)paramList[1].numberVal();
 
                 return object();
             } },
 
             // Add evil, I mean, eval()
-            { "eval", [this](object& first, const object::list& paramList) -> object {
+            { "eval", [](expression& exp, object& first, const object::list& paramList) -> object {
                 if (paramList.size() != 1 || first.type() != object::object_type::STRING)
                     raiseError("eval() takes one string expression to evaluate");
                 else
-                    return evaluate(first.stringVal());
+                    return exp.evaluate(std::as_const(first).stringVal());
             } },
         };
+        return functions;
+    }
+
+    object expression::call(const expression_node& node, const object::list& paramList)
+    {
+        call_target& target = node.target;
+        if
+        (
+            target.type == call_target::UNRESOLVED
+            ||
+            target.generation != callable::functionsGeneration()
+            ||
+            target.resolver != &m_callable
+        )
+        {
+            resolveCall(node.name, target);
+        }
+        return callTarget(target, node.name, paramList);
+    }
+
+    void expression::resolveCall(const std::wstring& functionW, call_target& target) const
+    {
+        target = call_target();
+        target.generation = callable::functionsGeneration();
+        target.resolver = &m_callable;
+        target.name = toLower(functionW);
+
+        // Same order as executeFunction: built-ins, user functions, modules, members
+        const auto& functions = builtInFunctions();
+        const auto& funcIt = functions.find(toNarrowStr(target.name));
+        if (funcIt != functions.end())
+        {
+            target.type = call_target::BUILT_IN;
+            target.builtIn = &funcIt->second;
+            target.changesFirst = changesFirstParam(target.name);
+            return;
+        }
+
+        if (m_callable.hasFunction(target.name))
+        {
+            target.scriptFunction = m_callable.findFunction(target.name);
+            target.type = target.scriptFunction != nullptr ? call_target::SCRIPT : call_target::CALLABLE;
+            return;
+        }
+
+        target.module = lib::getLib(target.name);
+        if (target.module != nullptr)
+        {
+            target.type = call_target::MODULE;
+            return;
+        }
+
+        size_t dotIndex = target.name.find('.');
+        if (dotIndex != std::wstring::npos)
+        {
+            target.type = call_target::MEMBER;
+            target.memberOf = symbol_ref(target.name.substr(0, dotIndex));
+            target.member = std::make_shared<call_target>();
+            resolveCall(target.name.substr(dotIndex + 1), *target.member);
+            return;
+        }
+
+        target.type = call_target::OTHER;
+    }
+
+    object expression::callTarget(const call_target& target, const std::wstring& functionW, const object::list& paramList)
+    {
+        switch (target.type)
+        {
+        case call_target::BUILT_IN:
+        {
+            object first = paramList.size() == 0 ? object::NOTHING : paramList[0];
+            return (*target.builtIn)(*this, first, paramList);
+        }
+
+        case call_target::SCRIPT:
+            return m_callable.callScriptFunction(*target.scriptFunction, paramList);
+
+        case call_target::CALLABLE:
+            return m_callable.callFunction(target.name, paramList);
+
+        case call_target::MODULE:
+            return target.module->executeFunction(target.name, paramList);
+
+        case call_target::MEMBER:
+        {
+            // x.add() and x.set() change the variable itself, in place
+            if (target.member->changesFirst)
+            {
+                object* variable = m_symbols.tryGetVariable(target.memberOf);
+                if (variable == nullptr)
+                    break;
+                return callChangingVariable(*target.member->builtIn, *variable, paramList);
+            }
+
+            object value;
+            if (!m_symbols.tryGet(target.memberOf, value))
+                break;
+
+            object::list newVals;
+            newVals.reserve(paramList.size() + 1);
+            newVals.push_back(value);
+            newVals.insert(newVals.end(), paramList.begin(), paramList.end());
+            return callTarget(*target.member, target.member->name, newVals);
+        }
+
+        default:
+            break;
+        }
+
+        // Dynamic calls and errors
+        return executeFunction(functionW, paramList);
+    }
+
+    bool expression::changesFirstParam(const std::wstring& functionLower)
+    {
+        return functionLower == L"add" || functionLower == L"set";
+    }
+
+    object expression::callChangingVariable(const built_in_function& function, object& variable, const object::list& paramList)
+    {
+        // The variable stands in for the first parameter, and the list does not get a copy of it,
+        // so a string that only the variable has is not copied to be changed
+        object::list newVals;
+        newVals.reserve(paramList.size() + 1);
+        newVals.emplace_back();
+        newVals.insert(newVals.end(), paramList.begin(), paramList.end());
+        return function(*this, variable, newVals);
+    }
+
+    object expression::executeFunction(std::wstring functionW, const object::list& paramList)
+    {
+        functionW = toLower(functionW);
+        const std::string function = toNarrowStr(functionW);
+
+        object first = paramList.size() == 0 ? object::NOTHING : paramList[0];
 
         //
         // Function calls
         //
 
         // built in functions
+        const auto& functions = builtInFunctions();
         const auto& funcIt = functions.find(function);
         if (funcIt != functions.end())
-            return funcIt->second(first, paramList);
+            return funcIt->second(*this, first, paramList);
 
         // user functions
         if (m_callable.hasFunction(functionW)) 
@@ -2017,6 +2729,13 @@ namespace mscript
                 std::wstring symbol = functionW.substr(0, dotIndex);
                 std::wstring memberFunc = functionW.substr(dotIndex + 1);
 
+                if (changesFirstParam(memberFunc))
+                {
+                    object* variable = m_symbols.tryGetVariable(symbol);
+                    if (variable != nullptr)
+                        return callChangingVariable(functions.at(toNarrowStr(memberFunc)), *variable, paramList);
+                }
+
                 object value;
                 if (m_symbols.tryGet(symbol, value))
                 {
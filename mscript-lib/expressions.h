@@ -1,11 +1,14 @@
 #pragma once
 
 #include "callable.h"
+#include "expression_tree.h"
 #include "object.h"
 #include "symbols.h"
 #include "tracing.h"
 
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace mscript
 {
@@ -24,11 +27,13 @@ namespace mscript
         /// </summary>
         /// <param name="symbols"></param>
         /// <param name="callable"></param>
-        expression(symbol_table& symbols, callable& callable, tracing& traceInfo, bool allowDynamicCalls = false)
+        /// <param name="cache">Optional cache of compiled expressions to reuse</param>
+        expression(symbol_table& symbols, callable& callable, tracing& traceInfo, bool allowDynamicCalls = false, expression_cache* cache = nullptr)
             : m_symbols(symbols)
             , m_callable(callable)
             , m_traceInfo(traceInfo)
             , m_allowDynamicCalls(allowDynamicCalls)
+            , m_cache(cache)
         {}
 
         /// <summary>
@@ -36,24 +41,85 @@ namespace mscript
         /// </summary>
         /// <param name="expStr">The expression string to evaluate</param>
         /// <returns>The value from evaluating the expression</returns>
-        object evaluate(std::wstring expStr);
+        object evaluate(const std::wstring& expStr);
+
+        /// <summary>
+        /// Evaluate a compiled expression
+        /// </summary>
+        /// <param name="node">The root of the compiled expression</param>
+        /// <returns>The value from evaluating the expression</returns>
+        object evaluate(const expression_node& node);
+
+        /// <summary>
+        /// Parse an expression string into a tree that can be evaluated many times
+        /// Parsing errors are not raised here, they are raised when the tree is evaluated
+        /// </summary>
+        /// <param name="expStr">The expression string to compile</param>
+        /// <returns>The root of the compiled expression</returns>
+        static expression_node_ptr compile(std::wstring_view expStr);
+
+        /// <summary>
+        /// Call the function of a compiled function call with parameters already evaluated
+        /// </summary>
+        object call(const expression_node& node, const object::list& paramList);
+
+        /// <summary>
+        /// Apply a binary operator to values already evaluated
+        /// </summary>
+        /// <param name="expStr">The expression text, for error messages</param>
+        static object evaluateBinaryOp(expression_node::op_type op, const object& leftVal, const object& rightVal, const std::wstring& expStr);
+
+        /// <summary>
+        /// For x = x + a + b..., find the + nodes whose right sides can be added onto x where it is
+        /// Returns nothing if the expression is not like that, or if its right sides might use or change x
+        /// </summary>
+        /// <param name="nameLower">The variable being assigned to</param>
+        static std::vector<expression_node_ptr> findAppends(const expression_node_ptr& exp, const std::wstring& nameLower);
+
+        /// <summary>
+        /// Do x = x + a + b..., given the + nodes findAppends() found and the values of their right sides
+        /// A string in x is appended to in place, instead of being copied for each +
+        /// </summary>
+        /// <param name="values">One value for each + node</param>
+        static void addToVariable(symbol_table& symbols, const symbol_ref& symbol, const std::vector<expression_node_ptr>& appends, const object* values);
 
     private: // implementation
+        // Parsing works on views of the expression string,
+        // only the text kept in nodes and values are copied out of it
+        static expression_node_ptr compileNode(std::wstring_view expStr);
+
+        // Turn operations and pure built-in calls on literals into literals
+        static expression_node_ptr foldConstants(const expression_node_ptr& node);
+
         static bool isCharAlphaOpBoundary(wchar_t c);
-        static bool isOperator(const std::wstring& expr, const std::string& op, int n);
-        static int reverseFind(const std::wstring& source, const std::wstring& searchW, int start);
-        static std::vector<std::wstring> parseParameters(const std::wstring& expStr);
+        static bool isOperator(std::wstring_view expr, const std::string& op, int n);
+        static int reverseFind(std::wstring_view source, std::wstring_view searchW, int start);
+        static std::vector<std::wstring_view> parseParameters(std::wstring_view expStr);
         static double getOneDouble(const object::list& paramList, const std::string& function);
 
         // Implement expressions that have function calls
         // This is the core runtime of mscript
-        object::list processParameters(const std::vector<std::wstring>& expStrs);
+        object::list processParameters(const std::vector<expression_node_ptr>& paramNodes);
         object executeFunction(std::wstring functionW, const object::list& paramList);
 
+        // Calls resolved once to their targets skip the lookups executeFunction does by name
+        void resolveCall(const std::wstring& functionW, call_target& target) const;
+        object callTarget(const call_target& target, const std::wstring& functionW, const object::list& paramList);
+
+        // add() and set() called on a variable change the variable in place
+        static bool changesFirstParam(const std::wstring& functionLower);
+        object callChangingVariable(const built_in_function& function, object& variable, const object::list& paramList);
+
+        // Can evaluating this leave the variable be, without reading or changing it
+        static bool leavesVariableBe(const expression_node& node, const std::wstring& nameLower);
+
+        static const std::unordered_map<std::string, built_in_function>& builtInFunctions();
+
     private: // member data
         symbol_table& m_symbols;
         callable& m_callable;
         tracing& m_traceInfo;
         bool m_allowDynamicCalls;
+        expression_cache* m_cache;
     };
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "bytecode.h"
 #include "object.h"
+#include "statements.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,8 +21,14 @@ namespace mscript
 
         std::wstring name;
         std::vector<std::wstring> paramNames;
+        std::vector<symbol_ref> paramSymbols;
 
         int startIndex = -1;
         int endIndex = -1;
+
+        std::shared_ptr<statement_block> body;
+
+        // The body compiled for the bytecode engine
+        std::shared_ptr<bytecode_chunk> code;
     };
 }
@@ -1,35 +1,51 @@
 #include "pch.h"
 #include "lib.h"
 
+#include "callable.h"
 #include "names.h"
+#include "object_binary.h"
 #include "object_json.h"
 #include "utils.h"
 
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <dlfcn.h>
+#endif
+
 namespace mscript
 {
 	std::unordered_map<std::wstring, std::shared_ptr<lib>> lib::s_funcLibs;
 	std::recursive_mutex lib::s_libsMutex;
 
 	lib::lib(const std::wstring& filePath)
-		: m_filePath(filePath)
-		, m_executer(nullptr)
+		: m_module(nullptr)
+		, m_filePath(filePath)
 		, m_freer(nullptr)
-#if defined(_WIN32) || defined(_WIN64)
-		, m_module(nullptr)
-#endif
+		, m_executer(nullptr)
+		, m_binaryFreer(nullptr)
+		, m_binaryExecuter(nullptr)
 	{
 #if defined(_WIN32) || defined(_WIN64)
 		m_module = ::LoadLibrary(m_filePath.c_str());
 		if (m_module == nullptr)
 			raiseWError(L"Loading library failed: " + m_filePath);
+#else
+		// RTLD_LOCAL keeps each module's symbols to itself,
+		// so modules exporting the same mscript_ functions don't step on each other
+		m_module = ::dlopen(toNarrowStr(m_filePath).c_str(), RTLD_NOW | RTLD_LOCAL);
+		if (m_module == nullptr)
+		{
+			const char* error = ::dlerror();
+			raiseWError(L"Loading library failed: " + m_filePath + (error != nullptr ? L" - " + toWideStr(error) : L""));
+		}
+#endif
 
-		m_freer = (FreeStringFunction)::GetProcAddress(m_module, "mscript_FreeString");
+		m_freer = (FreeStringFunction)getProc("mscript_FreeString");
 		if (m_freer == nullptr)
 			raiseWError(L"Getting mscript_FreeString function failed: " + m_filePath);
 
 		std::wstring exports_str;
 		{
-			GetExportsFunction get_exports_func = (GetExportsFunction)::GetProcAddress(m_module, "mscript_GetExports");
+			GetExportsFunction get_exports_func = (GetExportsFunction)getProc("mscript_GetExports");
 			if (get_exports_func == nullptr)
 				raiseWError(L"Getting mscript_GetExports function failed: " + m_filePath);
 
@@ -64,17 +80,37 @@ namespace mscript
 			m_functions.insert(func_name_trimmed);
 		}
 
-		m_executer = (ExecuteExportFunction)::GetProcAddress(m_module, "mscript_ExecuteFunction");
+		m_executer = (ExecuteExportFunction)getProc("mscript_ExecuteFunction");
 		if (m_executer == nullptr)
 			raiseWError(L"Getting mscript_ExecuteFunction function failed: " + m_filePath);
-#endif
+
+		m_binaryExecuter = (ExecuteBinaryExportFunction)getProc("mscript_ExecuteFunction2");
+		m_binaryFreer = (FreeBinaryFunction)getProc("mscript_FreeBinary");
+		if (m_binaryExecuter == nullptr || m_binaryFreer == nullptr)
+		{
+			m_binaryExecuter = nullptr;
+			m_binaryFreer = nullptr;
+		}
 	}
 
 	lib::~lib()
 	{
-#if defined(_WIN32) || defined(_WIN64)
 		if (m_module != nullptr)
+		{
+#if defined(_WIN32) || defined(_WIN64)
 			::FreeLibrary(m_module);
+#else
+			::dlclose(m_module);
+#endif
+		}
+	}
+
+	void* lib::getProc(const char* name) const
+	{
+#if defined(_WIN32) || defined(_WIN64)
+		return (void*)::GetProcAddress(m_module, name);
+#else
+		return ::dlsym(m_module, name);
 #endif
 	}
 
@@ -97,6 +133,7 @@ namespace mscript
 				raiseWError(L"Function '" + funcName + L"' already defined in module '" + existingIt->first + L"'");
 			s_funcLibs.insert({ funcName, ptr });
 		}
+		callable::functionsChanged();
 		
 		return ptr;
 	}
@@ -113,16 +150,41 @@ namespace mscript
 
 	object lib::executeFunction(const std::wstring& name, const object::list& paramList) const
 	{
-		const std::wstring input_json = objectToJson(paramList);
-		wchar_t* output_json_str = m_executer(name.c_str(), input_json.c_str());
-		if (output_json_str == nullptr)
-			raiseWError(L"Executing function failed: " + m_filePath + L" - " + name);
+		object output_obj;
+		if (m_binaryExecuter != nullptr)
+		{
+			const std::vector<unsigned char> input = objectToBinary(paramList);
+			size_t output_length = 0;
+			unsigned char* output = m_binaryExecuter(name.c_str(), input.data(), input.size(), &output_length);
+			if (output == nullptr)
+				raiseWError(L"Executing function failed: " + m_filePath + L" - " + name);
 
-		std::wstring output_json = output_json_str;
-		m_freer(output_json_str);
-		output_json_str = nullptr;
+			try
+			{
+				output_obj = objectFromBinary(output, output_length);
+			}
+			catch (...)
+			{
+				m_binaryFreer(output);
+				throw;
+			}
+			m_binaryFreer(output);
+			output = nullptr;
+		}
+		else
+		{
+			const std::wstring input_json = objectToJson(paramList);
+			wchar_t* output_json_str = m_executer(name.c_str(), input_json.c_str());
+			if (output_json_str == nullptr)
+				raiseWError(L"Executing function failed: " + m_filePath + L" - " + name);
+
+			std::wstring output_json = output_json_str;
+			m_freer(output_json_str);
+			output_json_str = nullptr;
+
+			output_obj = objectFromJson(output_json);
+		}
 
-		object output_obj = objectFromJson(output_json);
 		if (output_obj.type() == object::STRING)
 		{
 			static const std::wstring expPrefix = 
@@ -14,6 +14,8 @@ namespace mscript
 	typedef wchar_t* (*GetExportsFunction)();
 	typedef void (*FreeStringFunction)(wchar_t* str);
 	typedef wchar_t* (*ExecuteExportFunction)(const wchar_t* functionName, const wchar_t* parametersJson);
+	typedef unsigned char* (*ExecuteBinaryExportFunction)(const wchar_t* functionName, const unsigned char* parameters, size_t parametersLength, size_t* outputLength);
+	typedef void (*FreeBinaryFunction)(unsigned char* data);
 
 	class lib
 	{
@@ -28,14 +30,25 @@ namespace mscript
 		static std::shared_ptr<lib> getLib(const std::wstring& name);
 
 	private:
+		/// <summary>
+		/// Get the address of a function exported by the module, nullptr if it's not exported
+		/// </summary>
+		void* getProc(const char* name) const;
+
 #if defined(_WIN32) || defined(_WIN64)
 		HMODULE m_module;
+#else
+		void* m_module; // dlopen handle
 #endif
 		std::wstring m_filePath;
 
 		FreeStringFunction m_freer;
 		ExecuteExportFunction m_executer;
 
+		// Modules that export the binary functions get called with them, not with JSON
+		FreeBinaryFunction m_binaryFreer;
+		ExecuteBinaryExportFunction m_binaryExecuter;
+
 		std::unordered_set<std::wstring> m_functions;
 
 		static std::unordered_map<std::wstring, std::shared_ptr<lib>> s_funcLibs;
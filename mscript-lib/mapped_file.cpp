@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "mapped_file.h"
+#include "utils.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mscript
+{
+    mapped_file::mapped_file(const std::wstring& filePath)
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        m_file = ::CreateFile(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER fileSize;
+        if (!::GetFileSizeEx(m_file, &fileSize))
+            return;
+
+        // Empty files can't be mapped, and there's nothing to map anyway
+        m_size = size_t(fileSize.QuadPart);
+        if (m_size == 0)
+        {
+            m_isOpen = true;
+            return;
+        }
+
+        m_mapping = ::CreateFileMapping(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+            return;
+
+        m_data = static_cast<const char*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_isOpen = m_data != nullptr;
+#else
+        m_file = ::open(toNarrowStr(filePath).c_str(), O_RDONLY);
+        if (m_file < 0)
+            return;
+
+        struct stat fileStat;
+        if (::fstat(m_file, &fileStat) != 0)
+            return;
+
+        m_size = size_t(fileStat.st_size);
+        if (m_size == 0)
+        {
+            m_isOpen = true;
+            return;
+        }
+
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (data == MAP_FAILED)
+            return;
+
+        ::madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(data);
+        m_isOpen = true;
+#endif
+    }
+
+    mapped_file::~mapped_file()
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        if (m_data != nullptr)
+            ::UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr)
+            ::CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            ::CloseHandle(m_file);
+#else
+        if (m_data != nullptr)
+            ::munmap(const_cast<char*>(m_data), m_size);
+        if (m_file >= 0)
+            ::close(m_file);
+#endif
+    }
+
+    bool line_reader::next(std::string_view& line)
+    {
+        if (m_pos >= m_text.size())
+            return false;
+
+        size_t lineFeed = m_text.find('\n', m_pos);
+        if (lineFeed == std::string_view::npos)
+        {
+            line = m_text.substr(m_pos);
+            m_pos = m_text.size();
+        }
+        else
+        {
+            line = m_text.substr(m_pos, lineFeed - m_pos);
+            m_pos = lineFeed + 1;
+        }
+        return true;
+    }
+
+    size_t line_reader::countLines() const
+    {
+        if (m_pos >= m_text.size())
+            return 0;
+
+        size_t count = size_t(std::count(m_text.begin() + m_pos, m_text.end(), '\n'));
+        if (m_text.back() != '\n')
+            ++count;
+        return count;
+    }
+}
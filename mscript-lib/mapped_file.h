@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace mscript
+{
+    /// <summary>
+    /// mapped_file maps a whole file into memory, read-only,
+    /// so it can be decoded and split into lines without reading it into buffers first
+    /// </summary>
+    class mapped_file
+    {
+    public:
+        /// <summary>
+        /// Map the file, check isOpen() to see if that worked
+        /// </summary>
+        mapped_file(const std::wstring& filePath);
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        bool isOpen() const { return m_isOpen; }
+
+        /// <summary>
+        /// The bytes of the file, valid as long as this is around
+        /// </summary>
+        std::string_view view() const { return std::string_view(m_data, m_size); }
+
+    private:
+        bool m_isOpen = false;
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+
+#if defined(_WIN32) || defined(_WIN64)
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#else
+        int m_file = -1;
+#endif
+    };
+
+    /// <summary>
+    /// line_reader walks the lines of text, the way std::getline does,
+    /// handing out views of each line instead of copies
+    /// </summary>
+    class line_reader
+    {
+    public:
+        line_reader(std::string_view text) : m_text(text) {}
+
+        /// <summary>
+        /// Get the next line, without its line feed
+        /// Returns false when there are no more lines
+        /// </summary>
+        bool next(std::string_view& line);
+
+        /// <summary>
+        /// How many lines there are left to read
+        /// </summary>
+        size_t countLines() const;
+
+    private:
+        std::string_view m_text;
+        size_t m_pos = 0;
+    };
+}
@@ -11,7 +11,7 @@ void mscript::validateName(const std::wstring& name)
         raiseWError(L"Names must start with a letter and contain only letters, digits, or underscores: " + name);
 }
 
-bool mscript::isName(const std::wstring& name)
+bool mscript::isName(std::wstring_view name)
 {
     if (name.empty())
         return false;
@@ -1,10 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 namespace mscript
 {
 	void validateName(const std::wstring& name);
-	bool isName(const std::wstring& name);
+	bool isName(std::wstring_view name);
 	bool isReserved(const std::wstring& name);
 }
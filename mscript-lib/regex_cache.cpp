@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "regex_cache.h"
+
+namespace mscript
+{
+    std::shared_ptr<const std::wregex> regex_cache::get(const std::wstring& pattern, std::regex_constants::syntax_option_type flags)
+    {
+        regex_key key{ pattern, flags };
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            const auto& it = m_index.find(key);
+            if (it != m_index.end())
+            {
+                ++m_hits;
+                m_entries.splice(m_entries.begin(), m_entries, it->second);
+                return it->second->second;
+            }
+            ++m_misses;
+        }
+
+        // Compile outside the lock, it's the slow part
+        auto re = std::make_shared<const std::wregex>(pattern, flags);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_index.find(key) == m_index.end())
+        {
+            m_entries.emplace_front(key, re);
+            m_index.insert({ key, m_entries.begin() });
+            while (m_entries.size() > m_capacity)
+            {
+                m_index.erase(m_entries.back().first);
+                m_entries.pop_back();
+            }
+        }
+        return re;
+    }
+
+    size_t regex_cache::size() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+
+    size_t regex_cache::hits() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_hits;
+    }
+
+    size_t regex_cache::misses() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_misses;
+    }
+
+    void regex_cache::clear()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_entries.clear();
+        m_index.clear();
+        m_hits = 0;
+        m_misses = 0;
+    }
+
+    regex_cache& regex_cache::global()
+    {
+        static regex_cache cache;
+        return cache;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <unordered_map>
+
+namespace mscript
+{
+    /// <summary>
+    /// regex_cache holds compiled regular expressions by pattern and flags,
+    /// keeping the most recently used ones up to a fixed count,
+    /// so scripts matching many strings against the same pattern only compile it once
+    /// </summary>
+    class regex_cache
+    {
+    public:
+        regex_cache(size_t capacity = 256) : m_capacity(capacity) {}
+
+        /// <summary>
+        /// Get the compiled form of a pattern, compiling it if it's not cached
+        /// Invalid patterns raise std::regex_error and are not cached
+        /// </summary>
+        std::shared_ptr<const std::wregex> get(const std::wstring& pattern, std::regex_constants::syntax_option_type flags = std::regex_constants::ECMAScript);
+
+        size_t size() const;
+        size_t capacity() const { return m_capacity; }
+
+        size_t hits() const;
+        size_t misses() const;
+
+        void clear();
+
+        /// <summary>
+        /// The cache used by the regular expression built-in functions
+        /// </summary>
+        static regex_cache& global();
+
+    private:
+        struct regex_key
+        {
+            std::wstring pattern;
+            std::regex_constants::syntax_option_type flags;
+
+            bool operator==(const regex_key& other) const
+            {
+                return flags == other.flags && pattern == other.pattern;
+            }
+        };
+
+        struct regex_key_hash
+        {
+            size_t operator()(const regex_key& key) const
+            {
+                return std::hash<std::wstring>()(key.pattern) ^ size_t(key.flags);
+            }
+        };
+
+        // Most recently used first
+        typedef std::list<std::pair<regex_key, std::shared_ptr<const std::wregex>>> entry_list;
+        entry_list m_entries;
+        std::unordered_map<regex_key, entry_list::iterator, regex_key_hash> m_index;
+
+        size_t m_capacity;
+        size_t m_hits = 0;
+        size_t m_misses = 0;
+
+        mutable std::mutex m_mutex;
+    };
+}
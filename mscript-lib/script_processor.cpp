@@ -5,6 +5,7 @@
 #include "syncheck.h"
 #include "names.h"
 #include "lib.h"
+#include "enumerator.h"
 
 #undef min
 #undef max
@@ -27,7 +28,18 @@ namespace mscript
 
         m_linesDb.emplace(newFilename, lines);
 
-        preprocessFunctions(currentFilename, newFilename); // scan for functions first
+        // parse the script into statements once, then run those
+        frame_plan globals;
+        const statement_block& statements =
+            m_statementsDb.emplace(newFilename, compileStatements(lines, 0, int(lines.size()) - 1, globals)).first->second;
+
+        preprocessFunctions(currentFilename, newFilename, globals); // functions are known before the script runs
+
+        if (m_engine == BYTECODE)
+        {
+            const bytecode_chunk& chunk = m_chunksDb.emplace(newFilename, compileBytecode(statements)).first->second;
+            return run(newFilename, chunk, 0U);
+        }
 
         process_outcome outcome;
         object ret_val =
@@ -35,15 +47,14 @@ namespace mscript
             (
                 currentFilename, 
                 newFilename, 
-                0, 
-                int(m_linesDb[newFilename].size()) - 1, 
+                statements, 
                 outcome, 
                 0U
             );
         return ret_val;
     }
 
-    void script_processor::preprocessFunctions(const std::wstring& previousFilename, const std::wstring& filename)
+    void script_processor::preprocessFunctions(const std::wstring& previousFilename, const std::wstring& filename, const frame_plan& globals)
     {
         const std::vector<std::wstring>& lines = m_linesDb[filename];
         int lineCount = int(lines.size());
@@ -104,8 +115,16 @@ namespace mscript
                 function.paramNames = paramList;
                 function.startIndex = loopStart + 1;
                 function.endIndex = loopEnd - 1;
+                // the parameters are the first slots in the function's frame
+                frame_plan plan;
+                plan.names = paramList;
+                function.body = std::make_shared<statement_block>(compileStatements(lines, function.startIndex, function.endIndex, plan, &globals));
+                function.paramSymbols = plan.symbols;
+                if (m_engine == BYTECODE)
+                    function.code = std::make_shared<bytecode_chunk>(compileBytecode(*function.body));
 
                 m_functions.insert({ toLower(name), std::make_shared<script_function>(function) });
+                callable::functionsChanged();
             }
 #ifndef _DEBUG
             catch (const std::exception& exp)
@@ -121,117 +140,73 @@ namespace mscript
     (
         const std::wstring& previousFilename, 
         const std::wstring& filename,
-        int startLine, 
-        int endLine, 
+        const statement_block& statements,
         process_outcome& outcome, 
         unsigned callDepth
     )
     {
         user_exception curException;
-        const std::vector<std::wstring>& lines = m_linesDb[filename];
-        for (int l = startLine; l <= endLine; ++l)
+        const int statementCount = int(statements.size());
+        for (int s = 0; s < statementCount; ++s)
         {
-            std::wstring line = lines[l];
-            if (line.empty()) // skip blank lines
-                continue;
-
-            auto first = line[0];
+            const statement& stmt = statements[s];
 #ifdef CATCH_SCRIPT_EXCEPTIONS
             try
 #endif
             {
-                if (first == '$') // variable declaration, initial value optional
+                switch (stmt.type)
                 {
-                    line = line.substr(1);
-                    size_t equalsIndex = line.find('=');
-                    if (equalsIndex != std::wstring::npos)
-                    {
-                        std::wstring nameStr = trim(line.substr(0, equalsIndex));
-                        validateName(nameStr);
+                case statement::ERROR:
+                    throw *stmt.error;
 
-                        std::wstring valueStr = trim(line.substr(equalsIndex + 1));
-
-                        object answer = evaluate(valueStr, callDepth);
-
-                        m_symbols.set(nameStr, answer);
-                    }
-                    else
+                case statement::DECLARE: // variable declaration, initial value optional
+                {
+                    if (stmt.exp)
                     {
-                        std::wstring nameStr = trim(line);
-                        validateName(nameStr);
-                        m_symbols.set(nameStr, object());
+                        object answer = evaluate(*stmt.exp, callDepth);
+                        m_symbols.set(stmt.symbol, answer);
                     }
+                    else
+                        m_symbols.set(stmt.symbol, object());
+                    break;
                 }
-                else if (first == '&') // variable assignment
-                {
-                    line = line.substr(1);
-                    size_t equalsIndex = line.find('=');
-                    if (equalsIndex == std::wstring::npos)
-                        raiseError("Variable assignment lacks value");
-
-                    std::wstring nameStr = trim(line.substr(0, equalsIndex));
-                    validateName(nameStr);
 
-                    std::wstring valueStr = trim(line.substr(equalsIndex + 1));
-
-                    object answer = evaluate(valueStr, callDepth);
-
-                    m_symbols.assign(nameStr, answer);
-                }
-                else if (first == '*') // assignment or statement that doesn't store return value
+                case statement::ASSIGN: // variable assignment
                 {
-                    line = trim(line.substr(1));
-                    if (line.empty())
-                        raiseError("* lacks expression");
-
-                    bool allow_dynamic_calls = false;
-                    if (line[0] == '*')
+                    if (!stmt.appends.empty()) // & x = x + a + b..., adding onto x where it is
                     {
-                        line = trim(line.substr(1));
-                        if (line.empty())
-                            raiseError("** lacks expression");
-                        allow_dynamic_calls = true;
+                        object::list values;
+                        values.reserve(stmt.appends.size());
+                        for (const auto& add : stmt.appends)
+                            values.push_back(evaluate(*add->children[1], callDepth, stmt.allowDynamicCalls));
+                        expression::addToVariable(m_symbols, stmt.symbol, stmt.appends, values.data());
+                        break;
                     }
-                    
-                    bool assign_worked = false;
-                    size_t equals_idx = line.find('=');
-                    if (equals_idx != std::wstring::npos)
-                    {
-                        std::wstring name_str = trim(line.substr(0, equals_idx));
-                        if (isName(name_str))
-                        {
-                            std::wstring value_str = trim(line.substr(equals_idx + 1));
 
-                            object answer = evaluate(value_str, callDepth, allow_dynamic_calls);
+                    object answer = evaluate(*stmt.exp, callDepth, stmt.allowDynamicCalls);
+                    m_symbols.assign(stmt.symbol, answer);
+                    break;
+                }
 
-                            m_symbols.assign(name_str, answer);
-                            assign_worked = true;
-                        }
-                    }
+                case statement::EVALUATE: // statement that doesn't store return value
+                    evaluate(*stmt.exp, callDepth, stmt.allowDynamicCalls);
+                    break;
 
-                    if (!assign_worked)
-                        evaluate(line, callDepth, allow_dynamic_calls);
-                }
-                else if (first == '!') // exception handler
+                case statement::HANDLER: // exception handler
                 {
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
-
                     if (curException.obj != object::NOTHING)
                     {
-                        std::wstring label = trim(line.substr(1));
-                        validateName(label);
+                        if (stmt.error.has_value())
+                            throw *stmt.error;
 
                         symbol_stacker stacker(m_symbols);
-                        m_symbols.set(label, curException.obj);
+                        m_symbols.set(stmt.symbol, curException.obj);
                         process_outcome ourOutcome;
                         process
                         (
                             previousFilename,
                             filename,
-                            loopStart + 1,
-                            loopEnd - 1,
+                            stmt.body,
                             ourOutcome,
                             callDepth + 1
                         );
@@ -252,13 +227,11 @@ namespace mscript
                             return object();
                         }
                     }
+                    break;
                 }
-                else if (line == L"O") // infinite loop
-                {
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
 
+                case statement::INFINITE_LOOP:
+                {
                     while (true)
                     {
                         symbol_stacker stacker(m_symbols);
@@ -267,8 +240,7 @@ namespace mscript
                         (
                             previousFilename, 
                             filename, 
-                            loopStart + 1, 
-                            loopEnd - 1, 
+                            stmt.body, 
                             ourOutcome, 
                             callDepth + 1
                         );
@@ -283,21 +255,18 @@ namespace mscript
                         else if (ourOutcome.Leave)
                             break;
                     }
+                    break;
                 }
-                else if (first == '{') // braced scope, for variable declaration containment
-                {
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
 
+                case statement::SCOPE: // braced scope, for variable declaration containment
+                {
                     symbol_stacker stacker(m_symbols);
                     process_outcome ourOutcome;
                     process
                     (
                         previousFilename,
                         filename,
-                        loopStart + 1,
-                        loopEnd - 1,
+                        stmt.body,
                         ourOutcome,
                         callDepth + 1
                     );
@@ -317,210 +286,57 @@ namespace mscript
                         outcome.Leave = true;
                         return object();
                     }
+                    break;
                 }
-                else if (line == L"<-") // void return statement
-                {
-                    outcome.Return = true;
-                    return object();
-                }
-                else if (startsWith(line, L"<-")) // valued return statement
+
+                case statement::RETURN:
                 {
-                    std::wstring ret_exp_str = trim(line.substr(2));
-                    if (ret_exp_str.empty())
-                        raiseError("<- statement lacks return value");
-                    outcome.ReturnValue = evaluate(ret_exp_str, callDepth);
+                    if (stmt.exp)
+                        outcome.ReturnValue = evaluate(*stmt.exp, callDepth);
                     outcome.Return = true;
                     return outcome.ReturnValue;
                 }
-                else if (startsWith(line, L"++")) // for x = a; x < b; ++x
-                {
-                    size_t firstSpace = line.find(' ');
-                    if (firstSpace == std::wstring::npos)
-                        raiseError("++ statement missing first space");
-
-                    size_t nextSpace = line.find(' ', firstSpace + 1);
-                    if (nextSpace == std::wstring::npos)
-                        raiseError("++ statement lacks counter variable");
-
-                    std::wstring label = trim(line.substr(firstSpace, nextSpace - firstSpace));
-                    validateName(label);
-
-                    size_t thirdSpace = line.find(' ', nextSpace + 1);
-                    if (thirdSpace == std::wstring::npos)
-                        raiseError("++ statement lacks from part");
-
-                    std::wstring from = trim(line.substr(nextSpace, thirdSpace - nextSpace));
-                    if (from != L":")
-                        raiseError("++ statement invalid : part");
-
-                    std::wstring theRest = line.substr(thirdSpace + 1);
-                    std::wstring fromExpStr, toExpStr;
-                    int parenCount = 0;
-                    bool inString = false;
-                    static int arrowLen = int(strlen(" -> "));
-                    int theRestSize = int(theRest.size());
-                    for (int f = 0; f < theRestSize - arrowLen; ++f)
-                    {
-                        auto c = theRest[f];
-                        if (c == '\"')
-                            inString = !inString;
-
-                        if (!inString)
-                        {
-                            if (c == '(')
-                                ++parenCount;
-                            else if (c == ')')
-                                --parenCount;
-                        }
-
-                        if (!inString && parenCount == 0)
-                        {
-                            if (startsWith(theRest.substr(f), L" -> "))
-                            {
-                                fromExpStr = trim(theRest.substr(0, f));
-                                toExpStr = trim(theRest.substr(f + arrowLen));
-                                break;
-                            }
-                        }
-                    }
-
-                    object fromValue = evaluate(fromExpStr, callDepth);
-                    if (fromValue.type() != object::NUMBER)
-                        raiseWError(L"Invalid from value: " + fromValue.toString());
-
-                    object toValue = evaluate(toExpStr, callDepth);
-                    if (toValue.type() != object::NUMBER)
-                        raiseWError(L"Invalid to value: " + toValue.toString());
-
-                    auto fromIdx = static_cast<int64_t>(fromValue.numberVal());
-                    auto toIdx = static_cast<int64_t>(toValue.numberVal());
-
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
-
-                    {
-                        symbol_stacker outerStacker(m_symbols);
-                        m_symbols.set(label, object());
 
-                        for (auto i = fromIdx; i <= toIdx; ++i)
-                        {
-                            m_symbols.assign(label, double(i));
-                            symbol_stacker innerStacker(m_symbols);
-                            process_outcome ourOutcome;
-                            process
-                            (
-                                previousFilename,
-                                filename,
-                                loopStart + 1,
-                                loopEnd - 1,
-                                ourOutcome,
-                                callDepth + 1
-                            );
-
-                            double end_loop_label_val = m_symbols.get(label).numberVal();
-                            if (end_loop_label_val != double(i))
-                                i = int64_t(end_loop_label_val);
-
-                            if (ourOutcome.Return)
-                            {
-                                outcome = ourOutcome;
-                                return ourOutcome.ReturnValue;
-                            }
-                            else if (ourOutcome.Continue)
-                                continue;
-                            else if (ourOutcome.Leave)
-                                break;
-                        }
-                    }
-                }
-                else if (startsWith(line, L"--")) // for x = a; x >= b; --x
+                case statement::COUNT_UP: // for x = a; x < b; ++x
+                case statement::COUNT_DOWN: // for x = a; x >= b; --x
+                case statement::COUNT: // for x = a to y
                 {
-                    size_t firstSpace = line.find(' ');
-                    if (firstSpace == std::wstring::npos)
-                        raiseError("-- statement missing first space");
-
-                    size_t nextSpace = line.find(' ', firstSpace + 1);
-                    if (nextSpace == std::wstring::npos)
-                        raiseError("-- statement lacks counter variable");
-
-                    std::wstring label = trim(line.substr(firstSpace, nextSpace - firstSpace));
-                    validateName(label);
-
-                    size_t thirdSpace = line.find(' ', nextSpace + 1);
-                    if (thirdSpace == std::wstring::npos)
-                        raiseError("-- statement lacks from part");
-
-                    std::wstring from = trim(line.substr(nextSpace, thirdSpace - nextSpace));
-                    if (from != L":")
-                        raiseError("-- statement invalid : part");
-
-                    std::wstring theRest = line.substr(thirdSpace + 1);
-                    std::wstring fromExpStr, toExpStr;
-                    int parenCount = 0;
-                    bool inString = false;
-                    static int arrowLen = int(strlen(" -> "));
-                    int theRestSize = int(theRest.size());
-                    for (int f = 0; f < theRestSize - arrowLen; ++f)
-                    {
-                        auto c = theRest[f];
-                        if (c == '\"')
-                            inString = !inString;
-
-                        if (!inString)
-                        {
-                            if (c == '(')
-                                ++parenCount;
-                            else if (c == ')')
-                                --parenCount;
-                        }
-
-                        if (!inString && parenCount == 0)
-                        {
-                            if (startsWith(theRest.substr(f), L" -> "))
-                            {
-                                fromExpStr = trim(theRest.substr(0, f));
-                                toExpStr = trim(theRest.substr(f + arrowLen));
-                                break;
-                            }
-                        }
-                    }
-
-                    object fromValue = evaluate(fromExpStr, callDepth);
+                    object fromValue = evaluate(*stmt.exp, callDepth);
                     if (fromValue.type() != object::NUMBER)
                         raiseWError(L"Invalid from value: " + fromValue.toString());
 
-                    object toValue = evaluate(toExpStr, callDepth);
+                    object toValue = evaluate(*stmt.exp2, callDepth);
                     if (toValue.type() != object::NUMBER)
                         raiseWError(L"Invalid to value: " + toValue.toString());
 
                     auto fromIdx = static_cast<int64_t>(fromValue.numberVal());
                     auto toIdx = static_cast<int64_t>(toValue.numberVal());
 
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
+                    bool countUp = 
+                        stmt.type == statement::COUNT_UP 
+                        || 
+                        (stmt.type == statement::COUNT && fromIdx <= toIdx);
+                    int64_t step = countUp ? 1 : -1;
 
                     {
                         symbol_stacker outerStacker(m_symbols);
-                        m_symbols.set(label, object());
+                        m_symbols.set(stmt.symbol, object());
 
-                        for (auto i = fromIdx; i >= toIdx; --i)
+                        for (auto i = fromIdx; countUp ? i <= toIdx : i >= toIdx; i += step)
                         {
-                            m_symbols.assign(label, double(i));
+                            m_symbols.assign(stmt.symbol, double(i));
                             symbol_stacker innerStacker(m_symbols);
                             process_outcome ourOutcome;
                             process
                             (
                                 previousFilename,
                                 filename,
-                                loopStart + 1,
-                                loopEnd - 1,
+                                stmt.body,
                                 ourOutcome,
                                 callDepth + 1
                             );
 
-                            double end_loop_label_val = m_symbols.get(label).numberVal();
+                            double end_loop_label_val = m_symbols.get(stmt.innerSymbol).numberVal();
                             if (end_loop_label_val != double(i))
                                 i = int64_t(end_loop_label_val);
 
@@ -535,72 +351,36 @@ namespace mscript
                                 break;
                         }
                     }
+                    break;
                 }
-                else if (first == '+')
-                {
-                    std::wstring newFilename = trim(line.substr(1));
-                    if (newFilename.empty())
-                        raiseError("import statement has no file name");
 
-                    object filenameObj = evaluate(newFilename, callDepth);
-                    if (filenameObj.type() != object::STRING)
-                        raiseError("import statement does not evaluate as string");
+                case statement::IMPORT:
+                    import(filename, evaluate(*stmt.exp, callDepth));
+                    break;
 
-                    newFilename = trim(filenameObj.stringVal());
-                    if (newFilename.empty())
-                        raiseError("import statement evaluates to an empty string");
-
-                    if (endsWith(newFilename, L".ms"))
-                    {
-                        process(filename, newFilename);
-                    }
-                    else
-                    {
-                        std::wstring moduleFilePath = m_moduleLoader(newFilename);
-                        lib::loadLib(moduleFilePath);
-                    }
-                }
-                else if (first == '?') // if else
+                case statement::IF: // if else
                 {
                     bool seenQuestion = false;
                     bool seenEndingElse = false;
-                    
-                    auto markers = findElses(lines, l, endLine, L"?", L"<>", false);
 
-                    int endMarker = markers.back();
-                    l = endMarker;
-
-                    const int max_markers_idx = int(markers.size()) - 1;
-                    for (int m = 0; m <= max_markers_idx; ++m)
+                    for (const auto& branch : stmt.branches)
                     {
-                        const int marker_line_idx = markers[m];
-                        const std::wstring& marker_line = lines[marker_line_idx];
-                        if (marker_line == L"}")
-                            continue;
-
-                        if (m >= max_markers_idx)
+                        if (branch.type == statement_branch::UNFINISHED)
                             raiseError("No ? or <> at end of statement");
 
-                        int next_marker_line_idx = markers[m + 1];
-                        const std::wstring& next_marker_line = lines[next_marker_line_idx];
-                        if (next_marker_line != L"}")
-                            --next_marker_line_idx;
-
                         object answer;
-                        if (startsWith(marker_line, L"?"))
+                        if (branch.type == statement_branch::CRITERIA)
                         {
                             seenQuestion = true;
 
                             if (seenEndingElse)
                                 raiseError("Already seen <> statement");
 
-                            size_t spaceIndex = marker_line.find(' ');
-                            std::wstring criteria = marker_line.substr(spaceIndex + 1);
-                            answer = evaluate(criteria, callDepth);
+                            answer = evaluate(*branch.criteria, callDepth);
                             if (answer.type() != object::BOOL)
                                 raiseError("? expression does not evaluate to true or false");
                         }
-                        else if (marker_line == L"<>")
+                        else if (branch.type == statement_branch::ELSE)
                         {
                             if (seenEndingElse)
                                 raiseError("Already seen <> statement");
@@ -623,8 +403,7 @@ namespace mscript
                         (
                             previousFilename,
                             filename,
-                            marker_line_idx + 1,
-                            next_marker_line_idx - 1,
+                            branch.body,
                             ourOutcome,
                             callDepth + 1
                         );
@@ -637,53 +416,32 @@ namespace mscript
                             return object();
                         break;
                     }
+                    break;
                 }
-                else if (startsWith(line, L"[]")) // switch
-                {
-                    line = trim(line.substr(2));
-                    if (line.empty())
-                        raiseError("[] statement missing switch value expression");
-
-                    object switch_val = evaluate(line, callDepth);
 
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
+                case statement::SWITCH:
+                {
+                    object switch_val = evaluate(*stmt.exp, callDepth);
 
                     bool seenQuestion = false;
                     bool seenEndingElse = false;
 
-                    auto markers = findElses(lines, loopStart + 1, loopEnd - 1, L"=", L"<>", true);
-
-                    const int max_markers_idx = int(markers.size()) - 1;
-                    for (int m = 0; m <= max_markers_idx; ++m)
+                    for (const auto& branch : stmt.branches)
                     {
-                        const int marker_line_idx = markers[m];
-                        const std::wstring& marker_line = lines[marker_line_idx];
-                        if (marker_line == L"}")
-                            continue;
-
-                        if (m >= max_markers_idx)
+                        if (branch.type == statement_branch::UNFINISHED)
                             raiseError("No = or <> at end of statement");
 
-                        int next_marker_line_idx = markers[m + 1];
-                        const std::wstring& next_marker_line = lines[next_marker_line_idx];
-                        if (next_marker_line != L"}")
-                            --next_marker_line_idx;
-
                         object case_val;
-                        if (startsWith(marker_line, L"="))
+                        if (branch.type == statement_branch::CRITERIA)
                         {
                             seenQuestion = true;
 
                             if (seenEndingElse)
                                 raiseError("Already seen <> statement");
 
-                            size_t spaceIndex = marker_line.find(' ');
-                            std::wstring criteria = marker_line.substr(spaceIndex + 1);
-                            case_val = evaluate(criteria, callDepth);
+                            case_val = evaluate(*branch.criteria, callDepth);
                         }
-                        else if (marker_line == L"<>")
+                        else if (branch.type == statement_branch::ELSE)
                         {
                             if (seenEndingElse)
                                 raiseError("Already seen <> statement");
@@ -704,8 +462,7 @@ namespace mscript
                             (
                                 previousFilename,
                                 filename,
-                                marker_line_idx + 1,
-                                next_marker_line_idx - 1,
+                                branch.body,
                                 ourOutcome,
                                 callDepth + 1
                             );
@@ -714,65 +471,42 @@ namespace mscript
                                 return ourOutcome.ReturnValue;
                             else if (ourOutcome.Continue)
                                 return object();
-                            else if (ourOutcome.Leave)
-                                break;
                             break;
                         }
                     }
+                    break;
                 }
-                else if (first == '@') // for each loop
+
+                case statement::FOR_EACH: // for each loop
                 {
-                    size_t firstSpace = line.find(' ');
-                    if (firstSpace == std::wstring::npos)
-                        raiseError("@ statement lacks loop variable name");
-                    
-                    size_t nextSpace = line.find(' ', firstSpace + 1);
-                    if (nextSpace == std::wstring::npos)
-                        raiseError("@ statement lacks : part");
-
-                    size_t thirdSpace = line.find(' ', nextSpace + 1);
-                    if (thirdSpace == std::wstring::npos)
-                        raiseError("@ statement lacks collection expression");
-
-                    std::wstring label = trim(line.substr(firstSpace, nextSpace - firstSpace));
-                    validateName(label);
-
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
-
-                    std::wstring expression = line.substr(thirdSpace + 1);
-                    object answer = evaluate(expression, callDepth);
-                    object::list enumerable;
+                    enumerator_ptr items;
+                    if (isStreamFileLinesCall(*stmt.exp))
                     {
-                        if (answer.type() == object::STRING)
-                        {
-                            for (auto c : answer.stringVal())
-                                enumerable.push_back(std::wstring{ c });
-                        }
-                        else if (answer.type() == object::LIST)
-                            enumerable = answer.listVal();
-                        else if (answer.type() == object::INDEX)
-                            enumerable = answer.indexVal().keys();
-                        else
-                            raiseError("@ statements only work with strings, lists, and indexes");
+                        object::list paramList;
+                        for (const auto& paramNode : stmt.exp->children)
+                            paramList.push_back(evaluate(*paramNode, callDepth));
+                        items = enumerateFileLines(paramList);
+                        if (!items) // like looping over the null that reading a missing file gives
+                            items = enumerate(object());
                     }
+                    else
+                        items = enumerate(evaluate(*stmt.exp, callDepth));
 
                     {
                         symbol_stacker outerStacker(m_symbols);
-                        m_symbols.set(label, object());
-                        for (object val : enumerable)
+                        m_symbols.set(stmt.symbol, object());
+                        object val;
+                        while (items->next(val))
                         {
                             symbol_stacker innerStacker(m_symbols);
-                            m_symbols.assign(label, val);
+                            m_symbols.assign(stmt.innerSymbol, val);
 
                             process_outcome ourOutcome;
                             process
                             (
                                 previousFilename,
                                 filename,
-                                loopStart + 1,
-                                loopEnd - 1,
+                                stmt.body,
                                 ourOutcome,
                                 callDepth + 1
                             );
@@ -787,290 +521,83 @@ namespace mscript
                                 break;
                         }
                     }
+                    break;
                 }
-                else if (first == '#') // for x = a to y
-                {
-                    size_t firstSpace = line.find(' ');
-                    if (firstSpace == std::wstring::npos)
-                        raiseError("# statement missing first space");
-
-                    size_t nextSpace = line.find(' ', firstSpace + 1);
-                    if (nextSpace == std::wstring::npos)
-                        raiseError("# statement lacks counter variable");
-
-                    std::wstring label = trim(line.substr(firstSpace, nextSpace - firstSpace));
-                    validateName(label);
-
-                    size_t thirdSpace = line.find(' ', nextSpace + 1);
-                    if (thirdSpace == std::wstring::npos)
-                        raiseError("# statement lacks from part");
-
-                    std::wstring from = trim(line.substr(nextSpace, thirdSpace - nextSpace));
-                    if (from != L":")
-                        raiseError("# statement invalid : part");
-
-                    std::wstring theRest = line.substr(thirdSpace + 1);
-                    std::wstring fromExpStr, toExpStr;
-                    int parenCount = 0;
-                    bool inString = false;
-                    static int arrowLen = int(strlen(" -> "));
-                    int theRestSize = int(theRest.size());
-                    for (int f = 0; f < theRestSize - arrowLen; ++f)
-                    {
-                        auto c = theRest[f];
-                        if (c == '\"')
-                            inString = !inString;
-
-                        if (!inString)
-                        {
-                            if (c == '(')
-                                ++parenCount;
-                            else if (c == ')')
-                                --parenCount;
-                        }
 
-                        if (!inString && parenCount == 0)
-                        {
-                            if (startsWith(theRest.substr(f), L" -> "))
-                            {
-                                fromExpStr = trim(theRest.substr(0, f));
-                                toExpStr = trim(theRest.substr(f + arrowLen));
-                                break;
-                            }
-                        }
-                    }
-
-                    object fromValue = evaluate(fromExpStr, callDepth);
-                    if (fromValue.type() != object::NUMBER)
-                        raiseWError(L"Invalid from value: " + fromValue.toString());
-
-                    object toValue = evaluate(toExpStr, callDepth);
-                    if (toValue.type() != object::NUMBER)
-                        raiseWError(L"Invalid to value: " + toValue.toString());
-
-                    auto fromIdx = static_cast<int64_t>(fromValue.numberVal());
-                    auto toIdx = static_cast<int64_t>(toValue.numberVal());
-
-                    int loopEnd = findMatchingEnd(lines, l, endLine);
-                    int loopStart = l;
-                    l = loopEnd;
-
-                    {
-                        symbol_stacker outerStacker(m_symbols);
-                        m_symbols.set(label, object());
-
-                        if (fromIdx <= toIdx)
-                        {
-                            for (auto i = fromIdx; i <= toIdx; ++i)
-                            {
-                                m_symbols.assign(label, double(i));
-                                symbol_stacker innerStacker(m_symbols);
-                                process_outcome ourOutcome;
-                                process
-                                (
-                                    previousFilename,
-                                    filename,
-                                    loopStart + 1,
-                                    loopEnd - 1,
-                                    ourOutcome,
-                                    callDepth + 1
-                                );
-                                
-                                double end_loop_label_val = m_symbols.get(label).numberVal();
-                                if (end_loop_label_val != double(i))
-                                    i = int64_t(end_loop_label_val);
-
-                                if (ourOutcome.Return)
-                                {
-                                    outcome = ourOutcome;
-                                    return ourOutcome.ReturnValue;
-                                }
-                                else if (ourOutcome.Continue)
-                                    continue;
-                                else if (ourOutcome.Leave)
-                                    break;
-                            }
-                        }
-                        else
-                        {
-                            for (auto i = fromIdx; i >= toIdx; --i)
-                            {
-                                m_symbols.assign(label, double(i));
-                                symbol_stacker innerStacker(m_symbols);
-                                process_outcome ourOutcome;
-                                process
-                                (
-                                    previousFilename,
-                                    filename,
-                                    loopStart + 1,
-                                    loopEnd - 1,
-                                    ourOutcome,
-                                    callDepth + 1
-                                );
-
-                                double end_loop_label_val = m_symbols.get(label).numberVal();
-                                if (end_loop_label_val != double(i))
-                                    i = int64_t(end_loop_label_val);
-
-                                if (ourOutcome.Return)
-                                {
-                                    outcome = ourOutcome;
-                                    return ourOutcome.ReturnValue;
-                                }
-                                else if (ourOutcome.Continue)
-                                    continue;
-                                else if (ourOutcome.Leave)
-                                    break;
-                            }
-                        }
-                    }
-                }
-                else if (first == '~') // function declaration, just here to skip it
-                {
+                case statement::FUNCTION: // function declaration, already processed, just skip it
                     if (callDepth != 0)
                         raiseError("Functions cannot defined within anything else");
-                    
-                    // function has already been processed, just skip past it
-                    l = findMatchingEnd(lines, l, endLine);
-                }
-                else if (line == L"^") // continue
-                {
+                    break;
+
+                case statement::CONTINUE:
                     outcome.Continue = true;
                     return object();
-                }
-                else if (line == L"v" || line == L"V") // break
-                {
+
+                case statement::BREAK:
                     outcome.Leave = true;
                     return object();
-                }
-                else if (startsWith(line, L">>>")) // trace output in sections
-                {
-                    static size_t verbLen = strlen(">>>"); // >>> section_label : label_level : msg_expression
-
-                    size_t first_colon = line.find(':');
-                    if (first_colon == std::wstring::npos)
-                        raiseError("Trace statement lacks colon between section and level");
-
-                    std::wstring section_label = trim(line.substr(0, first_colon).substr(verbLen));
-                    if (section_label.empty())
-                        raiseError("Trace statement section is missing");
 
-                    if (m_traceInfo.DoesSectionMatch(section_label))
+                case statement::TRACE: // trace output in sections
+                {
+                    if (m_traceInfo.DoesSectionMatch(stmt.name))
                     {
-                        size_t second_colon = line.find(':', first_colon + 1);
-                        if (second_colon == std::wstring::npos)
-                            raiseError("Trace statement lacks colon between level and message");
-
-                        std::wstring level_str = trim(line.substr(first_colon + 1, second_colon - first_colon - 1));
-                        if (level_str.empty())
-                            raiseError("Trace statement level is missing");
+                        if (!stmt.exp2)
+                            throw *stmt.error;
 
-                        object level_obj = evaluate(level_str, callDepth);
+                        object level_obj = evaluate(*stmt.exp2, callDepth);
                         if (level_obj.type() != object::NUMBER)
                             raiseError("Trace statement level is not number");
 
                         TraceLevel label_level = (TraceLevel)(int)level_obj.numberVal();
                         if (m_traceInfo.DoesLevelMatch(label_level))
                         {
-                            std::wstring msg_exp_str = trim(line.substr(second_colon + 1));
-                            if (msg_exp_str.empty())
-                                raiseError("Trace statement output is missing");
+                            if (!stmt.exp3)
+                                throw *stmt.error;
 
-                            m_output(evaluate(msg_exp_str, callDepth).toString());
+                            m_output(evaluate(*stmt.exp3, callDepth).toString());
                         }
                     }
+                    break;
                 }
-                else // a command line to run...or text to print?
+
+                case statement::PRINT: // single line expression print
                 {
-                    // get set up
-                    std::wstring command_str;
-                    bool is_local_error_suppress = false;
-                    if (startsWith(line, L">>")) // command expression to execute
+                    if (stmt.exp)
                     {
-                        command_str = trim(line.substr(2));
-                        if (command_str.empty())
-                            raiseError("Command for >> statement not provided");
+                        object answer = evaluate(*stmt.exp, callDepth);
+                        m_output(answer.toString());
+                    }
+                    else
+                        m_output(std::wstring());
+                    break;
+                }
 
-                        object command_obj = evaluate(command_str, callDepth);
+                default: // a command line to run
+                {
+                    if (stmt.type == statement::COMMAND_EXP) // command expression to execute
+                    {
+                        object command_obj = evaluate(*stmt.exp, callDepth);
                         if (command_obj.type() != object::STRING)
                             raiseError("Command expression does not result in string");
                         
-                        command_str = command_obj.stringVal();
+                        runCommand(command_obj.stringVal(), false);
                     }
-                    else if (startsWith(line, L">!"))
+                    else if (stmt.type == statement::SUPPRESS)
                     {
-                        line = trim(line.substr(2));
-                        
-                        if (!line.empty())
+                        if (stmt.exp)
                         {
-                            object command_obj = evaluate(line, callDepth);
+                            object command_obj = evaluate(*stmt.exp, callDepth);
                             if (command_obj.type() != object::STRING)
                                 raiseError("Command expression does not result in string");
-                            command_str = command_obj.stringVal();
-                            is_local_error_suppress = true;
+                            runCommand(command_obj.stringVal(), true);
                         }
                         else
                             m_symbols.assign(L"ms_SuppressCommandError", true, true);
                     }
-                    else if (first == '>') // single line expression print
-                    {
-                        std::wstring valueStr = trim(line.substr(1));
-                        if (!valueStr.empty())
-                        {
-                            object answer = evaluate(valueStr, callDepth);
-                            m_output(answer.toString());
-                        }
-                        else
-                            m_output(std::wstring());
-                    }
                     else
-                        command_str = line;
-
-                    if (!command_str.empty())
-                    {
-                        m_symbols.assign(L"ms_LastCommand", command_str, true);
-
-                        // see if we should raise an error if the command fails
-                        bool raise_error = true;
-                        if (is_local_error_suppress)
-                        {
-                            raise_error = false;
-                            m_symbols.assign(L"ms_SuppressCommandError", false, true); // avoid confusion
-                        }
-                        else
-                        {
-                            object suppress_error_obj;
-                            if (m_symbols.tryGet(L"ms_SuppressCommandError", suppress_error_obj))
-                            {
-                                if (suppress_error_obj.boolVal())
-                                {
-                                    raise_error = false;
-                                    m_symbols.assign(L"ms_SuppressCommandError", false, true);
-                                }
-                            }
-                        }
-
-                        // initialize the exit code local variable
-                        m_symbols.assign(L"ms_ErrorLevel", double(-1), true);
-
-                        // do the deed
-                        double exit_code = double(_wsystem(command_str.c_str()));
-
-                        // set the command results into local variables
-                        m_symbols.assign(L"ms_ErrorLevel", exit_code, true);
-
-                        // raise hell if that didn't work out...if the user wants to
-                        // NOTE: store off all the command info as the code that handles the error 
-                        //       may be distant from these local variables
-                        if (raise_error && exit_code != 0)
-                        {
-                            object::index error_idx;
-                            error_idx.set(std::wstring(L"Error"), std::wstring(L"Command failed with exit code " + num2wstr(exit_code)));
-                            error_idx.set(std::wstring(L"Command"), command_str);
-                            error_idx.set(std::wstring(L"ErrorLevel"), double(exit_code));
-                            throw mscript::user_exception(error_idx);
-                        }
-                    }
+                        runCommand(stmt.line, false);
+                    break;
+                }
                 }
 
                 curException.obj = object();
@@ -1088,26 +615,20 @@ namespace mscript
                 if (curException.filename.empty())
                 {
                     curException.filename = filename;
-                    curException.lineNumber = l + 1;
-                    curException.line = line;
+                    curException.lineNumber = stmt.lineIndex + 1;
+                    curException.line = stmt.line;
                 }
 
+                // look for a handler, nested blocks are already skipped over
                 bool foundHandler = false;
-                while (++l < endLine)
+                while (++s < statementCount)
                 {
-                    if (lines[l][0] == '!')
+                    if (statements[s].type == statement::HANDLER)
                     {
-                        --l;
+                        --s;
                         foundHandler = true;
                         break;
                     }
-                    // skip starts of other blocks, no rabbit holes
-                    else if (isLineBlockBegin(lines[l])) 
-                    {
-                        int block_end = findMatchingEnd(lines, l, endLine);
-                        if (block_end >= 0)
-                            l = std::min(block_end, endLine - 1);
-                    }
                 }
                 if (foundHandler)
                     continue;
@@ -1118,24 +639,93 @@ namespace mscript
 #ifndef _DEBUG
             catch (const std::exception& exp)
             {
-                handleException(exp, filename, line, l);
+                handleException(exp, filename, stmt.line, stmt.lineIndex);
             }
 #endif
         }
         return object();
     }
 
+    void script_processor::import(const std::wstring& filename, const object& filenameObj)
+    {
+        if (filenameObj.type() != object::STRING)
+            raiseError("import statement does not evaluate as string");
+
+        std::wstring newFilename = trim(filenameObj.stringVal());
+        if (newFilename.empty())
+            raiseError("import statement evaluates to an empty string");
+
+        if (endsWith(newFilename, L".ms"))
+        {
+            process(filename, newFilename);
+        }
+        else
+        {
+            std::wstring moduleFilePath = m_moduleLoader(newFilename);
+            lib::loadLib(moduleFilePath);
+        }
+    }
+
+    void script_processor::runCommand(const std::wstring& command_str, bool is_local_error_suppress)
+    {
+        if (!command_str.empty())
+        {
+            m_symbols.assign(L"ms_LastCommand", command_str, true);
+
+            // see if we should raise an error if the command fails
+            bool raise_error = true;
+            if (is_local_error_suppress)
+            {
+                raise_error = false;
+                m_symbols.assign(L"ms_SuppressCommandError", false, true); // avoid confusion
+            }
+            else
+            {
+                object suppress_error_obj;
+                if (m_symbols.tryGet(L"ms_SuppressCommandError", suppress_error_obj))
+                {
+                    if (suppress_error_obj.boolVal())
+                    {
+                        raise_error = false;
+                        m_symbols.assign(L"ms_SuppressCommandError", false, true);
+                    }
+                }
+            }
+
+            // initialize the exit code local variable
+            m_symbols.assign(L"ms_ErrorLevel", double(-1), true);
+
+            // do the deed
+            double exit_code = double(_wsystem(command_str.c_str()));
+
+            // set the command results into local variables
+            m_symbols.assign(L"ms_ErrorLevel", exit_code, true);
+
+            // raise hell if that didn't work out...if the user wants to
+            // NOTE: store off all the command info as the code that handles the error 
+            //       may be distant from these local variables
+            if (raise_error && exit_code != 0)
+            {
+                object::index error_idx;
+                error_idx.set(std::wstring(L"Error"), std::wstring(L"Command failed with exit code " + num2wstr(exit_code)));
+                error_idx.set(std::wstring(L"Command"), command_str);
+                error_idx.set(std::wstring(L"ErrorLevel"), double(exit_code));
+                throw mscript::user_exception(error_idx);
+            }
+        }
+    }
+
     void script_processor::handleException(const std::exception& exp, const std::wstring& filename, const std::wstring& line, int l)
     {
         throw script_exception(exp.what(), filename, l, line);
     }
 
-    object script_processor::evaluate(const std::wstring& valueStr, unsigned callDepth, bool allowDynamicCalls)
+    object script_processor::evaluate(const expression_node& node, unsigned callDepth, bool allowDynamicCalls)
     {
         m_tempCallDepth = callDepth;
 
-        expression exp(m_symbols, *this, m_traceInfo, allowDynamicCalls);
-        object answer = exp.evaluate(valueStr);
+        expression exp(m_symbols, *this, m_traceInfo, allowDynamicCalls, &m_expCache);
+        object answer = exp.evaluate(node);
         return answer;
     }
 
@@ -1159,24 +749,36 @@ namespace mscript
         if (funcIt == m_functions.end())
             raiseWError(L"Unknown function: " + name);
 
-        auto func = funcIt->second;
-        if (parameters.size() != func->paramNames.size())
-            raiseWError(L"Function " + name + L" takes " + num2wstr(double(func->paramNames.size())) + L" parameters");
+        return callScriptFunction(*funcIt->second, parameters);
+    }
+
+    std::shared_ptr<script_function> script_processor::findFunction(const std::wstring& nameLower) const
+    {
+        const auto& funcIt = m_functions.find(nameLower);
+        return funcIt == m_functions.end() ? nullptr : funcIt->second;
+    }
+
+    object script_processor::callScriptFunction(const script_function& function, const object::list& parameters)
+    {
+        if (parameters.size() != function.paramNames.size())
+            raiseWError(L"Function " + function.name + L" takes " + num2wstr(double(function.paramNames.size())) + L" parameters");
 
         symbol_smacker smacker(m_symbols);
         {
             symbol_stacker stacker(m_symbols);
-            for (size_t p = 0; p < func->paramNames.size(); ++p)
-                m_symbols.set(func->paramNames[p], parameters[p]);
+            for (size_t p = 0; p < function.paramNames.size(); ++p)
+                m_symbols.set(function.paramSymbols[p], parameters[p]);
+
+            if (function.code)
+                return run(function.filename, *function.code, m_tempCallDepth + 1);
 
             process_outcome outcome;
             object returnValue =
                 process
                 (
-                    func->previousFilename,
-                    func->filename,
-                    func->startIndex,
-                    func->endIndex,
+                    function.previousFilename,
+                    function.filename,
+                    *function.body,
                     outcome,
                     m_tempCallDepth + 1
                 );
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "bytecode.h"
 #include "expressions.h"
 #include "functions.h"
 #include "object.h"
+#include "statements.h"
 #include "symbols.h"
 #include "script_exception.h"
 #include "tracing.h"
@@ -46,6 +48,20 @@ namespace mscript
         , m_output(output)
         {}
 
+        /// <summary>
+        /// How scripts get run
+        /// </summary>
+        enum execution_engine
+        {
+            TREE_WALKER,    // walk the compiled statements and expressions
+            BYTECODE        // compile the statements and expressions into bytecode and run that
+        };
+
+        /// <summary>
+        /// Choose how scripts are run, before processing them
+        /// </summary>
+        void setEngine(execution_engine engine) { m_engine = engine; }
+
         /// <summary>
         /// Process an entire script
         /// </summary>
@@ -54,6 +70,8 @@ namespace mscript
         // Callable implementation
         virtual bool hasFunction(const std::wstring& name) const;
         virtual object callFunction(const std::wstring& name, const object::list& parameters);
+        virtual std::shared_ptr<script_function> findFunction(const std::wstring& nameLower) const;
+        virtual object callScriptFunction(const script_function& function, const object::list& parameters);
 
     private:
         /// <summary>
@@ -71,30 +89,45 @@ namespace mscript
         /// <summary>
         /// Process a section of the script, yielding an outcome
         /// </summary>
-        /// <param name="startLine">What line of the script to start on?</param>
-        /// <param name="endLine">What line of the script to end with?</param>
+        /// <param name="statements">The compiled statements to process</param>
         /// <param name="outcome">Outcome object filled in by processing the script</param>
         /// <returns>Return value from a function call</returns>
         object process
         (
             const std::wstring& previousFilename,
             const std::wstring& filename,
-            int startLine,
-            int endLine, 
+            const statement_block& statements,
             process_outcome& outcome, 
             unsigned callDepth
         );
         
-        void preprocessFunctions(const std::wstring& previousFilename, const std::wstring& filename);
+        /// <summary>
+        /// Run a compiled script or function body in the virtual machine
+        /// </summary>
+        object run(const std::wstring& filename, const bytecode_chunk& chunk, unsigned callDepth);
+
+        void preprocessFunctions(const std::wstring& previousFilename, const std::wstring& filename, const frame_plan& globals);
+
+        void import(const std::wstring& filename, const object& filenameObj);
+        void runCommand(const std::wstring& command_str, bool is_local_error_suppress);
 
         void handleException(const std::exception& exp, const std::wstring& filename, const std::wstring& line, int l);
-        object evaluate(const std::wstring& valueStr, unsigned callDepth, bool allowDynamicCalls = false);
+        object evaluate(const expression_node& node, unsigned callDepth, bool allowDynamicCalls = false);
 
     private:
         std::function<std::vector<std::wstring>(const std::wstring& current, const std::wstring& filename)> m_scriptLoader;
         std::function<std::wstring(const std::wstring& filename)> m_moduleLoader;
 
         std::unordered_map<std::wstring, std::vector<std::wstring>> m_linesDb;
+        std::unordered_map<std::wstring, statement_block> m_statementsDb;
+        std::unordered_map<std::wstring, bytecode_chunk> m_chunksDb;
+
+        execution_engine m_engine = TREE_WALKER;
+
+        // The virtual machine's stacks, shared by the runs of nested function calls
+        std::vector<object> m_vmStack;
+        std::vector<vm_block> m_vmBlocks;
+        std::vector<vm_loop> m_vmLoops;
 
         symbol_table& m_symbols;
         std::unordered_map<std::wstring, std::shared_ptr<script_function>> m_functions;
@@ -105,5 +138,7 @@ namespace mscript
         std::function<void(const std::wstring& text)> m_output;
 
         tracing m_traceInfo;
+
+        expression_cache m_expCache;
     };
 }
@@ -0,0 +1,629 @@
+#include "pch.h"
+#include "script_processor.h"
+#include "bytecode.h"
+#include "utils.h"
+
+#undef min
+#undef max
+
+// DEBUG
+#define CATCH_SCRIPT_EXCEPTIONS
+
+namespace mscript
+{
+    /// <summary>
+    /// vm_unwinder puts the shared stacks back to where a run started,
+    /// however the run ends
+    /// </summary>
+    class vm_unwinder
+    {
+    public:
+        vm_unwinder(std::vector<object>& stack, std::vector<vm_block>& blocks, std::vector<vm_loop>& loops)
+            : m_stack(stack)
+            , m_blocks(blocks)
+            , m_loops(loops)
+            , m_stackSize(stack.size())
+            , m_blockCount(blocks.size())
+            , m_loopCount(loops.size())
+        {}
+
+        ~vm_unwinder()
+        {
+            if (m_stack.size() > m_stackSize)
+                m_stack.resize(m_stackSize);
+            if (m_blocks.size() > m_blockCount)
+                m_blocks.resize(m_blockCount);
+            if (m_loops.size() > m_loopCount)
+                m_loops.resize(m_loopCount);
+        }
+
+    private:
+        std::vector<object>& m_stack;
+        std::vector<vm_block>& m_blocks;
+        std::vector<vm_loop>& m_loops;
+
+        size_t m_stackSize;
+        size_t m_blockCount;
+        size_t m_loopCount;
+    };
+
+    object script_processor::run(const std::wstring& filename, const bytecode_chunk& chunk, unsigned callDepth)
+    {
+        const instruction* code = chunk.code.data();
+        const int entryFrameCount = m_symbols.frameCount();
+
+        expression exp(m_symbols, *this, m_traceInfo, false, &m_expCache);
+        expression dynamicExp(m_symbols, *this, m_traceInfo, true, &m_expCache);
+
+        // Nested runs for function calls share the stacks, each working above where it started
+        std::vector<object>& stack = m_vmStack;
+        std::vector<vm_block>& blocks = m_vmBlocks;
+        std::vector<vm_loop>& loops = m_vmLoops;
+        const size_t blocksBase = blocks.size();
+        vm_unwinder unwinder(stack, blocks, loops);
+        vm_block done; // the outcome of the last block to end
+
+        auto pop = [&stack]() -> object
+        {
+            object value = std::move(stack.back());
+            stack.pop_back();
+            return value;
+        };
+
+        // Blocks usually end with everything already put back, so only shrink what grew
+        auto restore = [&](const vm_block& block)
+        {
+            while (m_symbols.frameCount() > block.frameCount)
+                m_symbols.popFrame();
+            if (stack.size() > block.stackSize)
+                stack.resize(block.stackSize);
+            if (loops.size() > block.loopCount)
+                loops.resize(block.loopCount);
+        };
+
+        auto endPc = [&]() -> int
+        {
+            return chunk.blocks[blocks.back().blockId].endPc;
+        };
+
+        int pc = 0;
+        while (true)
+        {
+#ifdef CATCH_SCRIPT_EXCEPTIONS
+            try
+#endif
+            {
+                while (true)
+                {
+                    const instruction& instr = code[pc++];
+                    switch (instr.op)
+                    {
+                    //
+                    // Expressions
+                    //
+                    case instruction::PUSH_VALUE:
+                        stack.push_back(instr.node->value);
+                        break;
+
+                    case instruction::PUSH_VARIABLE:
+                    {
+                        object value;
+                        if (!m_symbols.tryGet(instr.node->symbol, value))
+                            raiseWError(L"Unknown variable name: " + instr.node->text);
+                        stack.push_back(std::move(value));
+                        break;
+                    }
+
+                    case instruction::NEGATE:
+                        stack.back() = -stack.back().numberVal();
+                        break;
+
+                    case instruction::NOT:
+                        stack.back() = !stack.back().boolVal();
+                        break;
+
+                    case instruction::BINARY_OP:
+                    {
+                        object rightVal = pop();
+                        stack.back() = expression::evaluateBinaryOp(instr.node->op, stack.back(), rightVal, instr.node->text);
+                        break;
+                    }
+
+                    case instruction::AND:
+                        if (!stack.back().boolVal())
+                        {
+                            stack.back() = false;
+                            pc = instr.arg;
+                        }
+                        break;
+
+                    case instruction::OR:
+                        if (stack.back().boolVal())
+                        {
+                            stack.back() = true;
+                            pc = instr.arg;
+                        }
+                        break;
+
+                    case instruction::CALL:
+                    case instruction::CALL_DYNAMIC:
+                    {
+                        object::list paramList
+                        (
+                            std::make_move_iterator(stack.end() - instr.arg),
+                            std::make_move_iterator(stack.end())
+                        );
+                        stack.resize(stack.size() - instr.arg);
+
+                        expression& callExp = instr.op == instruction::CALL ? exp : dynamicExp;
+                        object answer = callExp.call(*instr.node, paramList);
+                        stack.push_back(std::move(answer));
+                        break;
+                    }
+
+                    case instruction::GROUP:
+                    {
+                        object first = std::move(stack[stack.size() - instr.arg]);
+                        stack.resize(stack.size() - instr.arg);
+                        stack.push_back(std::move(first));
+                        break;
+                    }
+
+                    case instruction::THROW_VALUE:
+                        throw user_exception(instr.node->value);
+
+                    case instruction::POP:
+                        stack.pop_back();
+                        break;
+
+                    //
+                    // Blocks
+                    //
+                    case instruction::BEGIN_BLOCK:
+                    {
+                        vm_block& block = blocks.emplace_back();
+                        block.blockId = instr.arg;
+                        block.frameCount = m_symbols.frameCount();
+                        block.stackSize = stack.size();
+                        block.loopCount = loops.size();
+                        break;
+                    }
+
+                    case instruction::END_BLOCK:
+                    {
+                        restore(blocks.back());
+                        done = std::move(blocks.back());
+                        blocks.pop_back();
+                        if (blocks.size() == blocksBase)
+                            return done.Return ? done.ReturnValue : object();
+                        break;
+                    }
+
+                    case instruction::STATEMENT:
+                    {
+                        vm_block& block = blocks.back();
+                        block.current = instr.arg;
+                        if (block.curException)
+                            block.curException.reset();
+                        m_tempCallDepth = callDepth + unsigned(blocks.size() - blocksBase) - 1;
+                        break;
+                    }
+
+                    case instruction::PUSH_FRAME:
+                        m_symbols.pushFrame();
+                        break;
+
+                    case instruction::POP_FRAME:
+                        m_symbols.popFrame();
+                        break;
+
+                    case instruction::JUMP:
+                        pc = instr.arg;
+                        break;
+
+                    //
+                    // Statements
+                    //
+                    case instruction::THROW_ERROR:
+                        throw *instr.stmt->error;
+
+                    case instruction::RAISE:
+                        raiseWError(chunk.messages[instr.arg]);
+
+                    case instruction::SET:
+                        m_symbols.set(instr.stmt->symbol, pop());
+                        break;
+
+                    case instruction::SET_NULL:
+                        m_symbols.set(instr.stmt->symbol, object());
+                        break;
+
+                    case instruction::ASSIGN:
+                        m_symbols.assign(instr.stmt->symbol, pop());
+                        break;
+
+                    case instruction::APPEND:
+                    {
+                        size_t valuesStart = stack.size() - instr.arg;
+                        expression::addToVariable(m_symbols, instr.stmt->symbol, instr.stmt->appends, stack.data() + valuesStart);
+                        stack.resize(valuesStart);
+                        break;
+                    }
+
+                    case instruction::HANDLER:
+                        if (!blocks.back().isHandling())
+                            pc = instr.arg;
+                        else if (instr.stmt->error.has_value())
+                            throw *instr.stmt->error;
+                        break;
+
+                    case instruction::SET_EXCEPTION:
+                        m_symbols.set(instr.stmt->symbol, blocks.back().curException->obj);
+                        break;
+
+                    case instruction::PROPAGATE:
+                    {
+                        vm_block& block = blocks.back();
+                        if (done.Return)
+                        {
+                            block.Return = true;
+                            block.ReturnValue = done.ReturnValue;
+                            pc = endPc();
+                        }
+                        else if (done.Continue)
+                        {
+                            block.Continue = true;
+                            pc = endPc();
+                        }
+                        else if (done.Leave)
+                        {
+                            block.Leave = true;
+                            pc = endPc();
+                        }
+                        break;
+                    }
+
+                    case instruction::IF_TEST:
+                    {
+                        object answer = pop();
+                        if (answer.type() != object::BOOL)
+                            raiseError("? expression does not evaluate to true or false");
+                        if (!answer.boolVal())
+                            pc = instr.arg;
+                        break;
+                    }
+
+                    case instruction::IF_END:
+                    {
+                        vm_block& block = blocks.back();
+                        block.Return = done.Return;
+                        block.Continue = done.Continue;
+                        block.Leave = done.Leave;
+                        block.ReturnValue = done.ReturnValue;
+                        pc = block.Return || block.Continue || block.Leave ? endPc() : instr.arg;
+                        break;
+                    }
+
+                    case instruction::CASE_TEST:
+                    {
+                        object caseVal = pop();
+                        if (!(caseVal == stack.back()))
+                            pc = instr.arg;
+                        break;
+                    }
+
+                    case instruction::SWITCH_END:
+                    {
+                        vm_block& block = blocks.back();
+                        block.Return = done.Return;
+                        block.Continue = done.Continue;
+                        block.Leave = done.Leave;
+                        block.ReturnValue = done.ReturnValue;
+                        pc = block.Return || block.Continue ? endPc() : instr.arg;
+                        break;
+                    }
+
+                    case instruction::LOOP_END:
+                        if (done.Return)
+                        {
+                            vm_block& block = blocks.back();
+                            block.Return = true;
+                            block.ReturnValue = done.ReturnValue;
+                            pc = endPc();
+                        }
+                        else if (done.Leave && !done.Continue)
+                            pc = instr.arg2;
+                        else
+                            pc = instr.arg;
+                        break;
+
+                    case instruction::CHECK_FROM:
+                        if (stack.back().type() != object::NUMBER)
+                            raiseWError(L"Invalid from value: " + stack.back().toString());
+                        break;
+
+                    case instruction::CHECK_TO:
+                        if (stack.back().type() != object::NUMBER)
+                            raiseWError(L"Invalid to value: " + stack.back().toString());
+                        break;
+
+                    case instruction::COUNT_BEGIN:
+                    {
+                        object toValue = pop();
+                        object fromValue = pop();
+
+                        vm_loop loop;
+                        loop.index = static_cast<int64_t>(fromValue.numberVal());
+                        loop.to = static_cast<int64_t>(toValue.numberVal());
+                        loop.countUp =
+                            instr.stmt->type == statement::COUNT_UP
+                            ||
+                            (instr.stmt->type == statement::COUNT && loop.index <= loop.to);
+                        loop.step = loop.countUp ? 1 : -1;
+                        loops.push_back(std::move(loop));
+
+                        m_symbols.pushFrame();
+                        m_symbols.set(instr.stmt->symbol, object());
+                        break;
+                    }
+
+                    case instruction::COUNT_TEST:
+                    {
+                        const vm_loop& loop = loops.back();
+                        if (loop.countUp ? loop.index <= loop.to : loop.index >= loop.to)
+                            m_symbols.assign(instr.stmt->symbol, double(loop.index));
+                        else
+                            pc = instr.arg;
+                        break;
+                    }
+
+                    case instruction::COUNT_NEXT:
+                    {
+                        vm_loop& loop = loops.back();
+                        double end_loop_label_val = m_symbols.get(instr.stmt->innerSymbol).numberVal();
+                        m_symbols.popFrame();
+                        if (end_loop_label_val != double(loop.index))
+                            loop.index = int64_t(end_loop_label_val);
+
+                        if (done.Return)
+                        {
+                            vm_block& block = blocks.back();
+                            block.Return = true;
+                            block.Continue = done.Continue;
+                            block.Leave = done.Leave;
+                            block.ReturnValue = done.ReturnValue;
+                            pc = endPc();
+                        }
+                        else if (done.Leave && !done.Continue)
+                            pc = instr.arg2;
+                        else
+                        {
+                            loop.index += loop.step;
+                            pc = instr.arg;
+                        }
+                        break;
+                    }
+
+                    case instruction::FOR_EACH_BEGIN:
+                    {
+                        vm_loop loop;
+                        loop.items = enumerate(pop());
+                        loops.push_back(std::move(loop));
+
+                        m_symbols.pushFrame();
+                        m_symbols.set(instr.stmt->symbol, object());
+                        break;
+                    }
+
+                    case instruction::FOR_EACH_LINES:
+                    {
+                        object::list paramList
+                        (
+                            std::make_move_iterator(stack.end() - instr.arg),
+                            std::make_move_iterator(stack.end())
+                        );
+                        stack.resize(stack.size() - instr.arg);
+
+                        vm_loop loop;
+                        loop.items = enumerateFileLines(paramList);
+                        if (!loop.items) // like looping over the null that reading a missing file gives
+                            loop.items = enumerate(object());
+                        loops.push_back(std::move(loop));
+
+                        m_symbols.pushFrame();
+                        m_symbols.set(instr.stmt->symbol, object());
+                        break;
+                    }
+
+                    case instruction::FOR_EACH_NEXT:
+                    {
+                        object value;
+                        if (!loops.back().items->next(value))
+                        {
+                            pc = instr.arg;
+                            break;
+                        }
+
+                        m_symbols.pushFrame();
+                        m_symbols.assign(instr.stmt->innerSymbol, value);
+                        break;
+                    }
+
+                    case instruction::FOR_EACH_END:
+                        if (done.Return)
+                        {
+                            vm_block& block = blocks.back();
+                            block.Return = true;
+                            block.Continue = done.Continue;
+                            block.Leave = done.Leave;
+                            block.ReturnValue = done.ReturnValue;
+                            pc = endPc();
+                        }
+                        else if (done.Leave && !done.Continue)
+                            pc = instr.arg2;
+                        else
+                            pc = instr.arg;
+                        break;
+
+                    case instruction::LOOP_POP:
+                        loops.pop_back();
+                        m_symbols.popFrame();
+                        break;
+
+                    case instruction::FUNCTION:
+                        if (callDepth + blocks.size() - blocksBase - 1 != 0)
+                            raiseError("Functions cannot defined within anything else");
+                        break;
+
+                    case instruction::CONTINUE:
+                        blocks.back().Continue = true;
+                        pc = endPc();
+                        break;
+
+                    case instruction::BREAK:
+                        blocks.back().Leave = true;
+                        pc = endPc();
+                        break;
+
+                    case instruction::RETURN:
+                    {
+                        vm_block& block = blocks.back();
+                        if (instr.arg)
+                            block.ReturnValue = pop();
+                        block.Return = true;
+                        pc = endPc();
+                        break;
+                    }
+
+                    case instruction::TRACE_SECTION:
+                        if (!m_traceInfo.DoesSectionMatch(instr.stmt->name))
+                            pc = instr.arg;
+                        else if (!instr.stmt->exp2)
+                            throw *instr.stmt->error;
+                        break;
+
+                    case instruction::TRACE_LEVEL:
+                    {
+                        object level_obj = pop();
+                        if (level_obj.type() != object::NUMBER)
+                            raiseError("Trace statement level is not number");
+
+                        TraceLevel label_level = (TraceLevel)(int)level_obj.numberVal();
+                        if (!m_traceInfo.DoesLevelMatch(label_level))
+                            pc = instr.arg;
+                        else if (!instr.stmt->exp3)
+                            throw *instr.stmt->error;
+                        break;
+                    }
+
+                    case instruction::PRINT:
+                        m_output(pop().toString());
+                        break;
+
+                    case instruction::PRINT_EMPTY:
+                        m_output(std::wstring());
+                        break;
+
+                    case instruction::COMMAND:
+                        runCommand(instr.stmt->line, false);
+                        break;
+
+                    case instruction::COMMAND_EXP:
+                    case instruction::SUPPRESS:
+                    {
+                        object command_obj = pop();
+                        if (command_obj.type() != object::STRING)
+                            raiseError("Command expression does not result in string");
+                        runCommand(command_obj.stringVal(), instr.op == instruction::SUPPRESS);
+                        break;
+                    }
+
+                    case instruction::SUPPRESS_NEXT:
+                        m_symbols.assign(L"ms_SuppressCommandError", true, true);
+                        break;
+
+                    case instruction::IMPORT:
+                        import(filename, pop());
+                        break;
+
+                    default:
+                        raiseError("Invalid instruction: " + num2str(int(instr.op)));
+                    }
+                }
+            }
+#ifdef CATCH_SCRIPT_EXCEPTIONS
+            catch (const user_exception& userExp)
+            {
+                // Like the tree walker, each block looks for a handler after the statement that raised,
+                // and raises to the block around it if there is none
+                user_exception curException = userExp;
+                bool foundHandler = false;
+                while (!curException.isSyntaxError && blocks.size() > blocksBase)
+                {
+                    vm_block& block = blocks.back();
+                    restore(block);
+
+                    if (block.isHandling())
+                    {
+                        curException = *block.curException;
+                        blocks.pop_back();
+                        continue;
+                    }
+
+                    const bytecode_block& blockCode = chunk.blocks[block.blockId];
+                    block.curException = std::make_unique<user_exception>(curException);
+                    if (block.curException->filename.empty() && block.current >= 0)
+                    {
+                        const statement& stmt = (*blockCode.statements)[block.current];
+                        block.curException->filename = filename;
+                        block.curException->lineNumber = stmt.lineIndex + 1;
+                        block.curException->line = stmt.line;
+                    }
+
+                    for (const auto& handler : blockCode.handlers)
+                    {
+                        if (handler.first > block.current)
+                        {
+                            block.current = handler.first;
+                            pc = handler.second;
+                            foundHandler = true;
+                            break;
+                        }
+                    }
+                    if (foundHandler)
+                        break;
+
+                    curException = *block.curException;
+                    blocks.pop_back();
+                }
+
+                if (!foundHandler)
+                {
+                    while (m_symbols.frameCount() > entryFrameCount)
+                        m_symbols.popFrame();
+                    throw curException;
+                }
+            }
+#endif
+#ifndef _DEBUG
+            catch (const std::exception& exp)
+            {
+                // The outermost block has the last word on where the error happened
+                std::wstring line;
+                int lineIndex = -1;
+                if (blocks.size() > blocksBase && blocks[blocksBase].current >= 0)
+                {
+                    const vm_block& outer = blocks[blocksBase];
+                    const statement& stmt = (*chunk.blocks[outer.blockId].statements)[outer.current];
+                    line = stmt.line;
+                    lineIndex = stmt.lineIndex;
+                }
+
+                while (m_symbols.frameCount() > entryFrameCount)
+                    m_symbols.popFrame();
+                handleException(exp, filename, line, lineIndex);
+            }
+#endif
+        }
+    }
+}
@@ -0,0 +1,594 @@
+#include "pch.h"
+#include "statements.h"
+#include "expressions.h"
+#include "script_utils.h"
+#include "names.h"
+#include "utils.h"
+
+#include <atomic>
+
+namespace mscript
+{
+    /// <summary>
+    /// Every compiled frame gets its own ID, so slots are only used in frames
+    /// that have that frame's variables, not in ones that happen to line up
+    /// </summary>
+    static int newFrameId()
+    {
+        static std::atomic<int> lastFrameId(0);
+        return ++lastFrameId;
+    }
+
+    /// <summary>
+    /// compile_scope tracks the variables set in one stack frame as the statements
+    /// for that frame are compiled, in the order the variables get their slots
+    /// </summary>
+    struct compile_scope
+    {
+        compile_scope(const compile_scope* _parent) : parent(_parent), frameId(newFrameId()) {}
+
+        const compile_scope* parent;
+        int frameId;
+        bool global = false;
+        std::vector<std::wstring> names;
+    };
+
+    static statement_block compileStatements(const std::vector<std::wstring>& lines, int startLine, int endLine, compile_scope& scope);
+
+    /// <summary>
+    /// Give a new variable the next slot in the frame
+    /// Setting a name twice in one frame is left to the symbol table to complain about
+    /// </summary>
+    static symbol_ref declareName(compile_scope& scope, const std::wstring& name)
+    {
+        std::wstring nameLower = toLower(name);
+        for (const auto& existing : scope.names)
+        {
+            if (existing == nameLower)
+                return symbol_ref(name);
+        }
+
+        scope.names.push_back(nameLower);
+        return symbol_ref(name, 0, int(scope.names.size()) - 1, scope.frameId);
+    }
+
+    /// <summary>
+    /// Find the frame and slot of the closest variable set so far with a name
+    /// </summary>
+    static symbol_ref resolveName(const compile_scope& scope, const std::wstring& name)
+    {
+        std::wstring nameLower = toLower(name);
+        int frameUp = 0;
+        for (const compile_scope* cur = &scope; cur != nullptr; cur = cur->parent, ++frameUp)
+        {
+            for (int slot = int(cur->names.size()) - 1; slot >= 0; --slot)
+            {
+                if (cur->names[slot] == nameLower)
+                    return symbol_ref(name, frameUp, slot, cur->frameId, cur->global);
+            }
+        }
+        return symbol_ref(name);
+    }
+
+    /// <summary>
+    /// Resolve the variables in a compiled expression to their slots,
+    /// copying the nodes that change
+    /// </summary>
+    static expression_node_ptr resolveNames(const expression_node_ptr& node, const compile_scope& scope)
+    {
+        if (node->type == expression_node::VARIABLE)
+        {
+            symbol_ref symbol = resolveName(scope, node->symbol.name);
+            if (symbol.slot < 0)
+                return node;
+
+            auto resolved = std::make_shared<expression_node>(*node);
+            resolved->symbol = symbol;
+            return resolved;
+        }
+
+        std::vector<expression_node_ptr> children;
+        bool changed = false;
+        for (const auto& child : node->children)
+        {
+            children.push_back(resolveNames(child, scope));
+            changed = changed || children.back() != child;
+        }
+        if (!changed)
+            return node;
+
+        auto resolved = std::make_shared<expression_node>(*node);
+        resolved->children = children;
+        return resolved;
+    }
+
+    static expression_node_ptr compileExpression(std::wstring_view expStr, const compile_scope& scope)
+    {
+        return resolveNames(expression::compile(expStr), scope);
+    }
+
+    /// <summary>
+    /// Parse the name : from -> to header of ++, --, and # loops
+    /// </summary>
+    static void compileRangeLoop(const std::wstring& line, const std::string& verb, statement& stmt, const compile_scope& scope)
+    {
+        size_t firstSpace = line.find(' ');
+        if (firstSpace == std::wstring::npos)
+            raiseError(verb + " statement missing first space");
+
+        size_t nextSpace = line.find(' ', firstSpace + 1);
+        if (nextSpace == std::wstring::npos)
+            raiseError(verb + " statement lacks counter variable");
+
+        std::wstring label = trim(line.substr(firstSpace, nextSpace - firstSpace));
+        validateName(label);
+
+        size_t thirdSpace = line.find(' ', nextSpace + 1);
+        if (thirdSpace == std::wstring::npos)
+            raiseError(verb + " statement lacks from part");
+
+        std::wstring from = trim(line.substr(nextSpace, thirdSpace - nextSpace));
+        if (from != L":")
+            raiseError(verb + " statement invalid : part");
+
+        std::wstring theRest = line.substr(thirdSpace + 1);
+        std::wstring fromExpStr, toExpStr;
+        int parenCount = 0;
+        bool inString = false;
+        static int arrowLen = int(strlen(" -> "));
+        int theRestSize = int(theRest.size());
+        for (int f = 0; f < theRestSize - arrowLen; ++f)
+        {
+            auto c = theRest[f];
+            if (c == '\"')
+                inString = !inString;
+
+            if (!inString)
+            {
+                if (c == '(')
+                    ++parenCount;
+                else if (c == ')')
+                    --parenCount;
+            }
+
+            if (!inString && parenCount == 0)
+            {
+                if (startsWith(theRest.substr(f), L" -> "))
+                {
+                    fromExpStr = trim(theRest.substr(0, f));
+                    toExpStr = trim(theRest.substr(f + arrowLen));
+                    break;
+                }
+            }
+        }
+
+        stmt.symbol = symbol_ref(label);
+        stmt.exp = compileExpression(fromExpStr, scope);
+        stmt.exp2 = compileExpression(toExpStr, scope);
+    }
+
+    /// <summary>
+    /// Compile the body of a loop, in a frame inside the frame with the loop variable
+    /// </summary>
+    static void compileLoopBody(const std::vector<std::wstring>& lines, int l, int loopEnd, statement& stmt, const compile_scope& scope)
+    {
+        compile_scope outerScope(&scope);
+        stmt.symbol = declareName(outerScope, stmt.symbol.name);
+        stmt.innerSymbol = stmt.symbol;
+        if (stmt.innerSymbol.slot >= 0)
+            ++stmt.innerSymbol.frameUp;
+
+        compile_scope bodyScope(&outerScope);
+        stmt.body = compileStatements(lines, l + 1, loopEnd - 1, bodyScope);
+    }
+
+    /// <summary>
+    /// Turn the markers of an if or switch statement into branches
+    /// Problems with the markers are raised when the branch is reached
+    /// </summary>
+    static void
+    compileBranches
+    (
+        const std::vector<std::wstring>& lines,
+        const std::vector<int>& markers,
+        const wchar_t* lineStart,
+        statement& stmt,
+        const compile_scope& scope
+    )
+    {
+        const int max_markers_idx = int(markers.size()) - 1;
+        for (int m = 0; m <= max_markers_idx; ++m)
+        {
+            const int marker_line_idx = markers[m];
+            const std::wstring& marker_line = lines[marker_line_idx];
+            if (marker_line == L"}")
+                continue;
+
+            statement_branch branch;
+            if (m >= max_markers_idx)
+            {
+                branch.type = statement_branch::UNFINISHED;
+                stmt.branches.push_back(branch);
+                break;
+            }
+
+            int next_marker_line_idx = markers[m + 1];
+            const std::wstring& next_marker_line = lines[next_marker_line_idx];
+            if (next_marker_line != L"}")
+                --next_marker_line_idx;
+
+            if (startsWith(marker_line, lineStart))
+            {
+                size_t spaceIndex = marker_line.find(' ');
+                branch.type = statement_branch::CRITERIA;
+                branch.criteria = compileExpression(marker_line.substr(spaceIndex + 1), scope);
+            }
+            else if (marker_line == L"<>")
+                branch.type = statement_branch::ELSE;
+            else
+                branch.type = statement_branch::INVALID;
+
+            compile_scope branchScope(&scope);
+            branch.body = compileStatements(lines, marker_line_idx + 1, next_marker_line_idx - 1, branchScope);
+            stmt.branches.push_back(branch);
+        }
+    }
+
+    /// <summary>
+    /// Compile the statement starting on a line
+    /// </summary>
+    /// <returns>The last line of the statement</returns>
+    static int compileStatement(const std::vector<std::wstring>& lines, int l, int endLine, statement& stmt, compile_scope& scope)
+    {
+        std::wstring line = lines[l];
+        auto first = line[0];
+
+        if (first == '$') // variable declaration, initial value optional
+        {
+            stmt.type = statement::DECLARE;
+
+            line = line.substr(1);
+            size_t equalsIndex = line.find('=');
+            if (equalsIndex != std::wstring::npos)
+            {
+                std::wstring nameStr = trim(line.substr(0, equalsIndex));
+                validateName(nameStr);
+                stmt.exp = compileExpression(trim(line.substr(equalsIndex + 1)), scope);
+                stmt.symbol = declareName(scope, nameStr);
+            }
+            else
+            {
+                std::wstring nameStr = trim(line);
+                validateName(nameStr);
+                stmt.symbol = declareName(scope, nameStr);
+            }
+        }
+        else if (first == '&') // variable assignment
+        {
+            stmt.type = statement::ASSIGN;
+
+            line = line.substr(1);
+            size_t equalsIndex = line.find('=');
+            if (equalsIndex == std::wstring::npos)
+                raiseError("Variable assignment lacks value");
+
+            std::wstring nameStr = trim(line.substr(0, equalsIndex));
+            validateName(nameStr);
+            stmt.symbol = resolveName(scope, nameStr);
+            stmt.exp = compileExpression(trim(line.substr(equalsIndex + 1)), scope);
+            stmt.appends = expression::findAppends(stmt.exp, stmt.symbol.nameLower);
+        }
+        else if (first == '*') // assignment or statement that doesn't store return value
+        {
+            line = trim(line.substr(1));
+            if (line.empty())
+                raiseError("* lacks expression");
+
+            if (line[0] == '*')
+            {
+                line = trim(line.substr(1));
+                if (line.empty())
+                    raiseError("** lacks expression");
+                stmt.allowDynamicCalls = true;
+            }
+
+            stmt.type = statement::EVALUATE;
+            size_t equals_idx = line.find('=');
+            if (equals_idx != std::wstring::npos)
+            {
+                std::wstring name_str = trim(line.substr(0, equals_idx));
+                if (isName(name_str))
+                {
+                    stmt.type = statement::ASSIGN;
+                    stmt.symbol = resolveName(scope, name_str);
+                    stmt.exp = compileExpression(trim(line.substr(equals_idx + 1)), scope);
+                    stmt.appends = expression::findAppends(stmt.exp, stmt.symbol.nameLower);
+                }
+            }
+
+            if (stmt.type == statement::EVALUATE)
+                stmt.exp = compileExpression(line, scope);
+        }
+        else if (first == '!') // exception handler
+        {
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            stmt.type = statement::HANDLER;
+
+            // the label only matters when there's an exception to handle
+            std::wstring label = trim(line.substr(1));
+            try
+            {
+                validateName(label);
+            }
+            catch (const user_exception& exp)
+            {
+                stmt.error = exp;
+            }
+
+            // the handler runs in a frame with the label
+            compile_scope handlerScope(&scope);
+            stmt.symbol = declareName(handlerScope, label);
+            stmt.body = compileStatements(lines, l + 1, loopEnd - 1, handlerScope);
+            return loopEnd;
+        }
+        else if (line == L"O") // infinite loop
+        {
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            stmt.type = statement::INFINITE_LOOP;
+            compile_scope bodyScope(&scope);
+            stmt.body = compileStatements(lines, l + 1, loopEnd - 1, bodyScope);
+            return loopEnd;
+        }
+        else if (first == '{') // braced scope, for variable declaration containment
+        {
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            stmt.type = statement::SCOPE;
+            compile_scope bodyScope(&scope);
+            stmt.body = compileStatements(lines, l + 1, loopEnd - 1, bodyScope);
+            return loopEnd;
+        }
+        else if (line == L"<-") // void return statement
+        {
+            stmt.type = statement::RETURN;
+        }
+        else if (startsWith(line, L"<-")) // valued return statement
+        {
+            std::wstring ret_exp_str = trim(line.substr(2));
+            if (ret_exp_str.empty())
+                raiseError("<- statement lacks return value");
+            stmt.type = statement::RETURN;
+            stmt.exp = compileExpression(ret_exp_str, scope);
+        }
+        else if (startsWith(line, L"++")) // for x = a; x < b; ++x
+        {
+            compileRangeLoop(line, "++", stmt, scope);
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            stmt.type = statement::COUNT_UP;
+            compileLoopBody(lines, l, loopEnd, stmt, scope);
+            return loopEnd;
+        }
+        else if (startsWith(line, L"--")) // for x = a; x >= b; --x
+        {
+            compileRangeLoop(line, "--", stmt, scope);
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            stmt.type = statement::COUNT_DOWN;
+            compileLoopBody(lines, l, loopEnd, stmt, scope);
+            return loopEnd;
+        }
+        else if (first == '+') // import
+        {
+            std::wstring newFilename = trim(line.substr(1));
+            if (newFilename.empty())
+                raiseError("import statement has no file name");
+            stmt.type = statement::IMPORT;
+            stmt.exp = compileExpression(newFilename, scope);
+        }
+        else if (first == '?') // if else
+        {
+            auto markers = findElses(lines, l, endLine, L"?", L"<>", false);
+            stmt.type = statement::IF;
+            compileBranches(lines, markers, L"?", stmt, scope);
+            return markers.back();
+        }
+        else if (startsWith(line, L"[]")) // switch
+        {
+            line = trim(line.substr(2));
+            if (line.empty())
+                raiseError("[] statement missing switch value expression");
+
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            auto markers = findElses(lines, l + 1, loopEnd - 1, L"=", L"<>", true);
+            stmt.type = statement::SWITCH;
+            stmt.exp = compileExpression(line, scope);
+            compileBranches(lines, markers, L"=", stmt, scope);
+            return loopEnd;
+        }
+        else if (first == '@') // for each loop
+        {
+            size_t firstSpace = line.find(' ');
+            if (firstSpace == std::wstring::npos)
+                raiseError("@ statement lacks loop variable name");
+
+            size_t nextSpace = line.find(' ', firstSpace + 1);
+            if (nextSpace == std::wstring::npos)
+                raiseError("@ statement lacks : part");
+
+            size_t thirdSpace = line.find(' ', nextSpace + 1);
+            if (thirdSpace == std::wstring::npos)
+                raiseError("@ statement lacks collection expression");
+
+            std::wstring label = trim(line.substr(firstSpace, nextSpace - firstSpace));
+            validateName(label);
+
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            stmt.type = statement::FOR_EACH;
+            stmt.exp = compileExpression(line.substr(thirdSpace + 1), scope);
+            stmt.symbol = symbol_ref(label);
+            compileLoopBody(lines, l, loopEnd, stmt, scope);
+            return loopEnd;
+        }
+        else if (first == '#') // for x = a to y
+        {
+            compileRangeLoop(line, "#", stmt, scope);
+            int loopEnd = findMatchingEnd(lines, l, endLine);
+            stmt.type = statement::COUNT;
+            compileLoopBody(lines, l, loopEnd, stmt, scope);
+            return loopEnd;
+        }
+        else if (first == '~') // function declaration, processed before the script runs
+        {
+            stmt.type = statement::FUNCTION;
+            return findMatchingEnd(lines, l, endLine);
+        }
+        else if (line == L"^") // continue
+        {
+            stmt.type = statement::CONTINUE;
+        }
+        else if (line == L"v" || line == L"V") // break
+        {
+            stmt.type = statement::BREAK;
+        }
+        else if (startsWith(line, L">>>")) // trace output in sections
+        {
+            static size_t verbLen = strlen(">>>"); // >>> section_label : label_level : msg_expression
+
+            size_t first_colon = line.find(':');
+            if (first_colon == std::wstring::npos)
+                raiseError("Trace statement lacks colon between section and level");
+
+            stmt.name = trim(line.substr(0, first_colon).substr(verbLen));
+            if (stmt.name.empty())
+                raiseError("Trace statement section is missing");
+
+            // the rest is only looked at if the section is being traced,
+            // so problems with it are raised at that point
+            stmt.type = statement::TRACE;
+
+            size_t second_colon = line.find(':', first_colon + 1);
+            if (second_colon == std::wstring::npos)
+            {
+                stmt.error = user_exception(toWideStr("Trace statement lacks colon between level and message"));
+                return l;
+            }
+
+            std::wstring level_str = trim(line.substr(first_colon + 1, second_colon - first_colon - 1));
+            if (level_str.empty())
+            {
+                stmt.error = user_exception(toWideStr("Trace statement level is missing"));
+                return l;
+            }
+            stmt.exp2 = compileExpression(level_str, scope);
+
+            std::wstring msg_exp_str = trim(line.substr(second_colon + 1));
+            if (msg_exp_str.empty())
+            {
+                stmt.error = user_exception(toWideStr("Trace statement output is missing"));
+                return l;
+            }
+            stmt.exp3 = compileExpression(msg_exp_str, scope);
+        }
+        else if (startsWith(line, L">>")) // command expression to execute
+        {
+            std::wstring command_str = trim(line.substr(2));
+            if (command_str.empty())
+                raiseError("Command for >> statement not provided");
+            stmt.type = statement::COMMAND_EXP;
+            stmt.exp = compileExpression(command_str, scope);
+        }
+        else if (startsWith(line, L">!")) // command with errors suppressed
+        {
+            line = trim(line.substr(2));
+            stmt.type = statement::SUPPRESS;
+            if (!line.empty())
+                stmt.exp = compileExpression(line, scope);
+        }
+        else if (first == '>') // single line expression print
+        {
+            std::wstring valueStr = trim(line.substr(1));
+            stmt.type = statement::PRINT;
+            if (!valueStr.empty())
+                stmt.exp = compileExpression(valueStr, scope);
+        }
+        else // a command line to run
+        {
+            stmt.type = statement::COMMAND;
+        }
+
+        return l;
+    }
+
+    /// <summary>
+    /// Errors show $, &, and * lines without their prefix, the way they always have
+    /// </summary>
+    static std::wstring errorLineText(const std::wstring& line)
+    {
+        if (line[0] == '$' || line[0] == '&')
+            return line.substr(1);
+
+        if (line[0] != '*')
+            return line;
+
+        std::wstring text = trim(line.substr(1));
+        if (!text.empty() && text[0] == '*')
+            text = trim(text.substr(1));
+        return text;
+    }
+
+    static statement_block compileStatements(const std::vector<std::wstring>& lines, int startLine, int endLine, compile_scope& scope)
+    {
+        statement_block statements;
+        for (int l = startLine; l <= endLine; ++l)
+        {
+            const std::wstring& line = lines[l];
+            if (line.empty()) // skip blank lines
+                continue;
+
+            statement stmt;
+            stmt.lineIndex = l;
+            stmt.line = errorLineText(line);
+            try
+            {
+                l = compileStatement(lines, l, endLine, stmt, scope);
+            }
+            catch (const user_exception& exp)
+            {
+                // the statement raises the error if the script gets to it
+                stmt.type = statement::ERROR;
+                stmt.error = exp;
+                stmt.body.clear();
+                stmt.branches.clear();
+            }
+            statements.push_back(std::move(stmt));
+        }
+        return statements;
+    }
+
+    statement_block 
+    compileStatements
+    (
+        const std::vector<std::wstring>& lines, 
+        int startLine, 
+        int endLine,
+        frame_plan& plan,
+        const frame_plan* globals
+    )
+    {
+        // function bodies see the globals past the function's own frames
+        compile_scope globalScope(nullptr);
+        if (globals != nullptr)
+        {
+            globalScope.frameId = globals->frameId;
+            globalScope.global = true;
+            globalScope.names = globals->names;
+        }
+
+        compile_scope scope(globals != nullptr ? &globalScope : nullptr);
+        for (const auto& name : plan.names)
+            plan.symbols.push_back(declareName(scope, name));
+
+        statement_block statements = compileStatements(lines, startLine, endLine, scope);
+        plan.frameId = scope.frameId;
+        plan.names = scope.names;
+        return statements;
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "expression_tree.h"
+#include "user_exception.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace mscript
+{
+    struct statement;
+    typedef std::vector<statement> statement_block;
+
+    /// <summary>
+    /// A statement_branch is one ? / = / <> part of an if or switch statement
+    /// </summary>
+    struct statement_branch
+    {
+        enum branch_type
+        {
+            CRITERIA,   // ? or =, criteria is the condition or case value
+            ELSE,       // <>
+            INVALID,    // neither, raises when reached
+            UNFINISHED  // no closing } after the last marker, raises when reached
+        };
+
+        branch_type type = INVALID;
+        expression_node_ptr criteria;
+        statement_block body;
+    };
+
+    /// <summary>
+    /// A statement is one line of script, with any block it starts,
+    /// parsed once so the script processor executes nodes and not text
+    /// </summary>
+    struct statement
+    {
+        enum statement_type
+        {
+            ERROR,          // error is raised when executed
+            DECLARE,        // $ symbol = exp
+            ASSIGN,         // & symbol = exp, or * symbol = exp
+            EVALUATE,       // * exp, or ** exp with dynamic calls
+            HANDLER,        // ! symbol, body
+            INFINITE_LOOP,  // O, body
+            SCOPE,          // {, body
+            RETURN,         // <- with optional exp
+            COUNT_UP,       // ++ symbol : exp -> exp2, body
+            COUNT_DOWN,     // -- symbol : exp -> exp2, body
+            COUNT,          // # symbol : exp -> exp2, either direction, body
+            IMPORT,         // + exp
+            IF,             // ? branches
+            SWITCH,         // [] exp, branches
+            FOR_EACH,       // @ symbol : exp, body
+            FUNCTION,       // ~ function declaration, processed up front
+            CONTINUE,       // ^
+            BREAK,          // v
+            TRACE,          // >>> name : exp2 : exp3
+            COMMAND_EXP,    // >> exp
+            SUPPRESS,       // >! with optional exp
+            PRINT,          // > with optional exp
+            COMMAND         // anything else is a command line to run
+        };
+
+        statement_type type = ERROR;
+
+        // Where the statement came from, for error reporting,
+        // $, &, and * lines without their prefix
+        int lineIndex = -1;
+        std::wstring line;
+
+        // Variable, loop variable, or exception label, resolved to its slot
+        // The loop variable as seen from inside the loop is innerSymbol
+        symbol_ref symbol;
+        symbol_ref innerSymbol;
+
+        // Trace section
+        std::wstring name;
+
+        expression_node_ptr exp;
+        expression_node_ptr exp2;
+        expression_node_ptr exp3;
+
+        bool allowDynamicCalls = false;
+
+        // & x = x + a + b..., the + nodes adding onto x in place, see expression::findAppends()
+        std::vector<expression_node_ptr> appends;
+
+        statement_block body;
+        std::vector<statement_branch> branches;
+
+        // Parsing problem raised when the statement gets to it
+        std::optional<user_exception> error;
+    };
+
+    /// <summary>
+    /// frame_plan is the variables given slots in the frame compiled statements run in
+    /// </summary>
+    struct frame_plan
+    {
+        // Variables set before the statements run, like function parameters,
+        // then the ones the statements set, in slot order
+        std::vector<std::wstring> names;
+
+        // How to set the variables that were set before the statements run
+        std::vector<symbol_ref> symbols;
+
+        int frameId = 0;
+    };
+
+    /// <summary>
+    /// Compile a range of preprocessed script lines into statements
+    /// Errors are kept in the statements and raised when they are executed
+    /// Variables declared in the statements are given slots in their stack frames,
+    /// and variable references are resolved to those slots where possible
+    /// </summary>
+    /// <param name="plan">Variables already set in the frame the statements run in, filled in with the rest</param>
+    /// <param name="globals">For function bodies, the plan of the script's global frame</param>
+    statement_block 
+    compileStatements
+    (
+        const std::vector<std::wstring>& lines, 
+        int startLine, 
+        int endLine,
+        frame_plan& plan,
+        const frame_plan* globals = nullptr
+    );
+}
@@ -5,97 +5,287 @@
 
 namespace mscript
 {
-    symbol_table::stack symbol_table::smackFrames()
+    // Frames bigger than this get a name index
+    static const int sm_frameIndexMinSize = 16;
+
+    symbol_ref::symbol_ref(const std::wstring& _name, int _frameUp, int _slot, int _frameId, bool _global)
+        : name(_name)
+        , nameLower(toLower(_name))
+        , frameUp(_frameUp)
+        , slot(_slot)
+        , frameId(_frameId)
+        , global(_global)
+    {}
+
+    symbol_table::stack_frame::stack_frame(const stack_frame& other)
+        : unplanned(other.unplanned)
+        , lastUnplanned(other.lastUnplanned)
+        , planId(other.planId)
+        , planBase(other.planBase)
+        , planCount(other.planCount)
+        , m_entries(other.m_entries)
     {
-        if (m_symbols.empty())
-            return symbol_table::stack();
+        if (other.m_index)
+            m_index = std::make_unique<std::unordered_map<std::wstring, int>>(*other.m_index);
+    }
 
-        stack retVal;
-        for (size_t i = 1; i < m_symbols.size(); ++i)
-            retVal.push_back(m_symbols[i]);
-        m_symbols = stack{ m_symbols[0] };
-        return retVal;
+    symbol_table::stack_frame& symbol_table::stack_frame::operator=(const stack_frame& other)
+    {
+        if (this != &other)
+        {
+            unplanned = other.unplanned;
+            lastUnplanned = other.lastUnplanned;
+            planId = other.planId;
+            planBase = other.planBase;
+            planCount = other.planCount;
+            m_entries = other.m_entries;
+            m_index.reset();
+            if (other.m_index)
+                m_index = std::make_unique<std::unordered_map<std::wstring, int>>(*other.m_index);
+        }
+        return *this;
     }
 
-    void symbol_table::restoreFrames(const symbol_table::stack& frames)
+    int symbol_table::stack_frame::find(const std::wstring& nameLower) const
     {
-        m_symbols.insert(m_symbols.end(), frames.begin(), frames.end());
+        if (m_index)
+        {
+            const auto& it = m_index->find(nameLower);
+            return it == m_index->end() ? -1 : it->second;
+        }
+
+        for (int e = 0; e < int(m_entries.size()); ++e)
+        {
+            if (m_entries[e].name == nameLower)
+                return e;
+        }
+        return -1;
     }
 
-    bool symbol_table::contains(const std::wstring& name)
+    void symbol_table::stack_frame::add(const std::wstring& nameLower, const object& value)
     {
-        std::wstring name_lower = toLower(name);
-        for (int s = int(m_symbols.size()) - 1; s >= 0; --s)
+        m_entries.emplace_back(nameLower, value);
+
+        if (m_index)
+        {
+            m_index->insert({ nameLower, int(m_entries.size()) - 1 });
+        }
+        else if (int(m_entries.size()) > sm_frameIndexMinSize)
         {
-            const auto& curMap = m_symbols[s];
-            if (curMap.find(name_lower) != curMap.end())
-                return true;
+            m_index = std::make_unique<std::unordered_map<std::wstring, int>>();
+            for (int e = 0; e < int(m_entries.size()); ++e)
+                m_index->insert({ m_entries[e].name, e });
         }
-        return false;
+    }
+
+    int symbol_table::smackFrames()
+    {
+        int prevBase = m_base;
+        m_base = int(m_symbols.size());
+        return prevBase;
+    }
+
+    void symbol_table::restoreFrames(int base)
+    {
+        m_base = base;
+    }
+
+    symbol_table::stack_entry* symbol_table::findSlot(const symbol_ref& symbol)
+    {
+        if (symbol.slot < 0)
+            return nullptr;
+
+        // frames in between with variables the compiler did not know about
+        // could have one by this name that should be found first
+        int lastUnplanned = m_symbols.back().lastUnplanned;
+        int frameIdx;
+        if (symbol.global)
+        {
+            frameIdx = 0;
+            if (lastUnplanned >= std::max(m_base, 1))
+                return nullptr;
+        }
+        else
+        {
+            frameIdx = int(m_symbols.size()) - 1 - symbol.frameUp;
+            if (frameIdx < m_base || lastUnplanned > frameIdx)
+                return nullptr;
+        }
+
+        // the slot has to be one of the compiled frame's that has been set
+        auto& frame = m_symbols[frameIdx];
+        if (frame.planId != symbol.frameId || symbol.slot >= frame.planCount)
+            return nullptr;
+
+        stack_entry& entry = frame[frame.planBase + symbol.slot];
+#ifdef _DEBUG
+        if (entry.name != symbol.nameLower)
+            raiseWError(L"Variable slot mismatch: " + symbol.name);
+#endif
+        return &entry;
+    }
+
+    symbol_table::stack_entry* symbol_table::findName(const std::wstring& nameLower)
+    {
+        // Look through the current activation's frames, then the globals
+        for (int s = int(m_symbols.size()) - 1; s >= m_base; --s)
+        {
+            auto& curFrame = m_symbols[s];
+            int slot = curFrame.find(nameLower);
+            if (slot >= 0)
+                return &curFrame[slot];
+        }
+
+        if (m_base > 0)
+        {
+            auto& globalFrame = m_symbols[0];
+            int slot = globalFrame.find(nameLower);
+            if (slot >= 0)
+                return &globalFrame[slot];
+        }
+
+        return nullptr;
+    }
+
+    bool symbol_table::contains(const std::wstring& name)
+    {
+        return findName(toLower(name)) != nullptr;
     }
 
     void symbol_table::set(const std::wstring& name, const object& value)
     {
         validateName(name);
+        setLower(name, toLower(name), value);
+    }
 
-        auto& dict = m_symbols.back();
+    void symbol_table::set(const symbol_ref& symbol, const object& value)
+    {
+        // Planned variables go right into their slots,
+        // the compiler made sure there's nothing else by that name in the frame's plan
+        auto& frame = m_symbols.back();
+        if
+        (
+            symbol.slot >= 0 && symbol.frameUp == 0 && !symbol.global && symbol.slot == frame.planCount
+            &&
+            (frame.planCount == 0 || (frame.planId == symbol.frameId && frame.size() == frame.planBase + frame.planCount))
+            &&
+            (!frame.unplanned || frame.find(symbol.nameLower) < 0)
+        )
+        {
+            if (frame.planCount == 0)
+            {
+                frame.planId = symbol.frameId;
+                frame.planBase = frame.size();
+            }
+            frame.add(symbol.nameLower, value);
+            ++frame.planCount;
+            return;
+        }
 
-        std::wstring name_lower = toLower(name);
-        if (dict.find(name_lower) != dict.end())
+        validateName(symbol.name);
+        setLower(symbol.name, symbol.nameLower, value);
+    }
+
+    void symbol_table::setLower(const std::wstring& name, const std::wstring& nameLower, const object& value)
+    {
+        auto& frame = m_symbols.back();
+        if (frame.find(nameLower) >= 0)
             raiseWError(L"Name already set, you have to use a different name: " + name);
 
-        dict.insert({ name_lower, value });
+        frame.add(nameLower, value);
+        frame.unplanned = true;
+        frame.lastUnplanned = int(m_symbols.size()) - 1;
     }
 
-    void symbol_table::assign(const std::wstring& name, const object& value, bool createIfMissing)
+    void symbol_table::assignEntry(stack_entry& entry, const std::wstring& name, const object& value)
     {
-        std::wstring name_lower = toLower(name);
-        for (int s = int(m_symbols.size()) - 1; s >= 0; --s)
+        // Implement type-safe assignment
+        // If it ever had a non-null value, subsequent assignments
+        // have to be to values of the same type
+        if
+        (
+            entry.everType == object::NOTHING
+            ||
+            entry.value.type() == value.type()
+        )
         {
-            auto& curMap = m_symbols[s];
-            if (curMap.find(name_lower) != curMap.end())
-            {
-                stack_entry& entry = curMap[name_lower];
-                // Implement type-safe assignment
-                // If it ever had a non-null value, subsequent assignments
-                // have to be to values of the same type
-                if 
-                (
-                    entry.everType == object::NOTHING 
-                    || 
-                    entry.value.type() == value.type()
-                )
-                {
-                    entry.value = value;
-                    if (value.type() != object::NOTHING)
-                        entry.everType = value.type();
-                    return;
-                }
-                else
-                    raiseWError(L"Invalid assignment, type mismatch: " + name);
-            }
+            entry.value = value;
+            if (value.type() != object::NOTHING)
+                entry.everType = value.type();
         }
-        if (createIfMissing)
+        else
+            raiseWError(L"Invalid assignment, type mismatch: " + name);
+    }
+
+    void symbol_table::assign(const std::wstring& name, const object& value, bool createIfMissing)
+    {
+        std::wstring name_lower = toLower(name);
+        stack_entry* entry = findName(name_lower);
+        if (entry != nullptr)
+            assignEntry(*entry, name, value);
+        else if (createIfMissing)
             set(name, value);
         else
             raiseWError(L"Name not set: " + name);
     }
 
+    void symbol_table::assign(const symbol_ref& symbol, const object& value)
+    {
+        stack_entry* entry = findSlot(symbol);
+        if (entry == nullptr)
+            entry = findName(symbol.nameLower);
+
+        if (entry != nullptr)
+            assignEntry(*entry, symbol.name, value);
+        else
+            raiseWError(L"Name not set: " + symbol.name);
+    }
+
     bool symbol_table::tryGet(const std::wstring& name, object& answer)
     {
-        std::wstring name_lower = toLower(name);
-        answer = object();
-        for (int s = int(m_symbols.size()) - 1; s >= 0; --s)
+        stack_entry* entry = findName(toLower(name));
+        if (entry != nullptr)
         {
-            const auto& curMap = m_symbols[s];
-            const auto& it = curMap.find(name_lower);
-            if (it != curMap.end())
-            {
-                answer = it->second.value;
-                return true;
-            }
+            answer = entry->value;
+            return true;
+        }
+        else
+        {
+            answer = object();
+            return false;
+        }
+    }
+
+    bool symbol_table::tryGet(const symbol_ref& symbol, object& answer)
+    {
+        stack_entry* entry = findSlot(symbol);
+        if (entry == nullptr)
+            entry = findName(symbol.nameLower);
+
+        if (entry != nullptr)
+        {
+            answer = entry->value;
+            return true;
+        }
+        else
+        {
+            answer = object();
+            return false;
         }
-        return false;
+    }
+
+    object* symbol_table::tryGetVariable(const std::wstring& name)
+    {
+        stack_entry* entry = findName(toLower(name));
+        return entry != nullptr ? &entry->value : nullptr;
+    }
+
+    object* symbol_table::tryGetVariable(const symbol_ref& symbol)
+    {
+        stack_entry* entry = findSlot(symbol);
+        if (entry == nullptr)
+            entry = findName(symbol.nameLower);
+        return entry != nullptr ? &entry->value : nullptr;
     }
 
     object symbol_table::get(const std::wstring& name)
@@ -105,4 +295,12 @@ namespace mscript
             raiseWError(L"Name not assigned a value: " + name);
         return answer;
     }
+
+    object symbol_table::get(const symbol_ref& symbol)
+    {
+        object answer;
+        if (!tryGet(symbol, answer))
+            raiseWError(L"Name not assigned a value: " + symbol.name);
+        return answer;
+    }
 }
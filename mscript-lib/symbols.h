@@ -2,12 +2,34 @@
 
 #include "object.h"
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace mscript
 {
+    /// <summary>
+    /// symbol_ref is a variable name as the script compiler resolved it,
+    /// the frame above the current one and the slot in that frame
+    /// where the variable should be, or -1 if it's only known by name
+    /// The frame ID says which compiled frame the slot is in,
+    /// and global variables are in the global frame wherever the code runs
+    /// </summary>
+    struct symbol_ref
+    {
+        symbol_ref() {}
+        symbol_ref(const std::wstring& _name, int _frameUp = -1, int _slot = -1, int _frameId = 0, bool _global = false);
+
+        std::wstring name;
+        std::wstring nameLower;
+
+        int frameUp = -1;
+        int slot = -1;
+        int frameId = 0;
+        bool global = false;
+    };
+
 	/// <summary>
 	/// symbol_table manages the name->value mappings at each call stack level
 	/// </summary>
@@ -15,20 +37,67 @@ namespace mscript
 	{
     public:
         /// <summary>
-        /// Each stack entry has a value, and what non-null type of value
+        /// Each stack entry has a name, a value, and what non-null type of value
         /// this variable has ever had
         /// </summary>
         struct stack_entry
         {
-            stack_entry(object _value = object()) 
-                : value(_value)
-                , everType(value.type()) 
+            stack_entry(const std::wstring& _name, object _value = object())
+                : name(_name)
+                , value(_value)
+                , everType(value.type())
             {}
 
+            std::wstring name;
             object value;
             object::object_type everType;
         };
-        typedef std::unordered_map<std::wstring, stack_entry> stack_frame;
+
+        /// <summary>
+        /// Each stack frame has its variables in the order they were set,
+        /// so the slots the compiler works out are indexes into the frame,
+        /// counting from where the first of the compiled frame's variables went
+        /// Big frames like the globals get a name index for looking things up by name
+        /// </summary>
+        class stack_frame
+        {
+        public:
+            stack_frame() {}
+            stack_frame(const stack_frame& other);
+            stack_frame(stack_frame&& other) = default;
+            stack_frame& operator=(const stack_frame& other);
+            stack_frame& operator=(stack_frame&& other) = default;
+
+            int size() const { return int(m_entries.size()); }
+            stack_entry& operator[](int slot) { return m_entries[slot]; }
+            const stack_entry& operator[](int slot) const { return m_entries[slot]; }
+
+            int find(const std::wstring& nameLower) const;
+            void add(const std::wstring& nameLower, const object& value);
+
+            /// <summary>
+            /// Has this frame gotten variables the compiler did not plan for?
+            /// </summary>
+            bool unplanned = false;
+
+            /// <summary>
+            /// The highest frame at or below this one that has unplanned variables, or -1
+            /// </summary>
+            int lastUnplanned = -1;
+
+            /// <summary>
+            /// Which compiled frame's variables are in slots here,
+            /// where the first one is, and how many are in their slots
+            /// </summary>
+            int planId = 0;
+            int planBase = 0;
+            int planCount = 0;
+
+        private:
+            std::vector<stack_entry> m_entries;
+            std::unique_ptr<std::unordered_map<std::wstring, int>> m_index;
+        };
+
         typedef std::vector<stack_frame> stack;
 
         symbol_table()
@@ -38,7 +107,9 @@ namespace mscript
 
         void pushFrame()
         {
+            int lastUnplanned = m_symbols.empty() ? -1 : m_symbols.back().lastUnplanned;
             m_symbols.emplace_back();
+            m_symbols.back().lastUnplanned = lastUnplanned;
         }
 
         void popFrame()
@@ -47,16 +118,25 @@ namespace mscript
         }
 
         /// <summary>
-        /// Remove all frames but the top global frame and return those
+        /// How many frames are there, including ones hidden by smackFrames?
+        /// </summary>
+        int frameCount() const
+        {
+            return int(m_symbols.size());
+        }
+
+        /// <summary>
+        /// Hide all frames but the top global frame by starting a new activation
+        /// above them, the frames stay where they are
         /// </summary>
-        /// <returns></returns>
-        stack smackFrames();
+        /// <returns>The base of the previous activation, for restoreFrames</returns>
+        int smackFrames();
 
         /// <summary>
-        /// Given previously smacked frames, restore them
+        /// Given the base of a previous activation, return to it
         /// </summary>
-        /// <param name="frames">Stack frames to restore</param>
-        void restoreFrames(const stack& frames);
+        /// <param name="base">Base returned by smackFrames</param>
+        void restoreFrames(int base);
 
         /// <summary>
         /// Does a name exist in the symbol table?
@@ -67,28 +147,49 @@ namespace mscript
         /// Set a new named variable with an initial value
         /// </summary>
         void set(const std::wstring& name, const object& value);
+        void set(const symbol_ref& symbol, const object& value);
 
         /// <summary>
         /// Update the value of a named variable
         /// </summary>
         void assign(const std::wstring& name, const object& value, bool createIfMissing = false);
+        void assign(const symbol_ref& symbol, const object& value);
 
         /// <summary>
         /// Try to get the value of a named variable
         /// </summary>
         bool tryGet(const std::wstring& name, object& answer);
+        bool tryGet(const symbol_ref& symbol, object& answer);
+
+        /// <summary>
+        /// Get the variable itself, for changing its value in place,
+        /// or nullptr if the name is not set
+        /// The pointer is only good until variables are added or frames change
+        /// </summary>
+        object* tryGetVariable(const std::wstring& name);
+        object* tryGetVariable(const symbol_ref& symbol);
 
         /// <summary>
         /// Get the value of a named variable
         /// </summary>
         object get(const std::wstring& name);
+        object get(const symbol_ref& symbol);
 
     private:
+        stack_entry* findSlot(const symbol_ref& symbol);
+        stack_entry* findName(const std::wstring& nameLower);
+        void setLower(const std::wstring& name, const std::wstring& nameLower, const object& value);
+        void assignEntry(stack_entry& entry, const std::wstring& name, const object& value);
+
         stack m_symbols;
+
+        // The first frame of the current function call's activation,
+        // frames between the global frame and this one are not visible
+        int m_base = 0;
 	};
 
     /// <summary>
-    /// Remove all stack frames but the top global level on creation,
+    /// Hide all stack frames but the top global level on creation,
     /// then restore the frames on disposal
     /// </summary>
     class symbol_smacker
@@ -96,15 +197,15 @@ namespace mscript
     public:
         symbol_smacker(symbol_table& table) : m_table(table)
         { 
-            m_smackedFrames = m_table.smackFrames(); 
+            m_smackedBase = m_table.smackFrames(); 
         }
         ~symbol_smacker()
         { 
-            m_table.restoreFrames(m_smackedFrames); 
+            m_table.restoreFrames(m_smackedBase); 
         }
     private:
         symbol_table& m_table;
-        symbol_table::stack m_smackedFrames;
+        int m_smackedBase;
     };
 
     /// <summary>
@@ -64,107 +64,112 @@ int main(int argc, char* argv[])
 		std::wstring expected = fileText.substr(separatorIdx + strlen("==="));
 		expected = trim(replace(expected, L"\r\n", L"\n"));
 
-		std::wstring output;
+		// Each script must produce the same output whichever way it is run
+		for (auto engine : { script_processor::TREE_WALKER, script_processor::BYTECODE })
+		{
+			std::wstring output;
 #ifndef _DEBUG
-		try
+			try
 #endif
-		{
 			{
-				symbol_table symbols;
-				script_processor
-					processor
-					(
-						[=](const std::wstring&, const std::wstring& filename)
-						{
-							bool isExternal = fs::path(filename).extension() == ".ms";
-							if (isExternal)
+				{
+					symbol_table symbols;
+					script_processor
+						processor
+						(
+							[=](const std::wstring&, const std::wstring& filename)
 							{
-								std::string externalFilePath = toNarrowStr(fs::path(testDirPath).append(filename));
-								std::wstring externalScript = trim(replace(readFileIntoString(externalFilePath), L"\r\n", L"\n"));
-								return split(externalScript, L"\n");
+								bool isExternal = fs::path(filename).extension() == ".ms";
+								if (isExternal)
+								{
+									std::string externalFilePath = toNarrowStr(fs::path(testDirPath).append(filename));
+									std::wstring externalScript = trim(replace(readFileIntoString(externalFilePath), L"\r\n", L"\n"));
+									return split(externalScript, L"\n");
+								}
+								else
+									return split(script, L"\n");
+							},
+							[=](const std::wstring& filename)
+							{
+								std::wstring module_file_path = fs::path(testDirPath).append(filename);
+								return module_file_path;
+							},
+							symbols,
+							[]() { return L"input"; },
+							[&output, specificTest](const std::wstring& text)
+							{ 
+								bool is_trace = startsWith(text, L"TRACE: ");
+								
+								bool should_print = is_trace || !specificTest.empty();
+								bool should_collect = !is_trace;
+
+								if (should_print)
+									printf("%S\n", text.c_str());
+								if (should_collect)
+									output += text + L"\n";
 							}
-							else
-								return split(script, L"\n");
-						},
-						[=](const std::wstring& filename)
-						{
-							std::wstring module_file_path = fs::path(testDirPath).append(filename);
-							return module_file_path;
-						},
-						symbols,
-						[]() { return L"input"; },
-						[&output, specificTest](const std::wstring& text)
-						{ 
-							bool is_trace = startsWith(text, L"TRACE: ");
-							
-							bool should_print = is_trace || !specificTest.empty();
-							bool should_collect = !is_trace;
-
-							if (should_print)
-								printf("%S\n", text.c_str());
-							if (should_collect)
-								output += text + L"\n";
-						}
-					);
-				processor.process(std::wstring(), it.first.filename());
-				output = trim(output);
+						);
+					processor.setEngine(engine);
+					processor.process(std::wstring(), it.first.filename());
+					output = trim(output);
+				}
 			}
-		}
 #ifndef _DEBUG
-		catch (const user_exception& exp)
-		{
-			printf("Object ERROR: %S - %S - line: %d: %S\n",
-				exp.obj.toString().c_str(), exp.filename.c_str(), exp.lineNumber, exp.line.c_str());
-			return 1;
-		}
-		catch (const script_exception& exp)
-		{
-			printf("Script ERROR: %s - %S - line: %d: %S\n",
-				exp.what(), exp.filename.c_str(), exp.lineNumber, exp.line.c_str());
-			return 1;
-		}
-		catch (const std::exception& exp)
-		{
-			printf("Runtime ERROR: %s\n", exp.what());
-			return 1;
-		}
-		catch (...)
-		{
-			printf("Unhandled ... ERROR\n");
-			return 1;
-		}
+			catch (const user_exception& exp)
+			{
+				printf("Object ERROR: %S - %S - line: %d: %S\n",
+					exp.obj.toString().c_str(), exp.filename.c_str(), exp.lineNumber, exp.line.c_str());
+				return 1;
+			}
+			catch (const script_exception& exp)
+			{
+				printf("Script ERROR: %s - %S - line: %d: %S\n",
+					exp.what(), exp.filename.c_str(), exp.lineNumber, exp.line.c_str());
+				return 1;
+			}
+			catch (const std::exception& exp)
+			{
+				printf("Runtime ERROR: %s\n", exp.what());
+				return 1;
+			}
+			catch (...)
+			{
+				printf("Unhandled ... ERROR\n");
+				return 1;
+			}
 #endif
-		if (output != expected)
-		{
-			printf("\nERROR: Test fails!\n");
+			if (output != expected)
+			{
+				printf("\nERROR: Test fails%s!\n", engine == script_processor::BYTECODE ? " running bytecode" : "");
 
-			auto expectedLines = split(expected, L"\n");
-			auto outputLines = split(output, L"\n");
+				auto expectedLines = split(expected, L"\n");
+				auto outputLines = split(output, L"\n");
 
-			size_t lineCount = std::min(expectedLines.size(), outputLines.size());
-			for (size_t idx = 0; idx < lineCount; ++idx)
-			{
-				std::wstring currOutputLine = outputLines[idx];
-				std::wstring currExpectedLine = expectedLines[idx];
-				if (currOutputLine != currExpectedLine)
+				size_t lineCount = std::min(expectedLines.size(), outputLines.size());
+				for (size_t idx = 0; idx < lineCount; ++idx)
+				{
+					std::wstring currOutputLine = outputLines[idx];
+					std::wstring currExpectedLine = expectedLines[idx];
+					if (currOutputLine != currExpectedLine)
+					{
+						printf("Line %d differs:\n"
+							"Expected: %S\n"
+							"Got:      %S\n",
+							(int)idx + 1, currExpectedLine.c_str(), currOutputLine.c_str());
+						return 1;
+					}
+				}
+				if (expectedLines.size() != outputLines.size())
 				{
-					printf("Line %d differs:\n"
-						"Expected: %S\n"
-						"Got:      %S\n",
-						(int)idx + 1, currExpectedLine.c_str(), currOutputLine.c_str());
+					printf("Line counts differ: expected: %d - got: %d\n", 
+						   int(expectedLines.size()), int(outputLines.size()));
 					return 1;
 				}
-			}
-			if (expectedLines.size() != outputLines.size())
-			{
-				printf("Line counts differ: expected: %d - got: %d\n", 
-					   int(expectedLines.size()), int(outputLines.size()));
+
+				printf(" - Output:\n%S\n", output.c_str());
+				printf(" - Expected:\n%S\n", expected.c_str());
 				return 1;
 			}
-
-			printf(" - Output:\n%S\n", output.c_str());
-			printf(" - Expected:\n%S\n", expected.c_str());
-			return 1;
 		}
 	}
 
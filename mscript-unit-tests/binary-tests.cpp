@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "object_binary.h"
+#include "utils.h"
+#pragma comment(lib, "mscript-core")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace mscript
+{
+	TEST_CLASS(TestBinary)
+	{
+	public:
+		TEST_METHOD(RoundTripTests)
+		{
+			object::index index;
+			index.set(toWideStr("name"), toWideStr("foo"));
+			index.set(1.0, object::list{ true, object() });
+
+			object::list list
+			{
+				object(),
+				true,
+				false,
+				12.5,
+				toWideStr(""),
+				toWideStr("bar blet"),
+				object::list(),
+				index,
+				object::index()
+			};
+
+			for (const object& obj : list)
+			{
+				auto binary = objectToBinary(obj);
+				Assert::IsTrue(objectFromBinary(binary.data(), binary.size()).toString() == obj.toString());
+			}
+
+			object obj = list;
+			auto binary = objectToBinary(obj);
+			object obj2 = objectFromBinary(binary.data(), binary.size());
+			Assert::AreEqual(obj.toString(), obj2.toString());
+			Assert::AreEqual(toWideStr("foo"), obj2.listVal()[7].indexVal().get(toWideStr("name")).stringVal());
+
+			// ASCII strings are written like any other string
+			object ascii = object::fromUtf8(std::string_view("bar blet"));
+			auto asciiBinary = objectToBinary(ascii);
+			Assert::IsTrue(asciiBinary == objectToBinary(toWideStr("bar blet")));
+			Assert::IsTrue(objectFromBinary(asciiBinary.data(), asciiBinary.size()).isAsciiString());
+		}
+
+		TEST_METHOD(BadBinaryTests)
+		{
+			auto binary = objectToBinary(object::list{ toWideStr("foo"), 1.0 });
+
+			// every cut short version fails
+			for (size_t length = 0; length < binary.size(); ++length)
+			{
+				try
+				{
+					objectFromBinary(binary.data(), length);
+					Assert::Fail();
+				}
+				catch (const user_exception&) {}
+			}
+
+			// so does extra data, or a different version
+			binary.push_back(0);
+			try
+			{
+				objectFromBinary(binary.data(), binary.size());
+				Assert::Fail();
+			}
+			catch (const user_exception&) {}
+
+			binary.pop_back();
+			binary[0] = objectBinaryVersion + 1;
+			try
+			{
+				objectFromBinary(binary.data(), binary.size());
+				Assert::Fail();
+			}
+			catch (const user_exception&) {}
+		}
+	};
+}
@@ -0,0 +1,106 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "bytecode.h"
+#include "statements.h"
+#include "utils.h"
+#pragma comment(lib, "mscript-core")
+#pragma comment(lib, "mscript-lib")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace mscript
+{
+    TEST_CLASS(BytecodeTests)
+    {
+    public:
+        static bytecode_chunk compileLines(std::vector<std::wstring> lines)
+        {
+            for (auto& line : lines)
+                line = trim(line);
+            frame_plan plan;
+            s_statements = compileStatements(lines, 0, int(lines.size()) - 1, plan);
+            return compileBytecode(s_statements);
+        }
+
+        static int countOps(const bytecode_chunk& chunk, instruction::op_code op)
+        {
+            int count = 0;
+            for (const auto& instr : chunk.code)
+            {
+                if (instr.op == op)
+                    ++count;
+            }
+            return count;
+        }
+
+        TEST_METHOD(TestCompileBytecode)
+        {
+            bytecode_chunk chunk =
+                compileLines
+                ({
+                    L"$ x = 1 + 2",
+                    L"? x > 2 && x < 4",
+                    L"\t> x",
+                    L"}",
+                    L"<>",
+                    L"\t> \"no\"",
+                    L"}",
+                });
+
+            // the script, and the bodies of the ? and <>
+            Assert::AreEqual(size_t(3), chunk.blocks.size());
+            Assert::IsTrue(chunk.code.front().op == instruction::BEGIN_BLOCK);
+            Assert::IsTrue(chunk.code.back().op == instruction::END_BLOCK);
+            Assert::AreEqual(int(chunk.code.size()) - 1, chunk.blocks[0].endPc);
+
+            Assert::AreEqual(1, countOps(chunk, instruction::AND));
+            Assert::AreEqual(1, countOps(chunk, instruction::IF_TEST));
+            Assert::AreEqual(2, countOps(chunk, instruction::IF_END));
+            Assert::AreEqual(2, countOps(chunk, instruction::PRINT));
+
+            // every jump lands inside the chunk
+            for (const auto& instr : chunk.code)
+            {
+                switch (instr.op)
+                {
+                case instruction::AND:
+                case instruction::IF_TEST:
+                case instruction::IF_END:
+                    Assert::IsTrue(instr.arg > 0 && instr.arg < int(chunk.code.size()));
+                    break;
+
+                default:
+                    break;
+                }
+            }
+        }
+
+        TEST_METHOD(TestCompileHandlers)
+        {
+            bytecode_chunk chunk =
+                compileLines
+                ({
+                    L"* error(\"oops\")",
+                    L"! err",
+                    L"\t> err",
+                    L"}",
+                    L"++ i : 1 -> 3",
+                    L"\t> i",
+                    L"}",
+                });
+
+            // the handler is found by the statement it follows
+            Assert::AreEqual(size_t(1), chunk.blocks[0].handlers.size());
+            Assert::AreEqual(1, chunk.blocks[0].handlers[0].first);
+            Assert::IsTrue(chunk.code[chunk.blocks[0].handlers[0].second].op == instruction::HANDLER);
+
+            Assert::AreEqual(1, countOps(chunk, instruction::COUNT_BEGIN));
+            Assert::AreEqual(1, countOps(chunk, instruction::LOOP_POP));
+        }
+
+    private:
+        // The chunk points into the statements it was compiled from
+        static inline statement_block s_statements;
+    };
+}
@@ -2,6 +2,7 @@
 #include "CppUnitTest.h"
 
 #include "expressions.h"
+#include "regex_cache.h"
 #include "utils.h"
 #pragma comment(lib, "mscript-core")
 #pragma comment(lib, "mscript-lib")
@@ -26,6 +27,18 @@ namespace mscript
         }
     };
 
+    class CountingCallable : public TestCallable
+    {
+    public:
+        bool hasFunction(const std::wstring& name) const
+        {
+            ++lookups;
+            return TestCallable::hasFunction(name);
+        }
+
+        mutable int lookups = 0;
+    };
+
     TEST_CLASS(ExpressionTests)
     {
     public:
@@ -68,6 +81,31 @@ namespace mscript
             }
         }
 
+        TEST_METHOD(TestCallResolution)
+        {
+            symbol_table symtable;
+            CountingCallable callable;
+            tracing trace_info;
+            expression_cache cache;
+            expression exp(symtable, callable, trace_info, false, &cache);
+
+            // the function is looked up the first time, then the call goes right to it
+            for (int i = 0; i < 3; ++i)
+                Assert::AreEqual(12.0, exp.evaluate(L"length2(list(1.0, 2.0))").numberVal());
+            Assert::AreEqual(1, callable.lookups);
+
+            // adding functions makes calls look them up again
+            callable::functionsChanged();
+            Assert::AreEqual(12.0, exp.evaluate(L"length2(list(1.0, 2.0))").numberVal());
+            Assert::AreEqual(2, callable.lookups);
+
+            // member-like calls resolve the function, the variable is still looked up
+            symtable.set(L"x", object::list{ 1.0, 2.0, 3.0 });
+            Assert::AreEqual(13.0, exp.evaluate(L"x.length2()").numberVal());
+            symtable.assign(L"x", object::list{ 1.0 });
+            Assert::AreEqual(11.0, exp.evaluate(L"x.length2()").numberVal());
+        }
+
         TEST_METHOD(TestOperators)
         {
             Assert::IsTrue(expression::isOperator(L"", "-", -1));
@@ -94,6 +132,22 @@ namespace mscript
             Assert::IsTrue(!expression::isOperator(L"random", "and", 1));
         }
 
+        TEST_METHOD(TestOperatorTypes)
+        {
+            Assert::IsTrue(expression::compile(L"x + y")->op == expression_node::ADD);
+            Assert::IsTrue(expression::compile(L"x EQU y")->op == expression_node::EQUAL);
+            Assert::IsTrue(expression::compile(L"x == y")->op == expression_node::EQUAL);
+            Assert::IsTrue(expression::compile(L"x and y")->op == expression_node::AND);
+            Assert::IsTrue(expression::compile(L"x <> y")->op == expression_node::NOT_EQUAL);
+            Assert::IsTrue(expression::compile(L"x LSS y")->op == expression_node::LSS);
+
+            // < ignores case with strings, LSS does not
+            Assert::IsTrue(expression::evaluateBinaryOp(expression_node::LESS, toWideStr("a"), toWideStr("B"), L"").boolVal());
+            Assert::IsFalse(expression::evaluateBinaryOp(expression_node::LSS, toWideStr("a"), toWideStr("B"), L"").boolVal());
+            Assert::AreEqual(7.0, expression::evaluateBinaryOp(expression_node::ADD, 3.0, 4.0, L"").numberVal());
+            Assert::IsTrue(expression::evaluateBinaryOp(expression_node::EQUAL, object(), object(), L"").boolVal());
+        }
+
         TEST_METHOD(TestReverseFind)
         {
             // string source, string search, int start
@@ -107,6 +161,103 @@ namespace mscript
             Assert::AreEqual(7, expression::reverseFind(L"bother and another", L"and", 9));
         }
 
+        TEST_METHOD(TestCompiledExpressions)
+        {
+            symbol_table symbols;
+            no_op_callable callable;
+            tracing trace_info;
+            expression_cache cache;
+            expression exp(symbols, callable, trace_info, false, &cache);
+
+            symbols.set(L"x", 2.0);
+            Assert::AreEqual(7.0, exp.evaluate(L"x * 3 + 1").numberVal());
+            Assert::AreEqual(size_t(1), cache.size());
+
+            // the cached tree sees the new variable value
+            symbols.assign(L"x", 5.0);
+            Assert::AreEqual(16.0, exp.evaluate(L"x * 3 + 1").numberVal());
+            Assert::AreEqual(size_t(1), cache.size());
+
+            // compile errors are only raised when evaluated, so short circuiting still works
+            Assert::IsTrue(exp.evaluate(L"x = 5 || (1 +)").boolVal());
+            bool threw = false;
+            try
+            {
+                exp.evaluate(L"x = 4 || (1 +)");
+            }
+            catch (const user_exception&)
+            {
+                threw = true;
+            }
+            Assert::IsTrue(threw);
+
+            expression_node_ptr node = expression::compile(L"(1 + 2) * 3");
+            Assert::AreEqual(9.0, exp.evaluate(*node).numberVal());
+            Assert::AreEqual(9.0, exp.evaluate(*node).numberVal());
+        }
+
+        TEST_METHOD(TestRegexCache)
+        {
+            regex_cache cache(2);
+            auto first = cache.get(L"[0-9]+");
+            Assert::IsTrue(first == cache.get(L"[0-9]+"));
+            Assert::AreEqual(size_t(1), cache.hits());
+            Assert::AreEqual(size_t(1), cache.misses());
+
+            // flags are part of what's cached
+            Assert::IsTrue(first != cache.get(L"[0-9]+", std::regex_constants::ECMAScript | std::regex_constants::icase));
+            Assert::AreEqual(size_t(2), cache.size());
+
+            // the least recently used pattern makes way for new ones
+            cache.get(L"[0-9]+");
+            cache.get(L"[a-z]+");
+            Assert::AreEqual(size_t(2), cache.size());
+            Assert::IsTrue(first == cache.get(L"[0-9]+"));
+            Assert::AreEqual(size_t(3), cache.hits());
+            Assert::AreEqual(size_t(3), cache.misses());
+
+            // bad patterns raise and are not cached
+            bool threw = false;
+            try
+            {
+                cache.get(L"[0-9");
+            }
+            catch (const std::regex_error&)
+            {
+                threw = true;
+            }
+            Assert::IsTrue(threw);
+            Assert::AreEqual(size_t(2), cache.size());
+        }
+
+        TEST_METHOD(TestConstantFolding)
+        {
+            // operators and pure functions on literals compile to literals
+            expression_node_ptr node = expression::compile(L"(1 + 2) * 3");
+            Assert::IsTrue(node->type == expression_node::LITERAL);
+            Assert::AreEqual(9.0, node->value.numberVal());
+
+            node = expression::compile(L"sqrt(16) + length(\"abc\")");
+            Assert::IsTrue(node->type == expression_node::LITERAL);
+            Assert::AreEqual(7.0, node->value.numberVal());
+
+            node = expression::compile(L"\"a\" + TAB");
+            Assert::IsTrue(node->type == expression_node::LITERAL);
+            Assert::AreEqual(std::wstring(L"a\t"), node->value.stringVal());
+
+            // variables, impure functions, and lists are left to run
+            node = expression::compile(L"x * (2 + 3)");
+            Assert::IsTrue(node->type == expression_node::BINARY_OP);
+            Assert::IsTrue(node->children[1]->type == expression_node::LITERAL);
+
+            Assert::IsTrue(expression::compile(L"random(1, 2)")->type == expression_node::CALL);
+            Assert::IsTrue(expression::compile(L"list(1, 2)")->type == expression_node::CALL);
+
+            // errors are still raised when evaluated
+            node = expression::compile(L"sqrt(\"foo\")");
+            Assert::IsTrue(node->type == expression_node::CALL);
+        }
+
         TEST_METHOD(TestExpressions)
         {
             symbol_table symbols;
@@ -2,6 +2,7 @@
 #include "CppUnitTest.h"
 
 #include "object_json.h"
+#include "user_exception.h"
 #include "utils.h"
 #pragma comment(lib, "mscript-core")
 
@@ -109,6 +110,83 @@ namespace mscript
 			Assert::AreEqual(toWideStr("{\"foo\": [1, 2, 3]}"), str);
 			obj2 = objectFromJson(str);
 			Assert::IsTrue(obj2 == obj);
+
+			object::range range;
+			range.from = 1.0;
+			range.count = 3;
+			str = objectToJson(range);
+			Assert::AreEqual(toWideStr("[1, 2, 3]"), str);
+			obj2 = objectFromJson(str);
+			Assert::IsTrue(obj2 == object(range));
+		}
+
+		TEST_METHOD(FromJsonTests)
+		{
+			// wide and UTF-8 text parse the same
+			object obj = objectFromJson(L" { \"caf\u00e9\" : [ 1 , -2.5e3 , true , null , \"a\\tb\" ] , \"empty\": {} } ");
+			object utf8 = objectFromJson(std::string_view("{\"caf\xc3\xa9\": [1, -2.5e3, true, null, \"a\\tb\"], \"empty\": {}}"));
+			Assert::IsTrue(obj == utf8);
+			Assert::AreEqual(size_t(2), obj.indexVal().size());
+
+			object list = obj.indexVal().get(toWideStr("caf\u00e9"));
+			Assert::AreEqual(-2500.0, list.listVal()[1].numberVal());
+			Assert::AreEqual(toWideStr("a\tb"), list.listVal()[4].stringVal());
+
+			// escapes
+			Assert::AreEqual(toWideStr("\u00e9/\"\\"), objectFromJson(std::string_view("\"\\u00e9\\/\\\"\\\\\"")).stringVal());
+			Assert::AreEqual(toWideStr("\U0001F600"), objectFromJson(std::string_view("\"\\ud83d\\ude00\"")).stringVal());
+
+			// numbers, too small for a double is zero
+			Assert::AreEqual(-0.5, objectFromJson(std::string_view("-0.5E0")).numberVal());
+			Assert::AreEqual(0.0, objectFromJson(std::string_view("1e-400")).numberVal());
+
+			// errors
+			const char* bad[] =
+			{
+				"", "[1, 2", "{\"a\" 1}", "[1,]", "tru", "\"abc", "1 2", "[01x]", "\"\\q\"",
+				"01", "1.", ".5", "-", "1e", "+1", "1e400", "\"\\ud800\"", "\"\\udc00x\"", "\"\\ud800\\u0041\""
+			};
+			for (const char* json : bad)
+			{
+				bool failed = false;
+				try
+				{
+					objectFromJson(std::string_view(json));
+				}
+				catch (const user_exception&)
+				{
+					failed = true;
+				}
+				Assert::IsTrue(failed);
+			}
+		}
+
+		TEST_METHOD(JsonWriterTests)
+		{
+			object obj = object::index();
+			obj.indexVal().set(toWideStr("foo"), object::list{ 1.5, toWideStr("a/b\"c\n") });
+			obj.indexVal().set(toWideStr("bar"), object::list());
+			Assert::AreEqual(toWideStr("{\"foo\": [1.5, \"a\\/b\\\"c\\n\"], \"bar\": []}"), objectToJson(obj));
+			Assert::AreEqual
+			(
+				toWideStr("{\n    \"foo\": [\n        1.5,\n        \"a\\/b\\\"c\\n\"\n    ],\n    \"bar\": []\n}"),
+				objectToJson(obj, true)
+			);
+			Assert::IsTrue(objectFromJson(objectToJson(obj, true)) == obj);
+
+			// numbers keep ten significant digits
+			Assert::AreEqual(toWideStr("[0.3333333333, 1e+20, -2]"), objectToJson(object::list{ 1.0 / 3.0, 1e20, -2.0 }));
+
+			// a sink gets everything in pieces
+			object::list big;
+			for (int i = 0; i < 100000; ++i)
+				big.push_back(toWideStr("item"));
+			std::wstring fromSink;
+			int sinkCalls = 0;
+			json_writer writer([&](const wchar_t* text, size_t length) { fromSink.append(text, length); ++sinkCalls; });
+			writer.write(big);
+			Assert::IsTrue(sinkCalls > 1);
+			Assert::AreEqual(objectToJson(big), fromSink);
 		}
 	};
 }
@@ -91,6 +91,24 @@ namespace mscript
 				Assert::AreEqual(toWideStr("{foo: bar, blet: monkey}"), obj.toString());
 			}
 
+			{
+				object::range range;
+				range.from = 2.0;
+				range.step = 3.0;
+				range.count = 3;
+				object obj(range);
+				Assert::IsTrue(obj.type() == object::RANGE);
+				Assert::AreEqual(std::string("range"), obj.typeStr());
+				Assert::AreEqual(size_t(3), obj.length());
+				Assert::AreEqual(8.0, obj.rangeVal().at(2));
+				Assert::AreEqual(toWideStr("[2, 5, 8]"), obj.toString());
+
+				object list = object::list{ 2.0, 5.0, 8.0 };
+				Assert::IsTrue(obj == list);
+				Assert::IsTrue(list == obj);
+				Assert::AreEqual(std::hash<object>()(list), std::hash<object>()(obj));
+			}
+
 			{
 				object obj;
 				obj = 1.2;
@@ -162,5 +180,192 @@ namespace mscript
 				Assert::AreEqual(originalIndexStr, index1.toString());
 			}
 		}
+
+		TEST_METHOD(ObjectHashTests)
+		{
+			std::hash<object> hasher;
+
+			// equal with rounding has to mean equal hashes
+			object num0 = 3.0;
+			object num1 = 3.00000000001;
+			Assert::IsTrue(num0 == num1);
+			Assert::AreEqual(hasher(num0), hasher(num1));
+			Assert::AreEqual(hasher(object(-0.0)), hasher(object(0.0)));
+			Assert::AreNotEqual(hasher(object(1.0)), hasher(object(2.0)));
+
+			// numbers with the same whole number part spread out
+			std::unordered_set<size_t> buckets;
+			for (int i = 0; i <= 20000; ++i)
+				buckets.insert(hasher(object(i / 100000.0)) & 32767);
+			Assert::IsTrue(buckets.size() > 10000);
+
+			Assert::AreEqual(hasher(object(toWideStr("foo"))), hasher(object(toWideStr("foo"))));
+			Assert::AreNotEqual(hasher(object(toWideStr("foo"))), hasher(object(toWideStr("bar"))));
+			Assert::AreNotEqual(hasher(object(toWideStr("1"))), hasher(object(1.0)));
+
+			object list0 = object::list{ 1.0, toWideStr("foo") };
+			object list1 = object::list{ 1.0, toWideStr("foo") };
+			object list2 = object::list{ toWideStr("foo"), 1.0 };
+			Assert::AreEqual(hasher(list0), hasher(list1));
+			Assert::AreNotEqual(hasher(list0), hasher(list2));
+
+			object::index indexVal;
+			indexVal.set(list0, num0);
+			object index0 = indexVal;
+			object index1 = index0.clone();
+			Assert::AreEqual(hasher(index0), hasher(index1));
+			index1.indexVal().set(2.0, 3.0);
+			Assert::AreNotEqual(hasher(index0), hasher(index1));
+
+			// lists make usable keys
+			Assert::IsTrue(indexVal.contains(list1));
+			Assert::IsTrue(!indexVal.contains(list2));
+
+			// strings can be looked up without making objects, and don't match other types
+			Assert::AreEqual(hasher(object(toWideStr("foo"))), hasher(toWideStr("foo")));
+			indexVal.set(toWideStr("foo"), 1.0);
+			Assert::IsTrue(indexVal.contains(toWideStr("foo")));
+			Assert::IsTrue(!indexVal.contains(toWideStr("bar")));
+			Assert::IsTrue(!(num0 == toWideStr("3")));
+		}
+
+		TEST_METHOD(ObjectCopyTests)
+		{
+			Assert::IsTrue(sizeof(object) <= 16);
+
+			// strings are values, changing a copy leaves the original alone
+			{
+				object str0 = toWideStr("foo");
+				object str1 = str0;
+				str1.stringVal() += L"bar";
+				Assert::AreEqual(toWideStr("foo"), str0.stringVal());
+				Assert::AreEqual(toWideStr("foobar"), str1.stringVal());
+			}
+
+			// lists and indexes are references, changing a copy changes the original
+			{
+				object list0 = object::list{ 1.0 };
+				object list1 = list0;
+				list1.listVal().push_back(2.0);
+				Assert::AreEqual(size_t(2), list0.length());
+
+				object index0 = object::index();
+				object index1 = index0;
+				index1.indexVal().set(1.0, 2.0);
+				Assert::AreEqual(size_t(1), index0.length());
+			}
+
+			// copyValue() shares the items until one side changes, then they go their own ways
+			{
+				object list0 = object::list{ 1.0, 2.0 };
+				object list1 = list0.copyValue();
+				Assert::IsTrue(&std::as_const(list0).listVal() == &std::as_const(list1).listVal());
+
+				list1.listVal().push_back(3.0);
+				Assert::AreEqual(size_t(2), list0.length());
+				Assert::AreEqual(size_t(3), list1.length());
+
+				object index0 = object::index();
+				index0.indexVal().set(1.0, 2.0);
+				object index1 = index0.copyValue();
+				index0.indexVal().set(3.0, 4.0);
+				Assert::AreEqual(size_t(2), index0.length());
+				Assert::AreEqual(size_t(1), index1.length());
+			}
+
+			// clones of lists with lists in them don't share the inner lists
+			{
+				object inner = object::list{ 1.0 };
+				object list0 = object::list{ inner };
+				object list1 = list0.clone();
+				list1.listVal()[0].listVal().push_back(2.0);
+				Assert::AreEqual(size_t(1), inner.length());
+
+				object flat = object::list{ 1.0 };
+				object flatClone = flat.clone();
+				flatClone.listVal().push_back(2.0);
+				Assert::AreEqual(size_t(1), flat.length());
+			}
+
+			// typed empty objects have empty values
+			{
+				Assert::AreEqual(size_t(0), object(object::STRING).length());
+				Assert::AreEqual(size_t(0), object(object::LIST).length());
+				Assert::AreEqual(size_t(0), object(object::INDEX).length());
+			}
+
+			// moving leaves null behind
+			{
+				object str0 = toWideStr("foo");
+				object str1 = std::move(str0);
+				Assert::IsTrue(str0.isNull());
+				Assert::AreEqual(toWideStr("foo"), str1.stringVal());
+
+				str1 = str1;
+				Assert::AreEqual(toWideStr("foo"), str1.stringVal());
+			}
+		}
+
+		TEST_METHOD(ObjectAsciiStringTests)
+		{
+			std::hash<object> hasher;
+
+			// ASCII is kept a byte a character, anything else is wide
+			object ascii = object::fromUtf8(std::string_view("foo"));
+			object wide = toWideStr("foo");
+			Assert::IsTrue(ascii.isAsciiString());
+			Assert::IsTrue(!wide.isAsciiString());
+			Assert::IsTrue(object::fromWide(std::wstring_view(L"foo")).isAsciiString());
+			Assert::IsTrue(!object::fromUtf8(std::string_view("caf\xc3\xa9")).isAsciiString());
+			Assert::AreEqual(std::wstring(L"caf\u00e9"), object::fromUtf8(std::string_view("caf\xc3\xa9")).stringVal());
+
+			// either way they're the same string
+			Assert::IsTrue(ascii == wide);
+			Assert::IsTrue(ascii == toWideStr("foo"));
+			Assert::AreEqual(hasher(ascii), hasher(wide));
+			Assert::AreEqual(hasher(ascii), hasher(toWideStr("foo")));
+			Assert::IsTrue(object::fromUtf8(std::string_view("bar")) < wide);
+			Assert::IsTrue(!(ascii < wide) && !(wide < ascii));
+			Assert::AreEqual(size_t(3), ascii.length());
+			Assert::AreEqual(toWideStr("foo"), ascii.toString());
+
+			object::index index;
+			index.set(wide, 1.0);
+			Assert::IsTrue(index.contains(ascii));
+
+			// reading it wide widens it once for everyone sharing it, and it stays ASCII
+			{
+				object str0 = object::fromUtf8(std::string_view("foo"));
+				object str1 = str0;
+				const std::string& ascii = std::as_const(str0).asciiVal();
+				const std::wstring& wide1 = std::as_const(str1).stringVal();
+				Assert::AreEqual(toWideStr("foo"), wide1);
+				Assert::IsTrue(str0.isAsciiString());
+				Assert::AreEqual(std::string("foo"), ascii);
+				Assert::IsTrue(&wide1 == &std::as_const(str0).stringVal());
+
+				// changing it leaves the copy's wide string alone
+				str0.stringVal() += L"bar";
+				Assert::AreEqual(toWideStr("foobar"), std::as_const(str0).stringVal());
+				Assert::AreEqual(toWideStr("foo"), wide1);
+				Assert::IsTrue(str1.isAsciiString());
+			}
+
+			// changing a copy leaves the original alone
+			{
+				object str0 = object::fromUtf8(std::string_view("foo"));
+				object str1 = str0;
+				str1.asciiVal() += "bar";
+				Assert::AreEqual(std::string("foo"), str0.asciiVal());
+				Assert::AreEqual(std::string("foobar"), str1.asciiVal());
+			}
+
+			try
+			{
+				wide.asciiVal();
+				Assert::Fail();
+			}
+			catch (const user_exception&) {}
+		}
 	};
 }
@@ -0,0 +1,106 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "statements.h"
+#include "utils.h"
+#pragma comment(lib, "mscript-core")
+#pragma comment(lib, "mscript-lib")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace mscript
+{
+    TEST_CLASS(StatementTests)
+    {
+    public:
+        TEST_METHOD(TestCompileStatements)
+        {
+            std::vector<std::wstring> lines
+            {
+                L"$ x = 1",
+                L"",
+                L"++ i : 1 -> 10",
+                L"\t& x = x * i",
+                L"}",
+                L"? x > 100",
+                L"\t> \"big\"",
+                L"}",
+                L"<>",
+                L"\t> \"small\"",
+                L"}",
+                L"echo hi",
+            };
+            for (auto& line : lines)
+                line = trim(line);
+
+            frame_plan plan;
+            statement_block statements = compileStatements(lines, 0, int(lines.size()) - 1, plan);
+            Assert::AreEqual(size_t(4), statements.size());
+
+            Assert::IsTrue(statements[0].type == statement::DECLARE);
+            Assert::AreEqual(std::wstring(L"x"), statements[0].symbol.name);
+            Assert::AreEqual(0, statements[0].symbol.slot);
+
+            Assert::IsTrue(statements[1].type == statement::COUNT_UP);
+            Assert::AreEqual(2, statements[1].lineIndex);
+            Assert::AreEqual(std::wstring(L"i"), statements[1].symbol.name);
+            Assert::AreEqual(size_t(1), statements[1].body.size());
+            Assert::IsTrue(statements[1].body[0].type == statement::ASSIGN);
+
+            // x is two frames up from the loop body, past the frame with i
+            Assert::AreEqual(2, statements[1].body[0].symbol.frameUp);
+            Assert::AreEqual(0, statements[1].body[0].symbol.slot);
+
+            Assert::IsTrue(statements[2].type == statement::IF);
+            Assert::AreEqual(size_t(2), statements[2].branches.size());
+            Assert::IsTrue(statements[2].branches[0].type == statement_branch::CRITERIA);
+            Assert::IsTrue(statements[2].branches[1].type == statement_branch::ELSE);
+            Assert::IsTrue(statements[2].branches[1].body[0].type == statement::PRINT);
+
+            Assert::IsTrue(statements[3].type == statement::COMMAND);
+            Assert::AreEqual(11, statements[3].lineIndex);
+        }
+
+        TEST_METHOD(TestCompileErrors)
+        {
+            // bad statements compile to errors that are raised when run
+            std::vector<std::wstring> lines{ L"$ 1x = 2", L"* x = 1" };
+            frame_plan plan;
+            statement_block statements = compileStatements(lines, 0, int(lines.size()) - 1, plan);
+            Assert::AreEqual(size_t(2), statements.size());
+            Assert::IsTrue(statements[0].type == statement::ERROR);
+            Assert::IsTrue(statements[0].error.has_value());
+            Assert::IsTrue(statements[1].type == statement::ASSIGN);
+
+            // x was never set, so it can only be looked up by name
+            Assert::AreEqual(-1, statements[1].symbol.slot);
+        }
+
+        TEST_METHOD(TestCompileGlobals)
+        {
+            std::vector<std::wstring> script{ L"$ g = 1", L"$ h = 2" };
+            frame_plan globals;
+            compileStatements(script, 0, int(script.size()) - 1, globals);
+            Assert::AreEqual(size_t(2), globals.names.size());
+
+            // function bodies find globals by slot, past their own variables
+            std::vector<std::wstring> body{ L"$ y = g", L"$ h = p", L"> h" };
+            frame_plan plan;
+            plan.names.push_back(L"p");
+            statement_block statements = compileStatements(body, 0, int(body.size()) - 1, plan, &globals);
+            Assert::AreEqual(size_t(3), plan.names.size());
+            Assert::AreEqual(plan.frameId, plan.symbols[0].frameId);
+            Assert::AreEqual(0, plan.symbols[0].slot);
+
+            const symbol_ref& g = statements[0].exp->symbol;
+            Assert::IsTrue(g.global);
+            Assert::AreEqual(0, g.slot);
+            Assert::AreEqual(globals.frameId, g.frameId);
+
+            const symbol_ref& h = statements[2].exp->symbol;
+            Assert::IsTrue(!h.global);
+            Assert::AreEqual(2, h.slot);
+            Assert::AreEqual(plan.frameId, h.frameId);
+        }
+    };
+}
@@ -100,6 +100,67 @@ namespace mscript
             }
         }
 
+        TEST_METHOD(SymbolSlotTests)
+        {
+            symbol_table table;
+            table.pushFrame();
+            table.set(symbol_ref(L"foo", 0, 0, 1), 1.0);
+            table.set(symbol_ref(L"Bar", 0, 1, 1), 2.0);
+            Assert::AreEqual(2.0, table.get(L"bar").numberVal());
+
+            table.pushFrame();
+            Assert::AreEqual(1.0, table.get(symbol_ref(L"FOO", 1, 0, 1)).numberVal());
+            table.assign(symbol_ref(L"bar", 1, 1, 1), 3.0);
+            Assert::AreEqual(3.0, table.get(L"bar").numberVal());
+
+            // slots of another compiled frame, or ones not set yet, fall back to the name
+            Assert::AreEqual(3.0, table.get(symbol_ref(L"bar", 1, 1, 2)).numberVal());
+            Assert::AreEqual(1.0, table.get(symbol_ref(L"foo", 0, 5, 1)).numberVal());
+
+            // names set outside of the plan hide planned slots further down
+            table.set(L"foo", 4.0);
+            Assert::AreEqual(4.0, table.get(symbol_ref(L"foo", 1, 0, 1)).numberVal());
+
+            // slots do not get around setting the same name twice
+            bool threw = false;
+            try
+            {
+                table.set(symbol_ref(L"foo", 0, 0, 3), 5.0);
+            }
+            catch (const user_exception&)
+            {
+                threw = true;
+            }
+            Assert::IsTrue(threw);
+
+            // planned slots start after names set first, like the script arguments
+            symbol_table args;
+            args.set(L"arguments", object::list());
+            args.set(symbol_ref(L"x", 0, 0, 4), 1.0);
+            args.set(symbol_ref(L"y", 0, 1, 4), 2.0);
+            Assert::AreEqual(2.0, args.get(symbol_ref(L"y", 0, 1, 4)).numberVal());
+            Assert::AreEqual(2.0, args.get(L"y").numberVal());
+        }
+
+        TEST_METHOD(SymbolGlobalSlotTests)
+        {
+            symbol_table table;
+            table.set(symbol_ref(L"g", 0, 0, 1), 1.0);
+            {
+                symbol_smacker smacker(table);
+                symbol_stacker stacker(table);
+
+                // globals are found by slot from inside functions
+                Assert::AreEqual(1.0, table.get(symbol_ref(L"g", 1, 0, 1, true)).numberVal());
+                table.assign(symbol_ref(L"g", 1, 0, 1, true), 2.0);
+
+                // unless something set by name in the function hides them
+                table.set(L"g", 3.0);
+                Assert::AreEqual(3.0, table.get(symbol_ref(L"g", 1, 0, 1, true)).numberVal());
+            }
+            Assert::AreEqual(2.0, table.get(L"g").numberVal());
+        }
+
         TEST_METHOD(SymbolStackerTests)
         {
             symbol_table table;
@@ -114,6 +175,13 @@ namespace mscript
                         Assert::IsTrue(table.contains(L"foo"));
                         Assert::IsFalse(table.contains(L"blet"));
                         table.set(L"something", toWideStr("else"));
+                        {
+                            symbol_smacker smacker2(table);
+                            symbol_stacker stacker3(table);
+                            Assert::IsTrue(table.contains(L"foo"));
+                            Assert::IsFalse(table.contains(L"something"));
+                        }
+                        Assert::IsTrue(table.contains(L"something"));
                     }
                 }
                 Assert::IsTrue(table.contains(L"blet"));
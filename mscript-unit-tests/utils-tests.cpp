@@ -2,6 +2,7 @@
 #include "CppUnitTest.h"
 
 #include "object.h"
+#include "mapped_file.h"
 #include "names.h"
 #include "utils.h"
 #pragma comment(lib, "mscript-core")
@@ -74,6 +75,18 @@ namespace mscript
 			Assert::AreEqual(toWideStr("abc"), trim(L" abc "));
 		}
 
+		TEST_METHOD(TrimViewTests)
+		{
+			std::wstring str = L"  foo bar \t";
+			std::wstring_view view = trimView(str);
+			Assert::AreEqual(toWideStr("foo bar"), std::wstring(view));
+			Assert::IsTrue(view.data() == str.data() + 2);
+
+			Assert::IsTrue(trimView(L"").empty());
+			Assert::IsTrue(trimView(L" \t\n").empty());
+			Assert::AreEqual(toWideStr("a"), std::wstring(trimView(L"a")));
+		}
+
 		TEST_METHOD(ReplaceTests)
 		{
 			std::wstring str;
@@ -143,6 +156,78 @@ namespace mscript
 			Assert::AreEqual(toWideStr("foo bar blet"), join(split(L"foo / bar / blet", L" / "), L" "));
 		}
 
+		TEST_METHOD(LineReaderTests)
+		{
+			// lines come out like std::getline, no empty line after a final line feed
+			line_reader reader("foo\r\n\nbar\n");
+			Assert::AreEqual(size_t(3), reader.countLines());
+
+			std::string_view line;
+			Assert::IsTrue(reader.next(line));
+			Assert::AreEqual(std::string("foo\r"), std::string(line));
+			Assert::IsTrue(reader.next(line));
+			Assert::IsTrue(line.empty());
+			Assert::IsTrue(reader.next(line));
+			Assert::AreEqual(std::string("bar"), std::string(line));
+			Assert::IsTrue(!reader.next(line));
+
+			Assert::AreEqual(size_t(2), line_reader("a\nb").countLines());
+			Assert::AreEqual(size_t(0), line_reader("").countLines());
+		}
+
+		TEST_METHOD(WideStrTests)
+		{
+			Assert::AreEqual(std::wstring(L"plain ascii text"), toWideStr("plain ascii text"));
+			Assert::AreEqual(std::wstring(L"caf\u00e9 au lait"), toWideStr("caf\xc3\xa9 au lait"));
+		}
+
+		TEST_METHOD(AsciiTests)
+		{
+			Assert::IsTrue(isAscii(std::string_view("")));
+			Assert::IsTrue(isAscii(std::string_view("plain ascii text")));
+			Assert::IsTrue(!isAscii(std::string_view("caf\xc3\xa9")));
+			Assert::IsTrue(!isAscii(std::string_view("a long run of plain text then caf\xc3\xa9")));
+			Assert::IsTrue(isAscii(std::wstring_view(L"plain")));
+			Assert::IsTrue(!isAscii(std::wstring_view(L"caf\u00e9")));
+
+			auto pieces = split(std::string_view("foo,,bar"), std::string_view(","));
+			Assert::AreEqual(size_t(3), pieces.size());
+			Assert::IsTrue(pieces[1].empty());
+			Assert::AreEqual(std::string("bar"), std::string(pieces[2]));
+			Assert::AreEqual(std::string("foo bar"), std::string(trimView(std::string_view(" foo bar\t"))));
+		}
+
+		TEST_METHOD(NumberTests)
+		{
+			Assert::AreEqual(std::string("0"), num2str(0.0));
+			Assert::AreEqual(std::string("-2"), num2str(-2.0));
+			Assert::AreEqual(std::string("0.1"), num2str(0.1));
+			Assert::AreEqual(std::string("0.3333333333"), num2str(1.0 / 3.0));
+			Assert::AreEqual(std::string("1.23456789e+11"), num2str(123456789012.0));
+			Assert::AreEqual(std::string("1e-07"), num2str(1e-7));
+			Assert::AreEqual(toWideStr("1e+20"), num2wstr(1e20));
+
+			wchar_t chars[maxNumberLength];
+			Assert::AreEqual(toWideStr("12.5"), std::wstring(chars, num2chars(12.5, chars)));
+
+			double number = 0.0;
+			Assert::IsTrue(parseNumber(L" 12.5", number));
+			Assert::AreEqual(12.5, number);
+			Assert::IsTrue(parseNumber(L"+3", number));
+			Assert::AreEqual(3.0, number);
+			Assert::IsTrue(parseNumber(L"-0x1A", number));
+			Assert::AreEqual(-26.0, number);
+			Assert::IsTrue(parseNumber(L"12abc", number));
+			Assert::AreEqual(12.0, number);
+			Assert::IsTrue(parseNumber(L"1e3", number));
+			Assert::AreEqual(1000.0, number);
+
+			Assert::IsTrue(!parseNumber(L"", number));
+			Assert::IsTrue(!parseNumber(L"abc", number));
+			Assert::IsTrue(!parseNumber(L"--5", number));
+			Assert::IsTrue(!parseNumber(L"1e999", number));
+		}
+
 		TEST_METHOD(LastErrorTests)
 		{
 			std::wstring msg;
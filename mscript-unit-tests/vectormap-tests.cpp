@@ -4,6 +4,7 @@
 #include "vectormap.h"
 
 #include <string>
+#include <string_view>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -222,5 +223,63 @@ namespace mscript
 			Assert::AreEqual(std::string("something"), values[1]);
 			Assert::AreEqual(std::string("else"), values[2]);
 		}
+
+		TEST_METHOD(EraseTest)
+		{
+			vectormap<int, std::string> map;
+			map.set(1, "foo");
+			map.set(3, "bar");
+			map.set(2, "blet");
+
+			Assert::IsTrue(!map.erase(914));
+			Assert::IsTrue(map.erase(3));
+			Assert::IsTrue(!map.erase(3));
+			Assert::AreEqual(size_t(2), map.size());
+			Assert::IsTrue(!map.contains(3));
+			Assert::IsTrue(map.contains(2));
+
+			// order is kept, and a key set again goes to the end
+			map.set(3, "again");
+			auto keys = map.keys();
+			Assert::AreEqual(size_t(3), keys.size());
+			Assert::AreEqual(1, keys[0]);
+			Assert::AreEqual(2, keys[1]);
+			Assert::AreEqual(3, keys[2]);
+			Assert::AreEqual(std::string("blet"), map.getAt(1));
+			Assert::AreEqual(std::string("again"), map.get(3));
+
+			// lots of keys in and out
+			map.reserve(1000);
+			for (int k = 0; k < 1000; ++k)
+				map.set(k, std::to_string(k));
+			for (int k = 0; k < 1000; k += 2)
+				Assert::IsTrue(map.erase(k));
+			Assert::AreEqual(size_t(500), map.size());
+			for (int k = 0; k < 1000; ++k)
+				Assert::AreEqual(k % 2 == 1, map.contains(k));
+
+			size_t idx = 0;
+			for (const auto& kvp : map.vec())
+			{
+				Assert::AreEqual(int(idx * 2 + 1), kvp.first);
+				Assert::AreEqual(std::to_string(kvp.first), kvp.second);
+				++idx;
+			}
+			Assert::AreEqual(size_t(500), idx);
+		}
+
+		TEST_METHOD(LookupTest)
+		{
+			// strings can be looked up without being made into std::string
+			struct string_hasher
+			{
+				size_t operator()(std::string_view str) const { return std::hash<std::string_view>()(str); }
+			};
+			vectormap<std::string, int, string_hasher> map;
+			map.set("foo", 1);
+			Assert::IsTrue(map.contains(std::string_view("foo")));
+			Assert::AreEqual(1, map.get(std::string_view("foo")));
+			Assert::IsTrue(!map.contains(std::string_view("bar")));
+		}
 	};
 }